@@ -23,6 +23,8 @@ enum InputPrepareTaskState {
 enum InputPrepareStage {
   idle(0),
   decode(1),
+
+  /// Retired natively: resampling is part of [decode] and is never reported.
   resample(2),
   writeCanonical(3),
   done(4);
@@ -16,14 +16,94 @@ final class AmsRunConfig extends ffi.Struct {
 
   @ffi.Int32()
   external int overlap;
+
+  @ffi.Int32()
+  external int executionMode;
+
+  external ffi.Pointer<Utf8> resultCacheDir;
+
+  @ffi.Int64()
+  external int resultCacheMaxBytes;
+
+  @ffi.Int32()
+  external int priority;
+
+  external ffi.Pointer<Utf8> tuningProfilePath;
+
+  @ffi.Double()
+  external double silenceThresholdDb;
+
+  @ffi.Int32()
+  external int replicas;
 }
 
 final class AmsPrepareConfig extends ffi.Struct {
   external ffi.Pointer<Utf8> inputPath;
   external ffi.Pointer<Utf8> workDir;
   external ffi.Pointer<Utf8> outputPrefix;
+
+  @ffi.Int32()
+  external int retainDecodedAudio;
+
+  @ffi.Int64()
+  external int cacheMaxBytes;
+}
+
+final class AmsAutotuneConfig extends ffi.Struct {
+  external ffi.Pointer<Utf8> profilePath;
+
+  @ffi.Int32()
+  external int trialSeconds;
+
+  external ffi.Pointer<ffi.Int32> chunkSizes;
+
+  @ffi.Int32()
+  external int chunkSizeCount;
+
+  @ffi.Int32()
+  external int priority;
 }
 
+final class AmsEngineOpenOptions extends ffi.Struct {
+  @ffi.Int32()
+  external int backendPreference;
+
+  @ffi.Int32()
+  external int prefetchModelFile;
+}
+
+/// Mirrors `ams_task_snapshot_t`.
+final class AmsTaskSnapshot extends ffi.Struct {
+  @ffi.Int32()
+  external int found;
+
+  @ffi.Int32()
+  external int state;
+
+  @ffi.Int32()
+  external int stage;
+
+  @ffi.Double()
+  external double progress;
+
+  @ffi.Int32()
+  external int queuePosition;
+
+  @ffi.Int64()
+  external int etaMs;
+}
+
+/// Native signature of `ams_event_callback_t`.
+typedef AmsEventCallbackNative =
+    ffi.Void Function(
+      ffi.Int32 kind,
+      ffi.Uint64 handle,
+      ffi.Int32 state,
+      ffi.Int32 stage,
+      ffi.Double progress,
+      ffi.Pointer<ffi.Void> userData,
+    );
+
 typedef _EngineOpenNative =
     ffi.Int32 Function(
       ffi.Pointer<Utf8> modelPath,
@@ -37,6 +117,53 @@ typedef _EngineOpenDart =
       ffi.Pointer<ffi.Uint64> outEngine,
     );
 
+typedef _EngineOpenExNative =
+    ffi.Int32 Function(
+      ffi.Pointer<Utf8> modelPath,
+      ffi.Pointer<AmsEngineOpenOptions> options,
+      ffi.Pointer<ffi.Uint64> outEngine,
+    );
+typedef _EngineOpenExDart =
+    int Function(
+      ffi.Pointer<Utf8> modelPath,
+      ffi.Pointer<AmsEngineOpenOptions> options,
+      ffi.Pointer<ffi.Uint64> outEngine,
+    );
+
+typedef _EngineOpenAsyncNative =
+    ffi.Int32 Function(
+      ffi.Pointer<Utf8> modelPath,
+      ffi.Pointer<AmsEngineOpenOptions> options,
+      ffi.Pointer<ffi.Uint64> outLoad,
+    );
+typedef _EngineOpenAsyncDart =
+    int Function(
+      ffi.Pointer<Utf8> modelPath,
+      ffi.Pointer<AmsEngineOpenOptions> options,
+      ffi.Pointer<ffi.Uint64> outLoad,
+    );
+
+typedef _EngineLoadPollNative =
+    ffi.Int32 Function(
+      ffi.Uint64 load,
+      ffi.Pointer<ffi.Int32> outState,
+      ffi.Pointer<ffi.Double> outProgress,
+    );
+typedef _EngineLoadPollDart =
+    int Function(
+      int load,
+      ffi.Pointer<ffi.Int32> outState,
+      ffi.Pointer<ffi.Double> outProgress,
+    );
+
+typedef _EngineLoadTakeNative =
+    ffi.Int32 Function(ffi.Uint64 load, ffi.Pointer<ffi.Uint64> outEngine);
+typedef _EngineLoadTakeDart =
+    int Function(int load, ffi.Pointer<ffi.Uint64> outEngine);
+
+typedef _EngineLoadHandleNative = ffi.Int32 Function(ffi.Uint64 load);
+typedef _EngineLoadHandleDart = int Function(int load);
+
 typedef _EngineGetDefaultsNative =
     ffi.Int32 Function(
       ffi.Uint64 engine,
@@ -83,6 +210,17 @@ typedef _PreparePollDart =
       ffi.Pointer<ffi.Int32> outStage,
     );
 
+typedef _ModelProbeNative =
+    ffi.Int32 Function(
+      ffi.Pointer<Utf8> modelPath,
+      ffi.Pointer<ffi.Pointer<Utf8>> outJson,
+    );
+typedef _ModelProbeDart =
+    int Function(
+      ffi.Pointer<Utf8> modelPath,
+      ffi.Pointer<ffi.Pointer<Utf8>> outJson,
+    );
+
 typedef _PrepareCancelNative = ffi.Int32 Function(ffi.Uint64 task);
 typedef _PrepareCancelDart = int Function(int task);
 
@@ -107,6 +245,34 @@ typedef _JobStartDart =
       ffi.Pointer<ffi.Uint64> outJob,
     );
 
+typedef _EngineAutotuneNative =
+    ffi.Int32 Function(
+      ffi.Uint64 engine,
+      ffi.Pointer<AmsAutotuneConfig> config,
+      ffi.Pointer<ffi.Uint64> outJob,
+    );
+typedef _EngineAutotuneDart =
+    int Function(
+      int engine,
+      ffi.Pointer<AmsAutotuneConfig> config,
+      ffi.Pointer<ffi.Uint64> outJob,
+    );
+
+typedef _JobStartFromPrepareNative =
+    ffi.Int32 Function(
+      ffi.Uint64 engine,
+      ffi.Uint64 prepare,
+      ffi.Pointer<AmsRunConfig> config,
+      ffi.Pointer<ffi.Uint64> outJob,
+    );
+typedef _JobStartFromPrepareDart =
+    int Function(
+      int engine,
+      int prepare,
+      ffi.Pointer<AmsRunConfig> config,
+      ffi.Pointer<ffi.Uint64> outJob,
+    );
+
 typedef _JobPollNative =
     ffi.Int32 Function(
       ffi.Uint64 job,
@@ -122,6 +288,24 @@ typedef _JobPollDart =
       ffi.Pointer<ffi.Int32> outStage,
     );
 
+typedef _PollManyNative =
+    ffi.Int32 Function(
+      ffi.Pointer<ffi.Uint64> handles,
+      ffi.Int32 count,
+      ffi.Pointer<AmsTaskSnapshot> outSnapshots,
+    );
+typedef _PollManyDart =
+    int Function(
+      ffi.Pointer<ffi.Uint64> handles,
+      int count,
+      ffi.Pointer<AmsTaskSnapshot> outSnapshots,
+    );
+
+typedef _QueuePositionNative =
+    ffi.Int32 Function(ffi.Uint64 task, ffi.Pointer<ffi.Int32> outPosition);
+typedef _QueuePositionDart =
+    int Function(int task, ffi.Pointer<ffi.Int32> outPosition);
+
 typedef _JobCancelNative = ffi.Int32 Function(ffi.Uint64 job);
 typedef _JobCancelDart = int Function(int job);
 
@@ -130,9 +314,64 @@ typedef _JobGetResultNative =
 typedef _JobGetResultDart =
     int Function(int job, ffi.Pointer<ffi.Pointer<Utf8>> outJson);
 
+typedef _JobGetStemCountNative =
+    ffi.Int32 Function(ffi.Uint64 job, ffi.Pointer<ffi.Int32> outCount);
+typedef _JobGetStemCountDart =
+    int Function(int job, ffi.Pointer<ffi.Int32> outCount);
+
+typedef _JobGetStemNative =
+    ffi.Int32 Function(
+      ffi.Uint64 job,
+      ffi.Int32 index,
+      ffi.Pointer<ffi.Pointer<ffi.Float>> outInterleaved,
+      ffi.Pointer<ffi.Int64> outFrames,
+    );
+typedef _JobGetStemDart =
+    int Function(
+      int job,
+      int index,
+      ffi.Pointer<ffi.Pointer<ffi.Float>> outInterleaved,
+      ffi.Pointer<ffi.Int64> outFrames,
+    );
+
+typedef _JobRetainStemNative =
+    ffi.Int32 Function(
+      ffi.Uint64 job,
+      ffi.Int32 index,
+      ffi.Pointer<ffi.Pointer<ffi.Float>> outInterleaved,
+      ffi.Pointer<ffi.Int64> outFrames,
+      ffi.Pointer<ffi.Pointer<ffi.Void>> outToken,
+    );
+typedef _JobRetainStemDart =
+    int Function(
+      int job,
+      int index,
+      ffi.Pointer<ffi.Pointer<ffi.Float>> outInterleaved,
+      ffi.Pointer<ffi.Int64> outFrames,
+      ffi.Pointer<ffi.Pointer<ffi.Void>> outToken,
+    );
+
 typedef _JobDestroyNative = ffi.Int32 Function(ffi.Uint64 job);
 typedef _JobDestroyDart = int Function(int job);
 
+typedef _SchedulerConfigureNative =
+    ffi.Int32 Function(ffi.Int32 maxRunningJobs, ffi.Int32 maxRunningPrepares);
+typedef _SchedulerConfigureDart =
+    int Function(int maxRunningJobs, int maxRunningPrepares);
+
+typedef _SetEventCallbackNative =
+    ffi.Int32 Function(
+      ffi.Pointer<ffi.NativeFunction<AmsEventCallbackNative>> callback,
+      ffi.Pointer<ffi.Void> userData,
+      ffi.Double progressStep,
+    );
+typedef _SetEventCallbackDart =
+    int Function(
+      ffi.Pointer<ffi.NativeFunction<AmsEventCallbackNative>> callback,
+      ffi.Pointer<ffi.Void> userData,
+      double progressStep,
+    );
+
 typedef _LastErrorNative = ffi.Pointer<Utf8> Function();
 typedef _LastErrorDart = ffi.Pointer<Utf8> Function();
 
@@ -152,6 +391,30 @@ class AmsBindings {
     : _engineOpen = library.lookupFunction<_EngineOpenNative, _EngineOpenDart>(
         'ams_engine_open',
       ),
+      _engineOpenEx = library
+          .lookupFunction<_EngineOpenExNative, _EngineOpenExDart>(
+            'ams_engine_open_ex',
+          ),
+      _engineOpenAsync = library
+          .lookupFunction<_EngineOpenAsyncNative, _EngineOpenAsyncDart>(
+            'ams_engine_open_async',
+          ),
+      _engineLoadPoll = library
+          .lookupFunction<_EngineLoadPollNative, _EngineLoadPollDart>(
+            'ams_engine_load_poll',
+          ),
+      _engineLoadCancel = library
+          .lookupFunction<_EngineLoadHandleNative, _EngineLoadHandleDart>(
+            'ams_engine_load_cancel',
+          ),
+      _engineLoadTakeEngine = library
+          .lookupFunction<_EngineLoadTakeNative, _EngineLoadTakeDart>(
+            'ams_engine_load_take_engine',
+          ),
+      _engineLoadDestroy = library
+          .lookupFunction<_EngineLoadHandleNative, _EngineLoadHandleDart>(
+            'ams_engine_load_destroy',
+          ),
       _engineGetDefaults = library
           .lookupFunction<_EngineGetDefaultsNative, _EngineGetDefaultsDart>(
             'ams_engine_get_defaults',
@@ -160,6 +423,9 @@ class AmsBindings {
           .lookupFunction<_EngineCloseNative, _EngineCloseDart>(
             'ams_engine_close',
           ),
+      _modelProbe = library.lookupFunction<_ModelProbeNative, _ModelProbeDart>(
+        'ams_model_probe',
+      ),
       _prepareStart = library
           .lookupFunction<_PrepareStartNative, _PrepareStartDart>(
             'ams_prepare_start',
@@ -168,6 +434,14 @@ class AmsBindings {
           .lookupFunction<_PreparePollNative, _PreparePollDart>(
             'ams_prepare_poll',
           ),
+      _preparePollMany = library
+          .lookupFunction<_PollManyNative, _PollManyDart>(
+            'ams_prepare_poll_many',
+          ),
+      _prepareGetQueuePosition = library
+          .lookupFunction<_QueuePositionNative, _QueuePositionDart>(
+            'ams_prepare_get_queue_position',
+          ),
       _prepareCancel = library
           .lookupFunction<_PrepareCancelNative, _PrepareCancelDart>(
             'ams_prepare_cancel',
@@ -183,9 +457,24 @@ class AmsBindings {
       _jobStart = library.lookupFunction<_JobStartNative, _JobStartDart>(
         'ams_job_start',
       ),
+      _jobStartFromPrepare = library
+          .lookupFunction<_JobStartFromPrepareNative, _JobStartFromPrepareDart>(
+            'ams_job_start_from_prepare',
+          ),
+      _engineAutotune = library
+          .lookupFunction<_EngineAutotuneNative, _EngineAutotuneDart>(
+            'ams_engine_autotune',
+          ),
       _jobPoll = library.lookupFunction<_JobPollNative, _JobPollDart>(
         'ams_job_poll',
       ),
+      _jobPollMany = library.lookupFunction<_PollManyNative, _PollManyDart>(
+        'ams_job_poll_many',
+      ),
+      _jobGetQueuePosition = library
+          .lookupFunction<_QueuePositionNative, _QueuePositionDart>(
+            'ams_job_get_queue_position',
+          ),
       _jobCancel = library.lookupFunction<_JobCancelNative, _JobCancelDart>(
         'ams_job_cancel',
       ),
@@ -193,9 +482,31 @@ class AmsBindings {
           .lookupFunction<_JobGetResultNative, _JobGetResultDart>(
             'ams_job_get_result_json',
           ),
+      _jobGetStemCount = library
+          .lookupFunction<_JobGetStemCountNative, _JobGetStemCountDart>(
+            'ams_job_get_stem_count',
+          ),
+      _jobGetStem = library.lookupFunction<_JobGetStemNative, _JobGetStemDart>(
+        'ams_job_get_stem',
+      ),
+      _jobRetainStem = library
+          .lookupFunction<_JobRetainStemNative, _JobRetainStemDart>(
+            'ams_job_retain_stem',
+          ),
+      stemRelease = library.lookup<ffi.NativeFinalizerFunction>(
+        'ams_stem_release',
+      ),
       _jobDestroy = library.lookupFunction<_JobDestroyNative, _JobDestroyDart>(
         'ams_job_destroy',
       ),
+      _schedulerConfigure = library
+          .lookupFunction<_SchedulerConfigureNative, _SchedulerConfigureDart>(
+            'ams_scheduler_configure',
+          ),
+      _setEventCallback = library
+          .lookupFunction<_SetEventCallbackNative, _SetEventCallbackDart>(
+            'ams_set_event_callback',
+          ),
       _lastError = library.lookupFunction<_LastErrorNative, _LastErrorDart>(
         'ams_last_error',
       ),
@@ -214,18 +525,39 @@ class AmsBindings {
   final ffi.DynamicLibrary library;
 
   final _EngineOpenDart _engineOpen;
+  final _EngineOpenExDart _engineOpenEx;
+  final _EngineOpenAsyncDart _engineOpenAsync;
+  final _EngineLoadPollDart _engineLoadPoll;
+  final _EngineLoadHandleDart _engineLoadCancel;
+  final _EngineLoadTakeDart _engineLoadTakeEngine;
+  final _EngineLoadHandleDart _engineLoadDestroy;
   final _EngineGetDefaultsDart _engineGetDefaults;
   final _EngineCloseDart _engineClose;
+  final _ModelProbeDart _modelProbe;
   final _PrepareStartDart _prepareStart;
   final _PreparePollDart _preparePoll;
+  final _PollManyDart _preparePollMany;
+  final _QueuePositionDart _prepareGetQueuePosition;
   final _PrepareCancelDart _prepareCancel;
   final _PrepareGetResultDart _prepareGetResult;
   final _PrepareDestroyDart _prepareDestroy;
   final _JobStartDart _jobStart;
+  final _JobStartFromPrepareDart _jobStartFromPrepare;
+  final _EngineAutotuneDart _engineAutotune;
   final _JobPollDart _jobPoll;
+  final _PollManyDart _jobPollMany;
+  final _QueuePositionDart _jobGetQueuePosition;
   final _JobCancelDart _jobCancel;
   final _JobGetResultDart _jobGetResult;
+  final _JobGetStemCountDart _jobGetStemCount;
+  final _JobGetStemDart _jobGetStem;
+  final _JobRetainStemDart _jobRetainStem;
+
+  /// `ams_stem_release`, for finalizers of views made with [jobRetainStem].
+  final ffi.Pointer<ffi.NativeFinalizerFunction> stemRelease;
   final _JobDestroyDart _jobDestroy;
+  final _SchedulerConfigureDart _schedulerConfigure;
+  final _SetEventCallbackDart _setEventCallback;
   final _LastErrorDart _lastError;
   final _StringFreeDart _stringFree;
   final _RuntimeSetEnvDart _runtimeSetEnv;
@@ -237,6 +569,31 @@ class AmsBindings {
     ffi.Pointer<ffi.Uint64> outEngine,
   ) => _engineOpen(modelPath, backendPreference, outEngine);
 
+  int engineOpenEx(
+    ffi.Pointer<Utf8> modelPath,
+    ffi.Pointer<AmsEngineOpenOptions> options,
+    ffi.Pointer<ffi.Uint64> outEngine,
+  ) => _engineOpenEx(modelPath, options, outEngine);
+
+  int engineOpenAsync(
+    ffi.Pointer<Utf8> modelPath,
+    ffi.Pointer<AmsEngineOpenOptions> options,
+    ffi.Pointer<ffi.Uint64> outLoad,
+  ) => _engineOpenAsync(modelPath, options, outLoad);
+
+  int engineLoadPoll(
+    int load,
+    ffi.Pointer<ffi.Int32> outState,
+    ffi.Pointer<ffi.Double> outProgress,
+  ) => _engineLoadPoll(load, outState, outProgress);
+
+  int engineLoadCancel(int load) => _engineLoadCancel(load);
+
+  int engineLoadTakeEngine(int load, ffi.Pointer<ffi.Uint64> outEngine) =>
+      _engineLoadTakeEngine(load, outEngine);
+
+  int engineLoadDestroy(int load) => _engineLoadDestroy(load);
+
   int engineGetDefaults(
     int engine,
     ffi.Pointer<ffi.Int32> outChunkSize,
@@ -246,6 +603,11 @@ class AmsBindings {
 
   int engineClose(int engine) => _engineClose(engine);
 
+  int modelProbe(
+    ffi.Pointer<Utf8> modelPath,
+    ffi.Pointer<ffi.Pointer<Utf8>> outJson,
+  ) => _modelProbe(modelPath, outJson);
+
   int prepareStart(
     int engine,
     ffi.Pointer<AmsPrepareConfig> config,
@@ -259,6 +621,15 @@ class AmsBindings {
     ffi.Pointer<ffi.Int32> outStage,
   ) => _preparePoll(task, outState, outProgress, outStage);
 
+  int preparePollMany(
+    ffi.Pointer<ffi.Uint64> tasks,
+    int count,
+    ffi.Pointer<AmsTaskSnapshot> outSnapshots,
+  ) => _preparePollMany(tasks, count, outSnapshots);
+
+  int prepareGetQueuePosition(int task, ffi.Pointer<ffi.Int32> outPosition) =>
+      _prepareGetQueuePosition(task, outPosition);
+
   int prepareCancel(int task) => _prepareCancel(task);
 
   int prepareGetResult(int task, ffi.Pointer<ffi.Pointer<Utf8>> outJson) =>
@@ -272,6 +643,19 @@ class AmsBindings {
     ffi.Pointer<ffi.Uint64> outJob,
   ) => _jobStart(engine, config, outJob);
 
+  int engineAutotune(
+    int engine,
+    ffi.Pointer<AmsAutotuneConfig> config,
+    ffi.Pointer<ffi.Uint64> outJob,
+  ) => _engineAutotune(engine, config, outJob);
+
+  int jobStartFromPrepare(
+    int engine,
+    int prepare,
+    ffi.Pointer<AmsRunConfig> config,
+    ffi.Pointer<ffi.Uint64> outJob,
+  ) => _jobStartFromPrepare(engine, prepare, config, outJob);
+
   int jobPoll(
     int job,
     ffi.Pointer<ffi.Int32> outState,
@@ -279,13 +663,49 @@ class AmsBindings {
     ffi.Pointer<ffi.Int32> outStage,
   ) => _jobPoll(job, outState, outProgress, outStage);
 
+  int jobPollMany(
+    ffi.Pointer<ffi.Uint64> jobs,
+    int count,
+    ffi.Pointer<AmsTaskSnapshot> outSnapshots,
+  ) => _jobPollMany(jobs, count, outSnapshots);
+
+  int jobGetQueuePosition(int job, ffi.Pointer<ffi.Int32> outPosition) =>
+      _jobGetQueuePosition(job, outPosition);
+
   int jobCancel(int job) => _jobCancel(job);
 
   int jobGetResult(int job, ffi.Pointer<ffi.Pointer<Utf8>> outJson) =>
       _jobGetResult(job, outJson);
 
+  int jobGetStemCount(int job, ffi.Pointer<ffi.Int32> outCount) =>
+      _jobGetStemCount(job, outCount);
+
+  int jobGetStem(
+    int job,
+    int index,
+    ffi.Pointer<ffi.Pointer<ffi.Float>> outInterleaved,
+    ffi.Pointer<ffi.Int64> outFrames,
+  ) => _jobGetStem(job, index, outInterleaved, outFrames);
+
+  int jobRetainStem(
+    int job,
+    int index,
+    ffi.Pointer<ffi.Pointer<ffi.Float>> outInterleaved,
+    ffi.Pointer<ffi.Int64> outFrames,
+    ffi.Pointer<ffi.Pointer<ffi.Void>> outToken,
+  ) => _jobRetainStem(job, index, outInterleaved, outFrames, outToken);
+
   int jobDestroy(int job) => _jobDestroy(job);
 
+  int schedulerConfigure(int maxRunningJobs, int maxRunningPrepares) =>
+      _schedulerConfigure(maxRunningJobs, maxRunningPrepares);
+
+  int setEventCallback(
+    ffi.Pointer<ffi.NativeFunction<AmsEventCallbackNative>> callback,
+    ffi.Pointer<ffi.Void> userData,
+    double progressStep,
+  ) => _setEventCallback(callback, userData, progressStep);
+
   ffi.Pointer<Utf8> lastError() => _lastError();
 
   void stringFree(ffi.Pointer<Utf8> value) => _stringFree(value);
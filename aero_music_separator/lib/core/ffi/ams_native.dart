@@ -1,5 +1,8 @@
+import 'dart:async';
+import 'dart:convert';
 import 'dart:ffi' as ffi;
 import 'dart:io';
+import 'dart:typed_data';
 
 import 'package:ffi/ffi.dart';
 
@@ -45,6 +48,62 @@ class EngineDefaults {
   final int sampleRate;
 }
 
+/// Model metadata read from the GGUF header without loading the model.
+/// Numeric fields are 0 when the header does not carry them.
+class ModelProbeInfo {
+  ModelProbeInfo({
+    required this.chunkSize,
+    required this.overlap,
+    required this.sampleRate,
+    required this.stemCount,
+    required this.parameterCount,
+    required this.weightDtype,
+    required this.architecture,
+  });
+
+  factory ModelProbeInfo.fromJson(String rawJson) {
+    final dynamic decoded = jsonDecode(rawJson);
+    if (decoded is! Map<String, dynamic>) {
+      throw const FormatException('Invalid model probe payload');
+    }
+
+    final dynamic chunkSize = decoded['chunk_size'];
+    final dynamic overlap = decoded['num_overlap'];
+    final dynamic sampleRate = decoded['sample_rate'];
+    final dynamic stemCount = decoded['stem_count'];
+    final dynamic parameterCount = decoded['parameter_count'];
+    if (chunkSize is! int ||
+        overlap is! int ||
+        sampleRate is! int ||
+        stemCount is! int ||
+        parameterCount is! int) {
+      throw const FormatException('Missing fields in model probe payload');
+    }
+
+    final dynamic weightDtype = decoded['weight_dtype'];
+    final dynamic architecture = decoded['architecture'];
+    return ModelProbeInfo(
+      chunkSize: chunkSize,
+      overlap: overlap,
+      sampleRate: sampleRate,
+      stemCount: stemCount,
+      parameterCount: parameterCount,
+      weightDtype: weightDtype is String ? weightDtype : '',
+      architecture: architecture is String ? architecture : '',
+    );
+  }
+
+  final int chunkSize;
+  final int overlap;
+  final int sampleRate;
+  final int stemCount;
+  final int parameterCount;
+  final String weightDtype;
+  final String architecture;
+
+  bool get hasEngineDefaults => chunkSize > 0 && overlap > 0 && sampleRate > 0;
+}
+
 class NativePrepareSnapshot {
   NativePrepareSnapshot({
     required this.state,
@@ -62,11 +121,76 @@ class NativeJobSnapshot {
     required this.state,
     required this.stage,
     required this.progress,
+    this.queuePosition = -1,
   });
 
   final SeparationJobState state;
   final SeparationStage stage;
   final double progress;
+
+  /// Jobs queued ahead of this one while it is pending, -1 once started.
+  final int queuePosition;
+}
+
+class NativeEngineLoadSnapshot {
+  NativeEngineLoadSnapshot({required this.state, required this.progress});
+
+  final SeparationJobState state;
+
+  /// Share of the model file read so far; 1.0 once the engine is open.
+  final double progress;
+}
+
+enum NativeTaskKind { job, prepare }
+
+/// A job or prepare task change pushed by the native library. [state] and
+/// [stage] carry the same values [AmsSeparationNativeApi.pollJob] and
+/// [AmsPrepareNativeApi.pollPrepare] report.
+class NativeTaskEvent {
+  NativeTaskEvent({
+    required this.kind,
+    required this.handle,
+    required this.state,
+    required this.stage,
+    required this.progress,
+  });
+
+  final NativeTaskKind kind;
+  final int handle;
+  final int state;
+  final int stage;
+  final double progress;
+}
+
+/// Implemented by native APIs that can push task changes instead of being
+/// polled for them.
+abstract interface class AmsTaskEventSource {
+  /// Events for every job and prepare task, or null when the library cannot
+  /// deliver them and callers have to poll.
+  Stream<NativeTaskEvent>? get taskEvents;
+}
+
+/// Polls many tasks in one native call, each list entry matching the handle
+/// at the same index. Handles the library no longer knows map to null.
+abstract interface class AmsBatchPollNativeApi {
+  List<NativeJobSnapshot?> pollJobs(List<int> jobHandles);
+
+  List<NativePrepareSnapshot?> pollPrepares(List<int> prepareHandles);
+}
+
+abstract interface class AmsEngineLoadNativeApi {
+  int startEngineLoad(String modelPath, AmsBackend backend);
+
+  NativeEngineLoadSnapshot pollEngineLoad(int loadHandle);
+
+  void cancelEngineLoad(int loadHandle);
+
+  /// Hands the opened engine to the caller, who must close it.
+  int takeEngineFromLoad(int loadHandle);
+
+  void destroyEngineLoad(int loadHandle);
+
+  void closeEngine(int engineHandle);
 }
 
 abstract interface class AmsPrepareNativeApi {
@@ -75,6 +199,7 @@ abstract interface class AmsPrepareNativeApi {
     required String inputPath,
     required String workDir,
     String outputPrefix = 'input',
+    bool retainDecodedAudio = false,
   });
 
   NativePrepareSnapshot pollPrepare(int prepareHandle);
@@ -87,6 +212,8 @@ abstract interface class AmsPrepareNativeApi {
 }
 
 abstract interface class AmsSeparationNativeApi {
+  ModelProbeInfo probeModel(String modelPath);
+
   int openEngine(String modelPath, AmsBackend backend);
 
   EngineDefaults getDefaults(int engineHandle);
@@ -104,7 +231,36 @@ abstract interface class AmsSeparationNativeApi {
   void destroyJob(int jobHandle);
 }
 
-class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
+abstract interface class AmsAutotuneNativeApi {
+  int openEngine(String modelPath, AmsBackend backend);
+
+  void closeEngine(int engineHandle);
+
+  /// Starts an autotune job; it is polled, cancelled and destroyed like a
+  /// separation job.
+  int startAutotune(
+    int engineHandle, {
+    required String profilePath,
+    int trialSeconds = 0,
+  });
+
+  NativeJobSnapshot pollJob(int jobHandle);
+
+  void cancelJob(int jobHandle);
+
+  AutotuneResult autotuneResultForJob(int jobHandle);
+
+  void destroyJob(int jobHandle);
+}
+
+class AmsNative
+    implements
+        AmsAutotuneNativeApi,
+        AmsBatchPollNativeApi,
+        AmsEngineLoadNativeApi,
+        AmsPrepareNativeApi,
+        AmsSeparationNativeApi,
+        AmsTaskEventSource {
   AmsNative._() : _bindings = AmsBindings(_openLibrary());
 
   static final AmsNative instance = AmsNative._();
@@ -118,6 +274,12 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
 
   final AmsBindings _bindings;
 
+  /// Smallest progress change that produces an event on its own.
+  static const double _eventProgressStep = 0.005;
+
+  StreamController<NativeTaskEvent>? _taskEvents;
+  bool _taskEventsUnavailable = false;
+
   static ffi.DynamicLibrary _openLibrary() {
     if (Platform.isWindows) {
       return ffi.DynamicLibrary.open('aero_separator_ffi.dll');
@@ -182,6 +344,54 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
     }
   }
 
+  @override
+  Stream<NativeTaskEvent>? get taskEvents {
+    final existing = _taskEvents;
+    if (existing != null) {
+      return existing.stream;
+    }
+    if (_taskEventsUnavailable) {
+      return null;
+    }
+
+    final controller = StreamController<NativeTaskEvent>.broadcast();
+    // Lives as long as the process; the native side may call it from any
+    // worker thread and the events arrive here as isolate messages.
+    final callable = ffi.NativeCallable<AmsEventCallbackNative>.listener((
+      int kind,
+      int handle,
+      int state,
+      int stage,
+      double progress,
+      ffi.Pointer<ffi.Void> userData,
+    ) {
+      controller.add(
+        NativeTaskEvent(
+          kind: kind == 1 ? NativeTaskKind.prepare : NativeTaskKind.job,
+          handle: handle,
+          state: state,
+          stage: stage,
+          progress: progress.clamp(0.0, 1.0),
+        ),
+      );
+    });
+    callable.keepIsolateAlive = false;
+
+    final code = _bindings.setEventCallback(
+      callable.nativeFunction,
+      ffi.nullptr,
+      _eventProgressStep,
+    );
+    if (code != AmsNativeStatus.ok) {
+      callable.close();
+      controller.close();
+      _taskEventsUnavailable = true;
+      return null;
+    }
+    _taskEvents = controller;
+    return controller.stream;
+  }
+
   @override
   int openEngine(String modelPath, AmsBackend backend) {
     _ensureReadableFilePath(
@@ -190,17 +400,113 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
       subject: 'model',
     );
     final modelPathPtr = modelPath.toNativeUtf8();
+    final options = _engineOpenOptions(backend);
     final outEngine = calloc<ffi.Uint64>();
     try {
-      final code = _bindings.engineOpen(modelPathPtr, backend.value, outEngine);
+      final code = _bindings.engineOpenEx(modelPathPtr, options, outEngine);
       _ensureOk(code, prefix: 'engine open failed');
       return outEngine.value;
     } finally {
       calloc.free(modelPathPtr);
+      calloc.free(options);
+      calloc.free(outEngine);
+    }
+  }
+
+  ffi.Pointer<AmsEngineOpenOptions> _engineOpenOptions(AmsBackend backend) {
+    final options = calloc<AmsEngineOpenOptions>();
+    // Prefetching the model file overlaps disk reads with model parsing,
+    // which matters most for cold starts on mobile storage.
+    options.ref
+      ..backendPreference = backend.value
+      ..prefetchModelFile = 1;
+    return options;
+  }
+
+  @override
+  int startEngineLoad(String modelPath, AmsBackend backend) {
+    _ensureReadableFilePath(
+      modelPath,
+      stage: 'ffi_read',
+      subject: 'model',
+    );
+    final modelPathPtr = modelPath.toNativeUtf8();
+    final options = _engineOpenOptions(backend);
+    final outLoad = calloc<ffi.Uint64>();
+    try {
+      final code = _bindings.engineOpenAsync(modelPathPtr, options, outLoad);
+      _ensureOk(code, prefix: 'engine load start failed');
+      return outLoad.value;
+    } finally {
+      calloc.free(modelPathPtr);
+      calloc.free(options);
+      calloc.free(outLoad);
+    }
+  }
+
+  @override
+  NativeEngineLoadSnapshot pollEngineLoad(int loadHandle) {
+    final outState = calloc<ffi.Int32>();
+    final outProgress = calloc<ffi.Double>();
+    try {
+      final code = _bindings.engineLoadPoll(loadHandle, outState, outProgress);
+      _ensureOk(code, prefix: 'engine load poll failed');
+      return NativeEngineLoadSnapshot(
+        state: SeparationJobState.fromValue(outState.value),
+        progress: outProgress.value.clamp(0.0, 1.0),
+      );
+    } finally {
+      calloc.free(outState);
+      calloc.free(outProgress);
+    }
+  }
+
+  @override
+  void cancelEngineLoad(int loadHandle) {
+    final code = _bindings.engineLoadCancel(loadHandle);
+    _ensureOk(code, prefix: 'engine load cancel failed');
+  }
+
+  @override
+  int takeEngineFromLoad(int loadHandle) {
+    final outEngine = calloc<ffi.Uint64>();
+    try {
+      final code = _bindings.engineLoadTakeEngine(loadHandle, outEngine);
+      _ensureOk(code, prefix: 'engine load failed');
+      return outEngine.value;
+    } finally {
       calloc.free(outEngine);
     }
   }
 
+  @override
+  void destroyEngineLoad(int loadHandle) {
+    final code = _bindings.engineLoadDestroy(loadHandle);
+    _ensureOk(code, prefix: 'engine load destroy failed');
+  }
+
+  @override
+  ModelProbeInfo probeModel(String modelPath) {
+    final modelPathPtr = modelPath.toNativeUtf8();
+    final outResult = calloc<ffi.Pointer<Utf8>>();
+    try {
+      final code = _bindings.modelProbe(modelPathPtr, outResult);
+      _ensureOk(code, prefix: 'model probe failed');
+
+      final ptr = outResult.value;
+      if (ptr == ffi.nullptr) {
+        throw NativeFfiException('model probe result pointer is null', code);
+      }
+
+      final json = ptr.toDartString();
+      _bindings.stringFree(ptr);
+      return ModelProbeInfo.fromJson(json);
+    } finally {
+      calloc.free(modelPathPtr);
+      calloc.free(outResult);
+    }
+  }
+
   @override
   EngineDefaults getDefaults(int engineHandle) {
     final outChunk = calloc<ffi.Int32>();
@@ -238,6 +544,7 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
     required String inputPath,
     required String workDir,
     String outputPrefix = 'input',
+    bool retainDecodedAudio = false,
   }) {
     _ensureReadableFilePath(
       inputPath,
@@ -254,7 +561,8 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
       config.ref
         ..inputPath = inputPathPtr
         ..workDir = workDirPtr
-        ..outputPrefix = outputPrefixPtr;
+        ..outputPrefix = outputPrefixPtr
+        ..retainDecodedAudio = retainDecodedAudio ? 1 : 0;
 
       final code = _bindings.prepareStart(engineHandle, config, outPrepare);
       _ensureOk(code, prefix: 'prepare start failed');
@@ -270,27 +578,28 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
 
   @override
   NativePrepareSnapshot pollPrepare(int prepareHandle) {
-    final outState = calloc<ffi.Int32>();
-    final outProgress = calloc<ffi.Double>();
-    final outStage = calloc<ffi.Int32>();
-    try {
-      final code = _bindings.preparePoll(
-        prepareHandle,
-        outState,
-        outProgress,
-        outStage,
-      );
-      _ensureOk(code, prefix: 'prepare poll failed');
-      return NativePrepareSnapshot(
-        state: InputPrepareTaskState.fromValue(outState.value),
-        stage: InputPrepareStage.fromValue(outStage.value),
-        progress: outProgress.value.clamp(0.0, 1.0),
+    final snapshot = pollPrepares(<int>[prepareHandle]).single;
+    if (snapshot == null) {
+      throw NativeFfiException(
+        'prepare poll failed: prepare task not found',
+        AmsNativeStatus.notFound,
       );
-    } finally {
-      calloc.free(outState);
-      calloc.free(outProgress);
-      calloc.free(outStage);
     }
+    return snapshot;
+  }
+
+  @override
+  List<NativePrepareSnapshot?> pollPrepares(List<int> prepareHandles) {
+    return _pollMany(
+      prepareHandles,
+      _bindings.preparePollMany,
+      prefix: 'prepare poll failed',
+      toSnapshot: (raw) => NativePrepareSnapshot(
+        state: InputPrepareTaskState.fromValue(raw.state),
+        stage: InputPrepareStage.fromValue(raw.stage),
+        progress: raw.progress.clamp(0.0, 1.0),
+      ),
+    );
   }
 
   @override
@@ -340,6 +649,8 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
     final outputDir = request.outputDir.toNativeUtf8();
     final outputPrefix = request.outputPrefix.toNativeUtf8();
     final preparedInputPathPtr = request.preparedInputPath?.toNativeUtf8();
+    final resultCacheDirPtr = request.resultCacheDir?.toNativeUtf8();
+    final tuningProfilePathPtr = request.tuningProfilePath?.toNativeUtf8();
 
     final config = calloc<AmsRunConfig>();
     final outJob = calloc<ffi.Uint64>();
@@ -351,7 +662,32 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
         ..outputPrefix = outputPrefix
         ..outputFormat = request.outputFormat.value
         ..chunkSize = request.chunkSize
-        ..overlap = request.overlap;
+        ..overlap = request.overlap
+        ..executionMode = request.executionMode.value
+        ..resultCacheDir = resultCacheDirPtr ?? ffi.nullptr
+        ..priority = request.priority
+        ..tuningProfilePath = tuningProfilePathPtr ?? ffi.nullptr
+        ..silenceThresholdDb = request.silenceThresholdDb
+        ..replicas = request.replicas;
+
+      final prepareHandle = request.prepareHandle;
+      if (prepareHandle != null) {
+        final code = _bindings.jobStartFromPrepare(
+          engineHandle,
+          prepareHandle,
+          config,
+          outJob,
+        );
+        if (code == AmsNativeStatus.ok) {
+          return outJob.value;
+        }
+        // The retained buffer is gone or unusable; decode the canonical
+        // file instead.
+        if (code != AmsNativeStatus.notFound &&
+            code != AmsNativeStatus.runtime) {
+          _ensureOk(code, prefix: 'job start failed');
+        }
+      }
 
       final code = _bindings.jobStart(engineHandle, config, outJob);
       _ensureOk(code, prefix: 'job start failed');
@@ -363,6 +699,12 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
       if (preparedInputPathPtr != null) {
         calloc.free(preparedInputPathPtr);
       }
+      if (resultCacheDirPtr != null) {
+        calloc.free(resultCacheDirPtr);
+      }
+      if (tuningProfilePathPtr != null) {
+        calloc.free(tuningProfilePathPtr);
+      }
       calloc.free(config);
       calloc.free(outJob);
     }
@@ -370,26 +712,62 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
 
   @override
   NativeJobSnapshot pollJob(int jobHandle) {
-    final outState = calloc<ffi.Int32>();
-    final outProgress = calloc<ffi.Double>();
-    final outStage = calloc<ffi.Int32>();
-    try {
-      final code = _bindings.jobPoll(
-        jobHandle,
-        outState,
-        outProgress,
-        outStage,
-      );
-      _ensureOk(code, prefix: 'job poll failed');
-      return NativeJobSnapshot(
-        state: SeparationJobState.fromValue(outState.value),
-        stage: SeparationStage.fromValue(outStage.value),
-        progress: outProgress.value.clamp(0.0, 1.0),
+    // One batch call returns the queue position with the state, where
+    // ams_job_poll needed a second call for it.
+    final snapshot = pollJobs(<int>[jobHandle]).single;
+    if (snapshot == null) {
+      throw NativeFfiException(
+        'job poll failed: job not found',
+        AmsNativeStatus.notFound,
       );
+    }
+    return snapshot;
+  }
+
+  @override
+  List<NativeJobSnapshot?> pollJobs(List<int> jobHandles) {
+    return _pollMany(
+      jobHandles,
+      _bindings.jobPollMany,
+      prefix: 'job poll failed',
+      toSnapshot: (raw) => NativeJobSnapshot(
+        state: SeparationJobState.fromValue(raw.state),
+        stage: SeparationStage.fromValue(raw.stage),
+        progress: raw.progress.clamp(0.0, 1.0),
+        queuePosition: raw.queuePosition,
+      ),
+    );
+  }
+
+  List<T?> _pollMany<T>(
+    List<int> handles,
+    int Function(
+      ffi.Pointer<ffi.Uint64> handles,
+      int count,
+      ffi.Pointer<AmsTaskSnapshot> outSnapshots,
+    )
+    pollMany, {
+    required String prefix,
+    required T Function(AmsTaskSnapshot raw) toSnapshot,
+  }) {
+    if (handles.isEmpty) {
+      return <T?>[];
+    }
+    final nativeHandles = calloc<ffi.Uint64>(handles.length);
+    final outSnapshots = calloc<AmsTaskSnapshot>(handles.length);
+    try {
+      for (var i = 0; i < handles.length; i++) {
+        nativeHandles[i] = handles[i];
+      }
+      final code = pollMany(nativeHandles, handles.length, outSnapshots);
+      _ensureOk(code, prefix: prefix);
+      return List<T?>.generate(handles.length, (i) {
+        final raw = outSnapshots[i];
+        return raw.found != 0 ? toSnapshot(raw) : null;
+      }, growable: false);
     } finally {
-      calloc.free(outState);
-      calloc.free(outProgress);
-      calloc.free(outStage);
+      calloc.free(nativeHandles);
+      calloc.free(outSnapshots);
     }
   }
 
@@ -419,6 +797,94 @@ class AmsNative implements AmsPrepareNativeApi, AmsSeparationNativeApi {
     }
   }
 
+  @override
+  int startAutotune(
+    int engineHandle, {
+    required String profilePath,
+    int trialSeconds = 0,
+  }) {
+    final profilePathPtr = profilePath.toNativeUtf8();
+    final config = calloc<AmsAutotuneConfig>();
+    final outJob = calloc<ffi.Uint64>();
+    try {
+      config.ref
+        ..profilePath = profilePathPtr
+        ..trialSeconds = trialSeconds
+        ..chunkSizes = ffi.nullptr
+        ..chunkSizeCount = 0
+        ..priority = 0;
+      final code = _bindings.engineAutotune(engineHandle, config, outJob);
+      _ensureOk(code, prefix: 'autotune start failed');
+      return outJob.value;
+    } finally {
+      calloc.free(profilePathPtr);
+      calloc.free(config);
+      calloc.free(outJob);
+    }
+  }
+
+  @override
+  AutotuneResult autotuneResultForJob(int jobHandle) {
+    final outResult = calloc<ffi.Pointer<Utf8>>();
+    try {
+      final code = _bindings.jobGetResult(jobHandle, outResult);
+      _ensureOk(code, prefix: 'autotune result failed');
+
+      final ptr = outResult.value;
+      if (ptr == ffi.nullptr) {
+        throw NativeFfiException('autotune result pointer is null', code);
+      }
+
+      final json = ptr.toDartString();
+      _bindings.stringFree(ptr);
+      return AutotuneResult.fromJson(json);
+    } finally {
+      calloc.free(outResult);
+    }
+  }
+
+  /// Number of stems a succeeded [AmsOutputFormat.memory] job holds.
+  int stemCountForJob(int jobHandle) {
+    final outCount = calloc<ffi.Int32>();
+    try {
+      final code = _bindings.jobGetStemCount(jobHandle, outCount);
+      _ensureOk(code, prefix: 'job stem count failed');
+      return outCount.value;
+    } finally {
+      calloc.free(outCount);
+    }
+  }
+
+  /// Interleaved stereo samples of stem [index] of a succeeded
+  /// [AmsOutputFormat.memory] job, as a view of the native buffer without a
+  /// copy. The view holds its own reference to the buffer, released by a
+  /// finalizer once the list is garbage collected, so it stays valid after
+  /// [destroyJob].
+  Float32List stemForJob(int jobHandle, int index) {
+    final outInterleaved = calloc<ffi.Pointer<ffi.Float>>();
+    final outFrames = calloc<ffi.Int64>();
+    final outToken = calloc<ffi.Pointer<ffi.Void>>();
+    try {
+      final code = _bindings.jobRetainStem(
+        jobHandle,
+        index,
+        outInterleaved,
+        outFrames,
+        outToken,
+      );
+      _ensureOk(code, prefix: 'job stem failed');
+      return outInterleaved.value.asTypedList(
+        outFrames.value * 2,
+        finalizer: _bindings.stemRelease,
+        token: outToken.value,
+      );
+    } finally {
+      calloc.free(outInterleaved);
+      calloc.free(outFrames);
+      calloc.free(outToken);
+    }
+  }
+
   @override
   void destroyJob(int jobHandle) {
     final code = _bindings.jobDestroy(jobHandle);
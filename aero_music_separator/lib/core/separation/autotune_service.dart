@@ -0,0 +1,156 @@
+import 'dart:async';
+
+import '../ffi/ams_native.dart';
+import 'separation_models.dart';
+
+/// Measures chunk sizes for a model on this device and stores the fastest in
+/// the tuning profile, which later jobs read when chunk size and overlap are
+/// left on auto.
+class AutotuneService {
+  AutotuneService({AmsAutotuneNativeApi? native}) : _native = native;
+
+  AmsAutotuneNativeApi? _native;
+  final StreamController<double> _progressController =
+      StreamController<double>.broadcast();
+
+  Timer? _pollTimer;
+  Completer<AutotuneResult>? _resultCompleter;
+  int? _engineHandle;
+  int? _jobHandle;
+
+  /// Share of the trials finished by the running autotune.
+  Stream<double> get progress => _progressController.stream;
+
+  bool get isRunning =>
+      _resultCompleter != null && !_resultCompleter!.isCompleted;
+
+  AmsAutotuneNativeApi get _ffi => _native ??= AmsNative.instance;
+
+  Future<AutotuneResult> run({
+    required String modelPath,
+    required AmsBackend backend,
+    required String profilePath,
+    int trialSeconds = 0,
+  }) {
+    if (isRunning) {
+      throw StateError('An autotune is already running');
+    }
+
+    final completer = Completer<AutotuneResult>();
+    _resultCompleter = completer;
+
+    try {
+      _engineHandle = _ffi.openEngine(modelPath, backend);
+      _jobHandle = _ffi.startAutotune(
+        _engineHandle!,
+        profilePath: profilePath,
+        trialSeconds: trialSeconds,
+      );
+    } catch (e) {
+      _cleanupAfterJob();
+      return Future<AutotuneResult>.error(e);
+    }
+
+    _pollTimer = Timer.periodic(
+      const Duration(milliseconds: 250),
+      (_) => _pollTick(),
+    );
+    return completer.future;
+  }
+
+  void cancel() {
+    final jobHandle = _jobHandle;
+    if (jobHandle == null) {
+      return;
+    }
+    try {
+      _ffi.cancelJob(jobHandle);
+    } on NativeFfiException catch (e) {
+      if (e.code == AmsNativeStatus.cancelled ||
+          e.code == AmsNativeStatus.notFound) {
+        return;
+      }
+      rethrow;
+    }
+  }
+
+  void dispose() {
+    final completer = _resultCompleter;
+    _cleanupAfterJob();
+    if (completer != null && !completer.isCompleted) {
+      completer.completeError(
+        NativeCancelledException('Native autotune cancelled'),
+      );
+    }
+    _progressController.close();
+  }
+
+  void _pollTick() {
+    final completer = _resultCompleter;
+    final jobHandle = _jobHandle;
+    if (completer == null || completer.isCompleted || jobHandle == null) {
+      return;
+    }
+
+    try {
+      final snapshot = _ffi.pollJob(jobHandle);
+      if (!_progressController.isClosed) {
+        _progressController.add(snapshot.progress);
+      }
+
+      if (snapshot.state == SeparationJobState.succeeded) {
+        completer.complete(_ffi.autotuneResultForJob(jobHandle));
+        _cleanupAfterJob();
+        return;
+      }
+
+      if (snapshot.state == SeparationJobState.failed) {
+        try {
+          _ffi.autotuneResultForJob(jobHandle);
+          completer.completeError(StateError('Native autotune failed'));
+        } catch (e) {
+          completer.completeError(e);
+        }
+        _cleanupAfterJob();
+        return;
+      }
+
+      if (snapshot.state == SeparationJobState.cancelled) {
+        completer.completeError(
+          NativeCancelledException('Native autotune cancelled'),
+        );
+        _cleanupAfterJob();
+      }
+    } catch (e) {
+      completer.completeError(e);
+      _cleanupAfterJob();
+    }
+  }
+
+  void _cleanupAfterJob() {
+    _pollTimer?.cancel();
+    _pollTimer = null;
+
+    final jobHandle = _jobHandle;
+    _jobHandle = null;
+    if (jobHandle != null) {
+      try {
+        _ffi.destroyJob(jobHandle);
+      } catch (_) {
+        // Best effort cleanup.
+      }
+    }
+
+    final engineHandle = _engineHandle;
+    _engineHandle = null;
+    if (engineHandle != null) {
+      try {
+        _ffi.closeEngine(engineHandle);
+      } catch (_) {
+        // Best effort cleanup.
+      }
+    }
+
+    _resultCompleter = null;
+  }
+}
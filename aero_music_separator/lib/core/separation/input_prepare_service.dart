@@ -8,11 +8,16 @@ class InputPrepareRequest {
     required this.inputPath,
     required this.workDir,
     this.outputPrefix = 'input',
+    this.retainDecodedAudio = false,
   });
 
   final String inputPath;
   final String workDir;
   final String outputPrefix;
+
+  /// Keeps the decoded audio in native memory after a successful prepare so
+  /// a separation job can start from it; see [InputPrepareService.retainedPrepareHandle].
+  final bool retainDecodedAudio;
 }
 
 class InputPrepareService {
@@ -23,11 +28,18 @@ class InputPrepareService {
       StreamController<InputPrepareProgress>.broadcast();
 
   Timer? _pollTimer;
+  StreamSubscription<NativeTaskEvent>? _eventSubscription;
   Completer<InputPreviewInfo>? _resultCompleter;
   int? _prepareHandle;
+  bool _retainOnSuccess = false;
+  int? _retainedHandle;
 
   Stream<InputPrepareProgress> get progress => _progressController.stream;
 
+  /// Handle of the last successful prepare that retained its decoded audio.
+  /// It stays valid until the next [start] or [dispose].
+  int? get retainedPrepareHandle => _retainedHandle;
+
   bool get isRunning =>
       _resultCompleter != null && !_resultCompleter!.isCompleted;
 
@@ -38,8 +50,10 @@ class InputPrepareService {
       throw StateError('An input prepare task is already running');
     }
 
+    _releaseRetained();
     final completer = Completer<InputPreviewInfo>();
     _resultCompleter = completer;
+    _retainOnSuccess = request.retainDecodedAudio;
 
     try {
       _prepareHandle = _ffi.startPrepare(
@@ -47,6 +61,7 @@ class InputPrepareService {
         inputPath: request.inputPath,
         workDir: request.workDir,
         outputPrefix: request.outputPrefix,
+        retainDecodedAudio: request.retainDecodedAudio,
       );
 
       _publishProgress(
@@ -58,8 +73,12 @@ class InputPrepareService {
         ),
       );
 
+      final pushed = _listenForEvents(_prepareHandle!);
+      // With pushed events the timer is only a safety net.
       _pollTimer = Timer.periodic(
-        const Duration(milliseconds: 200),
+        pushed
+            ? const Duration(seconds: 1)
+            : const Duration(milliseconds: 200),
         (_) => _pollTick(),
       );
       return completer.future;
@@ -88,6 +107,8 @@ class InputPrepareService {
   void dispose() {
     _pollTimer?.cancel();
     _pollTimer = null;
+    _eventSubscription?.cancel();
+    _eventSubscription = null;
 
     final prepareHandle = _prepareHandle;
     _prepareHandle = null;
@@ -98,11 +119,29 @@ class InputPrepareService {
         // Best effort cleanup.
       }
     }
+    _releaseRetained();
 
     _progressController.close();
     _resultCompleter = null;
   }
 
+  bool _listenForEvents(int prepareHandle) {
+    final events = switch (_ffi) {
+      AmsTaskEventSource source => source.taskEvents,
+      _ => null,
+    };
+    if (events == null) {
+      return false;
+    }
+    _eventSubscription = events.listen((event) {
+      if (event.kind == NativeTaskKind.prepare &&
+          event.handle == prepareHandle) {
+        _pollTick();
+      }
+    });
+    return true;
+  }
+
   void _pollTick() {
     final completer = _resultCompleter;
     final prepareHandle = _prepareHandle;
@@ -123,6 +162,10 @@ class InputPrepareService {
 
       if (snapshot.state == InputPrepareTaskState.succeeded) {
         final result = _ffi.resultForPrepare(prepareHandle);
+        if (_retainOnSuccess) {
+          _retainedHandle = prepareHandle;
+          _prepareHandle = null;
+        }
         completer.complete(result);
         _cleanupAfterPrepare();
         return;
@@ -155,6 +198,8 @@ class InputPrepareService {
   void _cleanupAfterPrepare() {
     _pollTimer?.cancel();
     _pollTimer = null;
+    _eventSubscription?.cancel();
+    _eventSubscription = null;
 
     final prepareHandle = _prepareHandle;
     _prepareHandle = null;
@@ -169,6 +214,18 @@ class InputPrepareService {
     _resultCompleter = null;
   }
 
+  void _releaseRetained() {
+    final retainedHandle = _retainedHandle;
+    _retainedHandle = null;
+    if (retainedHandle != null) {
+      try {
+        _ffi.destroyPrepare(retainedHandle);
+      } catch (_) {
+        // Best effort cleanup.
+      }
+    }
+  }
+
   void _publishProgress(InputPrepareProgress progressEvent) {
     if (!_progressController.isClosed) {
       _progressController.add(progressEvent);
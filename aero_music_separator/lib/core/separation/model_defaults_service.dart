@@ -14,16 +14,31 @@ class ModelDefaults {
 }
 
 class ModelDefaultsService {
-  ModelDefaultsService({AmsNative? native}) : _native = native;
+  ModelDefaultsService({AmsSeparationNativeApi? native}) : _native = native;
 
-  AmsNative? _native;
+  AmsSeparationNativeApi? _native;
 
-  AmsNative get _ffi => _native ??= AmsNative.instance;
+  AmsSeparationNativeApi get _ffi => _native ??= AmsNative.instance;
 
   Future<ModelDefaults> loadDefaults({
     required String modelPath,
     required AmsBackend backend,
   }) async {
+    // The header probe avoids loading the whole model just to fill the form;
+    // models whose metadata lacks a default still get it from the engine.
+    try {
+      final probe = _ffi.probeModel(modelPath);
+      if (probe.hasEngineDefaults) {
+        return ModelDefaults(
+          chunkSize: probe.chunkSize,
+          overlap: probe.overlap,
+          sampleRate: probe.sampleRate,
+        );
+      }
+    } on Exception {
+      // Fall through; opening the engine reports the real failure.
+    }
+
     final handle = _ffi.openEngine(modelPath, backend);
     try {
       final defaults = _ffi.getDefaults(handle);
@@ -0,0 +1,161 @@
+import 'dart:async';
+
+import '../ffi/ams_native.dart';
+import 'separation_models.dart';
+
+/// Loads the selected model in the background and keeps one engine on it
+/// open, so the native engine pool holds the model warm for the next
+/// separation.
+class ModelPreloadService {
+  ModelPreloadService({AmsEngineLoadNativeApi? native}) : _native = native;
+
+  AmsEngineLoadNativeApi? _native;
+  final StreamController<double> _progressController =
+      StreamController<double>.broadcast();
+
+  Timer? _pollTimer;
+  Completer<void>? _loadCompleter;
+  int? _loadHandle;
+  int? _warmEngine;
+  String? _modelPath;
+  AmsBackend? _backend;
+
+  /// Share of the model file read by the running preload.
+  Stream<double> get progress => _progressController.stream;
+
+  bool get isLoading => _loadCompleter != null && !_loadCompleter!.isCompleted;
+
+  bool get isWarm => _warmEngine != null;
+
+  AmsEngineLoadNativeApi get _ffi => _native ??= AmsNative.instance;
+
+  /// Starts loading [modelPath] unless it is already loading or warm. A
+  /// different model replaces the previous preload.
+  Future<void> preload({
+    required String modelPath,
+    required AmsBackend backend,
+  }) {
+    if (_modelPath == modelPath && _backend == backend) {
+      final completer = _loadCompleter;
+      if (completer != null && !completer.isCompleted) {
+        return completer.future;
+      }
+      if (_warmEngine != null) {
+        return Future<void>.value();
+      }
+    }
+
+    release();
+    final completer = Completer<void>();
+    _loadCompleter = completer;
+    _modelPath = modelPath;
+    _backend = backend;
+
+    try {
+      _loadHandle = _ffi.startEngineLoad(modelPath, backend);
+    } catch (e) {
+      _cleanupAfterLoad();
+      _modelPath = null;
+      _backend = null;
+      return Future<void>.error(e);
+    }
+
+    _pollTimer = Timer.periodic(
+      const Duration(milliseconds: 200),
+      (_) => _pollTick(),
+    );
+    return completer.future;
+  }
+
+  /// Cancels a running preload and closes the warm engine. The model stays
+  /// in the native pool until its idle timeout.
+  void release() {
+    final completer = _loadCompleter;
+    final loadHandle = _loadHandle;
+    if (loadHandle != null) {
+      try {
+        _ffi.cancelEngineLoad(loadHandle);
+      } catch (_) {
+        // Destroy below still stops the load.
+      }
+    }
+    _cleanupAfterLoad();
+    if (completer != null && !completer.isCompleted) {
+      completer.completeError(
+        NativeCancelledException('Model preload cancelled'),
+      );
+    }
+
+    final warmEngine = _warmEngine;
+    _warmEngine = null;
+    if (warmEngine != null) {
+      try {
+        _ffi.closeEngine(warmEngine);
+      } catch (_) {
+        // Best effort cleanup.
+      }
+    }
+    _modelPath = null;
+    _backend = null;
+  }
+
+  void dispose() {
+    release();
+    _progressController.close();
+  }
+
+  void _pollTick() {
+    final completer = _loadCompleter;
+    final loadHandle = _loadHandle;
+    if (completer == null || completer.isCompleted || loadHandle == null) {
+      return;
+    }
+
+    try {
+      final snapshot = _ffi.pollEngineLoad(loadHandle);
+      _progressController.add(snapshot.progress);
+
+      if (snapshot.state == SeparationJobState.succeeded) {
+        _warmEngine = _ffi.takeEngineFromLoad(loadHandle);
+        completer.complete();
+        _cleanupAfterLoad();
+        return;
+      }
+
+      if (snapshot.state == SeparationJobState.failed ||
+          snapshot.state == SeparationJobState.cancelled) {
+        try {
+          _ffi.takeEngineFromLoad(loadHandle);
+          completer.completeError(StateError('Native model preload failed'));
+        } catch (e) {
+          completer.completeError(e);
+        }
+        _cleanupAfterLoad();
+        _modelPath = null;
+        _backend = null;
+      }
+    } catch (e) {
+      completer.completeError(e);
+      _cleanupAfterLoad();
+      _modelPath = null;
+      _backend = null;
+    }
+  }
+
+  void _cleanupAfterLoad() {
+    _pollTimer?.cancel();
+    _pollTimer = null;
+
+    final loadHandle = _loadHandle;
+    _loadHandle = null;
+    if (loadHandle != null) {
+      try {
+        _ffi.destroyEngineLoad(loadHandle);
+      } catch (_) {
+        // Best effort cleanup.
+      }
+    }
+
+    _loadCompleter = null;
+  }
+}
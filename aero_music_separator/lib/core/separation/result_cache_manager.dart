@@ -11,6 +11,7 @@ class ResultCacheManager {
   static const String _rootDirName = 'aero_music_separator';
   static const String _cacheDirName = 'result_cache';
   static const String _latestDirName = 'latest';
+  static const String _stemCacheDirName = 'stems';
 
   Future<Directory> _baseTempDirectory() async {
     final provider = _tempDirProvider;
@@ -29,6 +30,19 @@ class ResultCacheManager {
     );
   }
 
+  /// Directory for the native stem cache. It sits next to `latest` and is
+  /// kept across runs; the native side bounds its size.
+  Future<String> stemCacheDir() async {
+    final base = await _baseTempDirectory();
+    final dir = Directory(
+      '${base.path}${Platform.pathSeparator}$_rootDirName'
+      '${Platform.pathSeparator}$_cacheDirName'
+      '${Platform.pathSeparator}$_stemCacheDirName',
+    );
+    await dir.create(recursive: true);
+    return dir.path;
+  }
+
   Future<void> clearLatestRunDir() async {
     final dir = await _latestRunDirectory();
     if (await dir.exists()) {
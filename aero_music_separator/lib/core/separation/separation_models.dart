@@ -14,11 +14,30 @@ enum AmsBackend {
 enum AmsOutputFormat {
   wav(0, 'wav'),
   flac(1, 'flac'),
-  mp3(2, 'mp3');
+  mp3(2, 'mp3'),
+
+  /// Keeps the stems in native memory instead of writing files; read them
+  /// with `AmsNative.stemForJob` before destroying the job. The returned
+  /// lists keep their buffers alive after that.
+  memory(3, '');
 
   const AmsOutputFormat(this.value, this.extensionName);
   final int value;
   final String extensionName;
+
+  /// Formats that produce files the user can export.
+  static List<AmsOutputFormat> get fileFormats => values
+      .where((format) => format != AmsOutputFormat.memory)
+      .toList(growable: false);
+}
+
+enum AmsExecutionMode {
+  sequential(0),
+  pipelined(1),
+  segmented(2);
+
+  const AmsExecutionMode(this.value);
+  final int value;
 }
 
 enum SeparationJobState {
@@ -68,6 +87,13 @@ class SeparationRequest {
     this.chunkSize = -1,
     this.overlap = -1,
     this.backend = AmsBackend.auto,
+    this.executionMode = AmsExecutionMode.sequential,
+    this.prepareHandle,
+    this.resultCacheDir,
+    this.priority = 0,
+    this.tuningProfilePath,
+    this.silenceThresholdDb = 0,
+    this.replicas = 0,
   });
 
   final String modelPath;
@@ -79,6 +105,101 @@ class SeparationRequest {
   final int chunkSize;
   final int overlap;
   final AmsBackend backend;
+  final AmsExecutionMode executionMode;
+
+  /// Native prepare task that retained its decoded audio; when set the job
+  /// reads that buffer instead of decoding [preparedInputPath] again.
+  final int? prepareHandle;
+
+  /// Native separation result cache; a rerun of the same decoded audio with
+  /// the same model and settings skips inference. Pipelined jobs only use it
+  /// with a [prepareHandle]. Null disables it.
+  final String? resultCacheDir;
+
+  /// Queued jobs with a higher priority start first.
+  final int priority;
+
+  /// Autotune profile that supplies chunk size and overlap left at
+  /// their defaults, when it has an entry for this model on this device.
+  final String? tuningProfilePath;
+
+  /// Sequential and pipelined jobs skip inference for windows quieter than
+  /// this level in dBFS and output silence for them; 0 disables skipping.
+  /// Segmented jobs reject a non-zero value.
+  final double silenceThresholdDb;
+
+  /// Model instances a [AmsExecutionMode.segmented] job runs segments on at
+  /// the same time; 0 uses the native default.
+  final int replicas;
+}
+
+class AutotuneTrial {
+  AutotuneTrial({
+    required this.chunkSize,
+    required this.realTimeFactor,
+    required this.peakMemoryBytes,
+  });
+
+  final int chunkSize;
+  final double realTimeFactor;
+  final int peakMemoryBytes;
+}
+
+class AutotuneResult {
+  AutotuneResult({
+    required this.profilePath,
+    required this.chunkSize,
+    required this.overlap,
+    required this.realTimeFactor,
+    required this.peakMemoryBytes,
+    required this.trials,
+  });
+
+  final String profilePath;
+  final int chunkSize;
+  final int overlap;
+
+  /// Inference time divided by audio duration; below 1 is faster than real
+  /// time.
+  final double realTimeFactor;
+
+  /// Resident memory the best trial used above the level before it started.
+  final int peakMemoryBytes;
+  final List<AutotuneTrial> trials;
+
+  factory AutotuneResult.fromJson(String rawJson) {
+    final dynamic decoded = jsonDecode(rawJson);
+    if (decoded is! Map<String, dynamic>) {
+      throw const FormatException('Invalid autotune payload');
+    }
+    final dynamic trials = decoded['trials'];
+    return AutotuneResult(
+      profilePath: decoded['profile_path'] is String
+          ? decoded['profile_path'] as String
+          : '',
+      chunkSize: _asInt(decoded['chunk_size']),
+      overlap: _asInt(decoded['overlap']),
+      realTimeFactor: _asDouble(decoded['real_time_factor']),
+      peakMemoryBytes: _asInt(decoded['peak_memory_bytes']),
+      trials: trials is List
+          ? trials
+                .whereType<Map<String, dynamic>>()
+                .map(
+                  (trial) => AutotuneTrial(
+                    chunkSize: _asInt(trial['chunk_size']),
+                    realTimeFactor: _asDouble(trial['real_time_factor']),
+                    peakMemoryBytes: _asInt(trial['peak_memory_bytes']),
+                  ),
+                )
+                .toList(growable: false)
+          : const <AutotuneTrial>[],
+    );
+  }
+
+  static int _asInt(dynamic value) => value is num ? value.toInt() : 0;
+
+  static double _asDouble(dynamic value) =>
+      value is num ? value.toDouble() : 0.0;
 }
 
 class SeparationProgress {
@@ -101,6 +222,8 @@ class SeparationResult {
     required this.modelInputFile,
     required this.canonicalInputFile,
     required this.inferenceElapsedMs,
+    this.requestedBackend,
+    this.silenceSkippedSeconds = 0,
   });
 
   final List<String> outputFiles;
@@ -108,6 +231,13 @@ class SeparationResult {
   final String? canonicalInputFile;
   final int? inferenceElapsedMs;
 
+  /// Backend the engine's model was requested for, e.g. `CPU` or `Auto`.
+  /// The engine does not report the device it actually picked.
+  final String? requestedBackend;
+
+  /// Input duration that skipped inference as silence.
+  final double silenceSkippedSeconds;
+
   factory SeparationResult.fromJson(String rawJson) {
     final dynamic decoded = jsonDecode(rawJson);
     if (decoded is! Map<String, dynamic>) {
@@ -120,6 +250,8 @@ class SeparationResult {
     final dynamic modelInputFile = decoded['model_input_file'];
     final dynamic canonicalInputFile = decoded['canonical_input_file'];
     final dynamic inferenceElapsedMs = decoded['inference_elapsed_ms'];
+    final dynamic requestedBackend = decoded['requested_backend'];
+    final dynamic silenceSkippedSeconds = decoded['silence_skipped_seconds'];
     return SeparationResult(
       outputFiles: files.whereType<String>().toList(growable: false),
       modelInputFile: modelInputFile is String ? modelInputFile : null,
@@ -127,6 +259,14 @@ class SeparationResult {
           ? canonicalInputFile
           : null,
       inferenceElapsedMs: _parsePositiveInt(inferenceElapsedMs),
+      requestedBackend:
+          requestedBackend is String && requestedBackend.isNotEmpty
+          ? requestedBackend
+          : null,
+      silenceSkippedSeconds:
+          silenceSkippedSeconds is num && silenceSkippedSeconds > 0
+          ? silenceSkippedSeconds.toDouble()
+          : 0,
     );
   }
 
@@ -11,6 +11,7 @@ class SeparationTaskController {
       StreamController<SeparationProgress>.broadcast();
 
   Timer? _pollTimer;
+  StreamSubscription<NativeTaskEvent>? _eventSubscription;
   Completer<SeparationResult>? _resultCompleter;
   int? _engineHandle;
   int? _jobHandle;
@@ -34,6 +35,7 @@ class SeparationTaskController {
       _engineHandle = _ffi.openEngine(request.modelPath, request.backend);
 
       final defaults = _ffi.getDefaults(_engineHandle!);
+      final usesTuning = request.tuningProfilePath != null;
       final actualRequest = SeparationRequest(
         modelPath: request.modelPath,
         inputPath: request.inputPath,
@@ -41,11 +43,22 @@ class SeparationTaskController {
         outputDir: request.outputDir,
         outputPrefix: request.outputPrefix,
         outputFormat: request.outputFormat,
-        chunkSize: request.chunkSize > 0
+        // With a tuning profile, -1 lets the native side pick the tuned
+        // values and fall back to the model defaults itself.
+        chunkSize: request.chunkSize > 0 || usesTuning
             ? request.chunkSize
             : defaults.chunkSize,
-        overlap: request.overlap > 0 ? request.overlap : defaults.overlap,
+        overlap: request.overlap > 0 || usesTuning
+            ? request.overlap
+            : defaults.overlap,
         backend: request.backend,
+        executionMode: request.executionMode,
+        prepareHandle: request.prepareHandle,
+        resultCacheDir: request.resultCacheDir,
+        priority: request.priority,
+        tuningProfilePath: request.tuningProfilePath,
+        silenceThresholdDb: request.silenceThresholdDb,
+        replicas: request.replicas,
       );
 
       _jobHandle = _ffi.startJob(_engineHandle!, actualRequest);
@@ -59,8 +72,13 @@ class SeparationTaskController {
         ),
       );
 
+      final pushed = _listenForEvents(_jobHandle!);
+      // With pushed events the timer only refreshes the queue position,
+      // which changes without one.
       _pollTimer = Timer.periodic(
-        const Duration(milliseconds: 250),
+        pushed
+            ? const Duration(seconds: 1)
+            : const Duration(milliseconds: 250),
         (_) => _pollTick(),
       );
       return completer.future;
@@ -89,6 +107,8 @@ class SeparationTaskController {
   void dispose() {
     _pollTimer?.cancel();
     _pollTimer = null;
+    _eventSubscription?.cancel();
+    _eventSubscription = null;
 
     final jobHandle = _jobHandle;
     _jobHandle = null;
@@ -114,6 +134,22 @@ class SeparationTaskController {
     _resultCompleter = null;
   }
 
+  bool _listenForEvents(int jobHandle) {
+    final events = switch (_ffi) {
+      AmsTaskEventSource source => source.taskEvents,
+      _ => null,
+    };
+    if (events == null) {
+      return false;
+    }
+    _eventSubscription = events.listen((event) {
+      if (event.kind == NativeTaskKind.job && event.handle == jobHandle) {
+        _pollTick();
+      }
+    });
+    return true;
+  }
+
   void _pollTick() {
     final completer = _resultCompleter;
     final jobHandle = _jobHandle;
@@ -128,7 +164,11 @@ class SeparationTaskController {
           state: snapshot.state,
           stage: snapshot.stage,
           progress: snapshot.progress,
-          message: _messageFor(snapshot.state, snapshot.stage),
+          message: _messageFor(
+            snapshot.state,
+            snapshot.stage,
+            snapshot.queuePosition,
+          ),
         ),
       );
 
@@ -166,6 +206,8 @@ class SeparationTaskController {
   void _cleanupAfterJob() {
     _pollTimer?.cancel();
     _pollTimer = null;
+    _eventSubscription?.cancel();
+    _eventSubscription = null;
 
     final jobHandle = _jobHandle;
     _jobHandle = null;
@@ -196,7 +238,16 @@ class SeparationTaskController {
     }
   }
 
-  String _messageFor(SeparationJobState state, SeparationStage stage) {
+  String _messageFor(
+    SeparationJobState state,
+    SeparationStage stage,
+    int queuePosition,
+  ) {
+    if (state == SeparationJobState.pending && queuePosition >= 0) {
+      return queuePosition == 0
+          ? 'Queued, starting next'
+          : 'Queued behind $queuePosition job(s)';
+    }
     if (state == SeparationJobState.cancelled) {
       return 'Cancelled';
     }
@@ -5,6 +5,7 @@ import 'openmp_preset.dart';
 class AppSettingsStore {
   static const String _lastModelPathKey = 'last_model_path';
   static const String _forceCpuEnabledKey = 'force_cpu_enabled';
+  static const String _skipSilenceEnabledKey = 'skip_silence_enabled';
   static const String _openMpPresetKey = 'openmp_preset';
   static const String _localeOverrideKey = 'locale_override';
 
@@ -61,6 +62,16 @@ class AppSettingsStore {
     await prefs.setBool(_forceCpuEnabledKey, value);
   }
 
+  Future<bool> readSkipSilenceEnabled() async {
+    final prefs = await SharedPreferences.getInstance();
+    return prefs.getBool(_skipSilenceEnabledKey) ?? false;
+  }
+
+  Future<void> writeSkipSilenceEnabled(bool value) async {
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setBool(_skipSilenceEnabledKey, value);
+  }
+
   Future<OpenMpPreset> readOpenMpPreset() async {
     final prefs = await SharedPreferences.getInstance();
     final value = prefs.getString(_openMpPresetKey);
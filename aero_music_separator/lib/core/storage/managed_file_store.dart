@@ -13,6 +13,7 @@ class ManagedFileStore {
   static const String _rootDirName = 'aero_music_separator';
   static const String _modelDirName = 'models';
   static const String _activeModelFileName = 'active.gguf';
+  static const String _tuningProfileFileName = 'tuning_profile.txt';
 
   Future<String> resolveModelForSelection(
     PickedSourceFile source, {
@@ -98,6 +99,14 @@ class ManagedFileStore {
 
   Future<String> activeModelPath() => _activeModelPath();
 
+  /// Native autotune profile; entries are keyed by model file and device, so
+  /// one file serves every model.
+  Future<String> tuningProfilePath() async {
+    final base = await _appSupportDirectory();
+    return '${base.path}${Platform.pathSeparator}$_rootDirName'
+        '${Platform.pathSeparator}$_tuningProfileFileName';
+  }
+
   Future<Directory> _appSupportDirectory() async {
     final provider = _appSupportDirProvider;
     if (provider != null) {
@@ -251,6 +251,54 @@ abstract class AppLocalizations {
   /// **'Using model defaults: chunk={chunkSize}, overlap={overlap}'**
   String autoModeUsingDefaults(Object chunkSize, Object overlap);
 
+  /// No description provided for @autotuneButton.
+  ///
+  /// In en, this message translates to:
+  /// **'Tune for this device'**
+  String get autotuneButton;
+
+  /// No description provided for @autotuneCancelButton.
+  ///
+  /// In en, this message translates to:
+  /// **'Stop tuning'**
+  String get autotuneCancelButton;
+
+  /// No description provided for @autotuneRunning.
+  ///
+  /// In en, this message translates to:
+  /// **'Tuning... {percent}%'**
+  String autotuneRunning(Object percent);
+
+  /// No description provided for @autotuneHint.
+  ///
+  /// In en, this message translates to:
+  /// **'Auto mode uses the tuned settings once this model has been tuned on this device.'**
+  String get autotuneHint;
+
+  /// No description provided for @logAutotuneStarted.
+  ///
+  /// In en, this message translates to:
+  /// **'Tuning chunk size and threads for this device...'**
+  String get logAutotuneStarted;
+
+  /// No description provided for @logAutotuneDone.
+  ///
+  /// In en, this message translates to:
+  /// **'Tuned: chunk={chunkSize}, overlap={overlap}, real-time factor={rtf}'**
+  String logAutotuneDone(Object chunkSize, Object overlap, Object rtf);
+
+  /// No description provided for @logAutotuneCancelled.
+  ///
+  /// In en, this message translates to:
+  /// **'Tuning cancelled.'**
+  String get logAutotuneCancelled;
+
+  /// No description provided for @logAutotuneFailed.
+  ///
+  /// In en, this message translates to:
+  /// **'Tuning failed: {error}'**
+  String logAutotuneFailed(Object error);
+
   /// No description provided for @chunkSizeLabel.
   ///
   /// In en, this message translates to:
@@ -519,6 +567,18 @@ abstract class AppLocalizations {
   /// **'Canonical input: {path}'**
   String logCanonicalInput(Object path);
 
+  /// No description provided for @logInferenceBackend.
+  ///
+  /// In en, this message translates to:
+  /// **'Requested backend: {backend}'**
+  String logInferenceBackend(Object backend);
+
+  /// No description provided for @logSilenceSkipped.
+  ///
+  /// In en, this message translates to:
+  /// **'Skipped silence: {seconds}s'**
+  String logSilenceSkipped(Object seconds);
+
   /// No description provided for @logCancellingTask.
   ///
   /// In en, this message translates to:
@@ -615,6 +675,18 @@ abstract class AppLocalizations {
   /// **'Use CPU Inference'**
   String get settingsUseCpuInference;
 
+  /// No description provided for @settingsSkipSilence.
+  ///
+  /// In en, this message translates to:
+  /// **'Skip Silent Sections'**
+  String get settingsSkipSilence;
+
+  /// No description provided for @settingsSkipSilenceHint.
+  ///
+  /// In en, this message translates to:
+  /// **'Quiet passages below -60 dBFS are output as silence without running the model.'**
+  String get settingsSkipSilenceHint;
+
   /// No description provided for @settingsAndroidCpuOnlyNotice.
   ///
   /// In en, this message translates to:
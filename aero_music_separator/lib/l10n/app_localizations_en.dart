@@ -95,6 +95,38 @@ class AppLocalizationsEn extends AppLocalizations {
     return 'Using model defaults: chunk=$chunkSize, overlap=$overlap';
   }
 
+  @override
+  String get autotuneButton => 'Tune for this device';
+
+  @override
+  String get autotuneCancelButton => 'Stop tuning';
+
+  @override
+  String autotuneRunning(Object percent) {
+    return 'Tuning... $percent%';
+  }
+
+  @override
+  String get autotuneHint =>
+      'Auto mode uses the tuned settings once this model has been tuned on this device.';
+
+  @override
+  String get logAutotuneStarted =>
+      'Tuning chunk size and threads for this device...';
+
+  @override
+  String logAutotuneDone(Object chunkSize, Object overlap, Object rtf) {
+    return 'Tuned: chunk=$chunkSize, overlap=$overlap, real-time factor=$rtf';
+  }
+
+  @override
+  String get logAutotuneCancelled => 'Tuning cancelled.';
+
+  @override
+  String logAutotuneFailed(Object error) {
+    return 'Tuning failed: $error';
+  }
+
   @override
   String get chunkSizeLabel => 'Chunk Size';
 
@@ -264,6 +296,16 @@ class AppLocalizationsEn extends AppLocalizations {
     return 'Canonical input: $path';
   }
 
+  @override
+  String logInferenceBackend(Object backend) {
+    return 'Requested backend: $backend';
+  }
+
+  @override
+  String logSilenceSkipped(Object seconds) {
+    return 'Skipped silence: ${seconds}s';
+  }
+
   @override
   String get logCancellingTask => 'Cancelling separation task...';
 
@@ -326,6 +368,13 @@ class AppLocalizationsEn extends AppLocalizations {
   @override
   String get settingsUseCpuInference => 'Use CPU Inference';
 
+  @override
+  String get settingsSkipSilence => 'Skip Silent Sections';
+
+  @override
+  String get settingsSkipSilenceHint =>
+      'Quiet passages below -60 dBFS are output as silence without running the model.';
+
   @override
   String get settingsAndroidCpuOnlyNotice =>
       'Android uses CPU-only inference. Vulkan is disabled for stability and better overall performance.';
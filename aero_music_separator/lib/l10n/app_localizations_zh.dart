@@ -95,6 +95,36 @@ class AppLocalizationsZh extends AppLocalizations {
     return '使用模型默认值: chunk=$chunkSize, overlap=$overlap';
   }
 
+  @override
+  String get autotuneButton => '针对本机调优';
+
+  @override
+  String get autotuneCancelButton => '停止调优';
+
+  @override
+  String autotuneRunning(Object percent) {
+    return '调优中... $percent%';
+  }
+
+  @override
+  String get autotuneHint => '该模型在本机调优后，自动模式将使用调优结果。';
+
+  @override
+  String get logAutotuneStarted => '正在为本机调优分块大小与线程数...';
+
+  @override
+  String logAutotuneDone(Object chunkSize, Object overlap, Object rtf) {
+    return '调优完成: chunk=$chunkSize, overlap=$overlap, 实时率=$rtf';
+  }
+
+  @override
+  String get logAutotuneCancelled => '调优已取消。';
+
+  @override
+  String logAutotuneFailed(Object error) {
+    return '调优失败: $error';
+  }
+
   @override
   String get chunkSizeLabel => 'Chunk Size';
 
@@ -257,6 +287,16 @@ class AppLocalizationsZh extends AppLocalizations {
     return '标准化输入文件: $path';
   }
 
+  @override
+  String logInferenceBackend(Object backend) {
+    return '请求的推理后端: $backend';
+  }
+
+  @override
+  String logSilenceSkipped(Object seconds) {
+    return '跳过静音: $seconds 秒';
+  }
+
   @override
   String get logCancellingTask => '正在取消分离任务...';
 
@@ -317,6 +357,12 @@ class AppLocalizationsZh extends AppLocalizations {
   @override
   String get settingsUseCpuInference => '使用 CPU 推理';
 
+  @override
+  String get settingsSkipSilence => '跳过静音段';
+
+  @override
+  String get settingsSkipSilenceHint => '低于 -60 dBFS 的安静段落直接输出静音，不运行模型。';
+
   @override
   String get settingsAndroidCpuOnlyNotice =>
       'Android 当前固定为仅 CPU 推理。Vulkan 已为稳定性和整体性能禁用。';
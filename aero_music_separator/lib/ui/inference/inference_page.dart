@@ -11,9 +11,11 @@ import '../../core/audio/preview_player.dart';
 import '../../core/ffi/ams_native.dart';
 import '../../core/platform/file_access_service.dart';
 import '../../core/runtime/openmp_runtime_configurator.dart';
+import '../../core/separation/autotune_service.dart';
 import '../../core/separation/export_file_service.dart';
 import '../../core/separation/input_prepare_service.dart';
 import '../../core/separation/model_defaults_service.dart';
+import '../../core/separation/model_preload_service.dart';
 import '../../core/separation/result_cache_manager.dart';
 import '../../core/separation/separation_models.dart';
 import '../../core/separation/separation_service.dart';
@@ -76,6 +78,8 @@ class _InferencePageState extends State<InferencePage> {
   final FileAccessService _fileAccessService = FileAccessService();
   final ManagedFileStore _managedFileStore = ManagedFileStore();
   final ModelDefaultsService _modelDefaultsService = ModelDefaultsService();
+  final ModelPreloadService _modelPreloadService = ModelPreloadService();
+  final AutotuneService _autotuneService = AutotuneService();
   final ResultCacheManager _resultCacheManager = ResultCacheManager();
   final ExportFileService _exportFileService = ExportFileService();
   final OpenMpRuntimeConfigurator _openMpConfigurator =
@@ -83,6 +87,8 @@ class _InferencePageState extends State<InferencePage> {
   static const double _progressUpdateThreshold = 0.01;
   static const int _positionUpdateThresholdMs = 200;
   static const int _maxLogEntries = 300;
+  // dBFS level passed to jobs when the skip silence setting is on.
+  static const double _skipSilenceThresholdDb = -60;
 
   StreamSubscription<SeparationProgress>? _progressSubscription;
   StreamSubscription<InputPrepareProgress>? _prepareProgressSubscription;
@@ -106,6 +112,8 @@ class _InferencePageState extends State<InferencePage> {
   bool _running = false;
   bool _exporting = false;
   bool _loadingModelDefaults = false;
+  bool _tuning = false;
+  double _tuningProgress = 0;
   int _prepareGeneration = 0;
 
   ChunkOverlapMode _chunkOverlapMode = ChunkOverlapMode.auto;
@@ -266,6 +274,8 @@ class _InferencePageState extends State<InferencePage> {
 
     _taskController.dispose();
     _prepareService.dispose();
+    _modelPreloadService.dispose();
+    _autotuneService.dispose();
     unawaited(_previewPlayer.dispose());
 
     _modelPathController.dispose();
@@ -342,6 +352,9 @@ class _InferencePageState extends State<InferencePage> {
       if (picked == null) {
         return;
       }
+      // Importing replaces the managed model file in place; drop the warm
+      // engine so it does not keep the previous weights resident.
+      _modelPreloadService.release();
       final path = await _managedFileStore.resolveModelForSelection(
         picked,
         cacheModel: _isMobilePlatform,
@@ -457,6 +470,10 @@ class _InferencePageState extends State<InferencePage> {
       inputPath: inputPath,
       workDir: workDir,
       outputPrefix: _resolveOutputPrefix(),
+      // Keeping the decoded track resident skips a WAV round trip per run;
+      // mobile keeps the bounded-memory streaming path instead.
+      retainDecodedAudio:
+          Platform.isWindows || Platform.isLinux || Platform.isMacOS,
     );
 
     try {
@@ -595,6 +612,7 @@ class _InferencePageState extends State<InferencePage> {
           '${defaults.sampleRate}',
         ),
       );
+      _startModelPreload(modelPath: modelPath, backend: backend);
       return true;
     } catch (e) {
       if (mounted) {
@@ -614,6 +632,86 @@ class _InferencePageState extends State<InferencePage> {
     }
   }
 
+  /// Warms the model while the user is still picking an input so the first
+  /// separation does not wait for the load.
+  void _startModelPreload({
+    required String modelPath,
+    required AmsBackend backend,
+  }) {
+    unawaited(
+      _modelPreloadService
+          .preload(modelPath: modelPath, backend: backend)
+          .catchError((Object e) {
+            if (!_isCancelledError(e)) {
+              _appendLog('model_preload: $e');
+            }
+          }),
+    );
+  }
+
+  Future<void> _runAutotune() async {
+    if (_tuning || _running || !_nativeRuntimeSupported) {
+      return;
+    }
+    final modelPath = _modelPathController.text.trim();
+    if (modelPath.isEmpty) {
+      _reportError(_l10n.logModelPathRequired);
+      return;
+    }
+
+    final forceCpuSetting = await _settingsStore.readForceCpuEnabled();
+    final backend = _backendFor(_effectiveForceCpu(forceCpuSetting));
+    final profilePath = await _managedFileStore.tuningProfilePath();
+    if (!mounted) {
+      return;
+    }
+
+    _updateState(() {
+      _tuning = true;
+      _tuningProgress = 0;
+    });
+    _appendLog(_l10n.logAutotuneStarted);
+    final progressSubscription = _autotuneService.progress.listen((value) {
+      if (mounted) {
+        _updateState(() {
+          _tuningProgress = value;
+        });
+      }
+    });
+
+    try {
+      final result = await _autotuneService.run(
+        modelPath: modelPath,
+        backend: backend,
+        profilePath: profilePath,
+      );
+      if (mounted) {
+        _appendLog(
+          _l10n.logAutotuneDone(
+            result.chunkSize,
+            result.overlap,
+            result.realTimeFactor.toStringAsFixed(3),
+          ),
+        );
+      }
+    } catch (e) {
+      if (mounted) {
+        if (_isCancelledError(e)) {
+          _appendLog(_l10n.logAutotuneCancelled);
+        } else {
+          _reportError(_l10n.logAutotuneFailed('$e'));
+        }
+      }
+    } finally {
+      await progressSubscription.cancel();
+      if (mounted) {
+        _updateState(() {
+          _tuning = false;
+        });
+      }
+    }
+  }
+
   int? _parsePositiveInt(String value) {
     final parsed = int.tryParse(value.trim());
     if (parsed == null || parsed <= 0) {
@@ -672,7 +770,9 @@ class _InferencePageState extends State<InferencePage> {
       overlap = parsedOverlap;
     }
 
+    final skipSilence = await _settingsStore.readSkipSilenceEnabled();
     final outputDir = await _resultCacheManager.prepareLatestRunDir();
+    final stemCacheDir = await _resultCacheManager.stemCacheDir();
     final request = SeparationRequest(
       modelPath: modelPath,
       inputPath: _sourceInputPath!,
@@ -683,6 +783,12 @@ class _InferencePageState extends State<InferencePage> {
       chunkSize: chunkSize,
       overlap: overlap,
       backend: backend,
+      prepareHandle: _prepareService.retainedPrepareHandle,
+      resultCacheDir: stemCacheDir,
+      tuningProfilePath: _chunkOverlapMode == ChunkOverlapMode.auto
+          ? await _managedFileStore.tuningProfilePath()
+          : null,
+      silenceThresholdDb: skipSilence ? _skipSilenceThresholdDb : 0,
     );
 
     _updateState(() {
@@ -738,6 +844,16 @@ class _InferencePageState extends State<InferencePage> {
       if (result.canonicalInputFile != null) {
         _appendLog(_l10n.logCanonicalInput(result.canonicalInputFile!));
       }
+      if (result.requestedBackend != null) {
+        _appendLog(_l10n.logInferenceBackend(result.requestedBackend!));
+      }
+      if (result.silenceSkippedSeconds > 0) {
+        _appendLog(
+          _l10n.logSilenceSkipped(
+            result.silenceSkippedSeconds.toStringAsFixed(1),
+          ),
+        );
+      }
     } catch (e) {
       if (_isCancelledError(e)) {
         _appendLog(_l10n.logTaskCancelled);
@@ -1160,6 +1276,7 @@ class _InferencePageState extends State<InferencePage> {
     final canStart =
         _nativeRuntimeSupported &&
         !_running &&
+        !_tuning &&
         !_exporting &&
         _previewState == InputPreviewState.ready &&
         !_loadingModelDefaults;
@@ -1286,7 +1403,7 @@ class _InferencePageState extends State<InferencePage> {
           DropdownButtonFormField<AmsOutputFormat>(
             initialValue: _outputFormat,
             decoration: InputDecoration(labelText: l10n.outputLabel),
-            items: AmsOutputFormat.values
+            items: AmsOutputFormat.fileFormats
                 .map(
                   (value) =>
                       DropdownMenuItem(value: value, child: Text(value.name)),
@@ -1330,7 +1447,7 @@ class _InferencePageState extends State<InferencePage> {
                   },
           ),
           const SizedBox(height: 8),
-          if (_chunkOverlapMode == ChunkOverlapMode.auto)
+          if (_chunkOverlapMode == ChunkOverlapMode.auto) ...<Widget>[
             Text(
               defaults == null
                   ? l10n.autoModeRequiresModel
@@ -1338,8 +1455,32 @@ class _InferencePageState extends State<InferencePage> {
                       '${defaults.chunkSize}',
                       '${defaults.overlap}',
                     ),
-            )
-          else
+            ),
+            const SizedBox(height: 4),
+            Text(l10n.autotuneHint),
+            Wrap(
+              spacing: 12,
+              crossAxisAlignment: WrapCrossAlignment.center,
+              children: <Widget>[
+                TextButton(
+                  onPressed: !_nativeRuntimeSupported || _running
+                      ? null
+                      : _tuning
+                      ? _autotuneService.cancel
+                      : _runAutotune,
+                  child: Text(
+                    _tuning ? l10n.autotuneCancelButton : l10n.autotuneButton,
+                  ),
+                ),
+                if (_tuning)
+                  Text(
+                    l10n.autotuneRunning(
+                      (_tuningProgress * 100).toStringAsFixed(0),
+                    ),
+                  ),
+              ],
+            ),
+          ] else
             Row(
               children: <Widget>[
                 Expanded(
@@ -26,6 +26,7 @@ class _SettingsPageState extends State<SettingsPage> {
 
   bool _loading = true;
   bool _forceCpu = false;
+  bool _skipSilence = false;
   OpenMpPreset _openMpPreset = OpenMpPreset.auto;
   String? _localeOverride;
 
@@ -54,12 +55,14 @@ class _SettingsPageState extends State<SettingsPage> {
   Future<void> _load() async {
     final forceCpu = await _settingsStore.readForceCpuEnabled();
     final preset = await _settingsStore.readOpenMpPreset();
+    final skipSilence = await _settingsStore.readSkipSilenceEnabled();
     if (!mounted) {
       return;
     }
     setState(() {
       _forceCpu = forceCpu;
       _openMpPreset = preset;
+      _skipSilence = skipSilence;
       _loading = false;
     });
   }
@@ -71,6 +74,13 @@ class _SettingsPageState extends State<SettingsPage> {
     await _settingsStore.writeForceCpuEnabled(value);
   }
 
+  Future<void> _updateSkipSilence(bool value) async {
+    setState(() {
+      _skipSilence = value;
+    });
+    await _settingsStore.writeSkipSilenceEnabled(value);
+  }
+
   Future<void> _updatePreset(OpenMpPreset value) async {
     setState(() {
       _openMpPreset = value;
@@ -126,6 +136,13 @@ class _SettingsPageState extends State<SettingsPage> {
                     value: _forceCpu,
                     onChanged: _updateForceCpu,
                   ),
+                SwitchListTile(
+                  contentPadding: EdgeInsets.zero,
+                  title: Text(l10n.settingsSkipSilence),
+                  subtitle: Text(l10n.settingsSkipSilenceHint),
+                  value: _skipSilence,
+                  onChanged: _updateSkipSilence,
+                ),
                 DropdownButtonFormField<OpenMpPreset>(
                   initialValue: _openMpPreset,
                   decoration: InputDecoration(labelText: l10n.settingsOpenMpPreset),
@@ -0,0 +1,121 @@
+// Encodes a synthetic stereo stem with and without frame/packet reuse and
+// reports wall time and FFmpeg frame/packet allocations per stem.
+//
+// Usage: ams_encode_bench [wav|flac|mp3] [seconds] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ffmpeg_encode.h"
+
+namespace {
+
+constexpr int kSampleRate = 44100;
+constexpr int64_t kWriteBlockFrames = 1 << 14;
+
+int32_t ParseFormat(const std::string& name) {
+  if (name == "flac") {
+    return AMS_OUTPUT_FLAC;
+  }
+  if (name == "mp3") {
+    return AMS_OUTPUT_MP3;
+  }
+  return AMS_OUTPUT_WAV;
+}
+
+std::vector<float> MakeSignal(int seconds) {
+  const size_t frames = static_cast<size_t>(seconds) * kSampleRate;
+  std::vector<float> audio(frames * 2);
+  uint32_t noise = 0x12345678u;
+  for (size_t i = 0; i < frames; ++i) {
+    noise = noise * 1664525u + 1013904223u;
+    const float n = static_cast<float>(noise >> 8) / 16777216.0f - 0.5f;
+    const float t = static_cast<float>(i) / kSampleRate;
+    audio[i * 2] = 0.4f * std::sin(2.0f * 3.14159265f * 440.0f * t) + 0.05f * n;
+    audio[i * 2 + 1] = 0.4f * std::sin(2.0f * 3.14159265f * 660.0f * t) - 0.05f * n;
+  }
+  return audio;
+}
+
+struct RunResult {
+  double elapsed_ms = 0.0;
+  ams::EncoderStats stats;
+};
+
+bool EncodeOnce(const std::string& path,
+                const std::vector<float>& audio,
+                int32_t format,
+                bool reuse,
+                RunResult* result) {
+  ams::StreamingEncoder encoder;
+  encoder.SetBufferReuse(reuse);
+  std::string error;
+
+  const auto begin = std::chrono::steady_clock::now();
+  if (!encoder.Open(path, kSampleRate, format, &error)) {
+    std::fprintf(stderr, "open failed: %s\n", error.c_str());
+    return false;
+  }
+  const int64_t total = static_cast<int64_t>(audio.size() / 2);
+  for (int64_t offset = 0; offset < total; offset += kWriteBlockFrames) {
+    const int64_t frames = std::min(kWriteBlockFrames, total - offset);
+    if (!encoder.Write(audio.data() + offset * 2, frames, &error)) {
+      std::fprintf(stderr, "write failed: %s\n", error.c_str());
+      return false;
+    }
+  }
+  if (!encoder.Finish(&error)) {
+    std::fprintf(stderr, "finish failed: %s\n", error.c_str());
+    return false;
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  result->elapsed_ms = std::chrono::duration<double, std::milli>(end - begin).count();
+  result->stats = encoder.Stats();
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string format_name = argc > 1 ? argv[1] : "wav";
+  const int seconds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 300;
+  const int iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 5;
+  const int32_t format = ParseFormat(format_name);
+
+  const std::vector<float> audio = MakeSignal(seconds);
+  const std::filesystem::path path = std::filesystem::temp_directory_path() /
+      (std::string("ams_encode_bench.") + ams::OutputFormatExtension(format));
+
+  std::printf("format=%s seconds=%d iterations=%d\n", format_name.c_str(), seconds, iterations);
+  for (const bool reuse : {false, true}) {
+    double best_ms = 0.0;
+    RunResult last;
+    for (int i = 0; i < iterations; ++i) {
+      RunResult run;
+      if (!EncodeOnce(path.string(), audio, format, reuse, &run)) {
+        return 1;
+      }
+      best_ms = i == 0 ? run.elapsed_ms : std::min(best_ms, run.elapsed_ms);
+      last = run;
+    }
+    std::printf(
+        "%-8s best=%.1f ms frames=%lld packets=%lld frame_allocs=%lld packet_allocs=%lld\n",
+        reuse ? "pooled" : "per-call",
+        best_ms,
+        static_cast<long long>(last.stats.frames_encoded),
+        static_cast<long long>(last.stats.packets_written),
+        static_cast<long long>(last.stats.frame_allocations),
+        static_cast<long long>(last.stats.packet_allocations));
+  }
+
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  return 0;
+}
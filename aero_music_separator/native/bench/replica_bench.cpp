@@ -0,0 +1,115 @@
+// Separates the same synthetic track with 1, 2, 4, ... model replicas and
+// reports wall time, real-time factor, speedup over one replica and the
+// largest sample difference from the one-replica output. Every replica runs
+// with ggml's default thread count, which Inference does not let callers
+// set, so K replicas start K times as many compute threads; the speedup
+// column shows what that oversubscription buys on this machine.
+//
+// Usage: ams_replica_bench <model.gguf> [seconds] [max_replicas]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "segmented_separation.h"
+
+namespace {
+
+std::vector<float> MakeSignal(int seconds, int sample_rate) {
+  const size_t frames = static_cast<size_t>(seconds) * static_cast<size_t>(sample_rate);
+  std::vector<float> audio(frames * 2);
+  uint32_t noise = 0x12345678u;
+  for (size_t i = 0; i < frames; ++i) {
+    noise = noise * 1664525u + 1013904223u;
+    const float n = static_cast<float>(noise >> 8) / 16777216.0f - 0.5f;
+    const float t = static_cast<float>(i) / static_cast<float>(sample_rate);
+    audio[i * 2] = 0.4f * std::sin(2.0f * 3.14159265f * 220.0f * t) + 0.1f * n;
+    audio[i * 2 + 1] = 0.4f * std::sin(2.0f * 3.14159265f * 330.0f * t) - 0.1f * n;
+  }
+  return audio;
+}
+
+double MaxDifference(const ams::StemBlocks& a, const ams::StemBlocks& b) {
+  double diff = 0.0;
+  for (size_t s = 0; s < a.size() && s < b.size(); ++s) {
+    for (size_t i = 0; i < a[s].size() && i < b[s].size(); ++i) {
+      diff = std::max(diff, static_cast<double>(std::fabs(a[s][i] - b[s][i])));
+    }
+  }
+  return diff;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <model.gguf> [seconds] [max_replicas]\n", argv[0]);
+    return 2;
+  }
+  const std::string model_path = argv[1];
+  const int seconds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 120;
+  const int max_replicas = argc > 3 ? std::max(1, std::atoi(argv[3])) : 4;
+
+  try {
+    std::vector<std::unique_ptr<Inference>> replicas;
+    replicas.push_back(std::make_unique<Inference>(model_path));
+    const int sample_rate = replicas.front()->GetSampleRate();
+    const std::vector<float> audio = MakeSignal(seconds, sample_rate);
+
+    ams::SegmentedConfig config;
+    config.chunk_size = replicas.front()->GetDefaultChunkSize();
+    config.overlap = replicas.front()->GetDefaultNumOverlap();
+
+    std::printf("seconds=%d chunk=%d overlap=%d hardware_threads=%u\n",
+                seconds,
+                config.chunk_size,
+                config.overlap,
+                std::thread::hardware_concurrency());
+    ams::StemBlocks reference;
+    double reference_ms = 0.0;
+    for (int k = 1; k <= max_replicas; k *= 2) {
+      while (static_cast<int>(replicas.size()) < k) {
+        replicas.push_back(std::make_unique<Inference>(model_path));
+      }
+      std::vector<Inference*> instances;
+      for (int i = 0; i < k; ++i) {
+        instances.push_back(replicas[static_cast<size_t>(i)].get());
+      }
+
+      ams::SegmentedResult result;
+      std::string error;
+      const auto begin = std::chrono::steady_clock::now();
+      if (!ams::RunSegmentedSeparation(
+              audio, instances, config, []() { return false; }, nullptr, &result, &error)) {
+        std::fprintf(stderr, "replicas=%d failed: %s\n", k, error.c_str());
+        return 1;
+      }
+      const auto end = std::chrono::steady_clock::now();
+      const double elapsed_ms = std::chrono::duration<double, std::milli>(end - begin).count();
+      if (k == 1) {
+        reference = result.stems;
+        reference_ms = elapsed_ms;
+      }
+
+      std::printf(
+          "replicas=%d segments=%zu time=%.1f ms rtf=%.3f speedup=%.2fx max_diff=%.3g\n",
+          k,
+          result.segments,
+          elapsed_ms,
+          elapsed_ms / 1000.0 / seconds,
+          reference_ms / elapsed_ms,
+          MaxDifference(reference, result.stems));
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "failed: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
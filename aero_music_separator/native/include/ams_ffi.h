@@ -16,6 +16,7 @@ extern "C" {
 typedef uint64_t ams_engine_t;
 typedef uint64_t ams_job_t;
 typedef uint64_t ams_prepare_t;
+typedef uint64_t ams_engine_load_t;
 
 typedef enum ams_code_e {
   AMS_OK = 0,
@@ -38,6 +39,9 @@ typedef enum ams_output_fmt_e {
   AMS_OUTPUT_WAV = 0,
   AMS_OUTPUT_FLAC = 1,
   AMS_OUTPUT_MP3 = 2,
+  // Nothing is encoded; the stems stay in the job as float buffers, read
+  // with ams_job_get_stem. `output_dir` may be NULL.
+  AMS_OUTPUT_MEMORY = 3,
 } ams_output_fmt_t;
 
 typedef enum ams_job_state_e {
@@ -59,11 +63,60 @@ typedef enum ams_job_stage_e {
 typedef enum ams_prepare_stage_e {
   AMS_PREPARE_STAGE_IDLE = 0,
   AMS_PREPARE_STAGE_DECODE = 1,
+  // Retired: resampling now happens inside DECODE, block by block, so prepare
+  // tasks never report this stage. The value stays reserved for ABI stability.
   AMS_PREPARE_STAGE_RESAMPLE = 2,
   AMS_PREPARE_STAGE_WRITE_CANONICAL = 3,
   AMS_PREPARE_STAGE_DONE = 4,
 } ams_prepare_stage_t;
 
+typedef enum ams_execution_mode_e {
+  // Separates the whole track in one call; peak memory grows with the track
+  // length times the stem count.
+  AMS_EXECUTION_SEQUENTIAL = 0,
+  // Streams decode, inference and encoding; finished regions go straight to
+  // the stem encoders (and the result cache file) and are released, so memory
+  // is bounded by chunk size, overlap and stem count.
+  AMS_EXECUTION_PIPELINED = 1,
+  // Splits the decoded track into overlapping segments separated at the same
+  // time on `replicas` instances of the model, then crossfades them together.
+  // Each replica holds its own copy of the weights and computes with ggml's
+  // own thread count, which cannot be set per instance, so K replicas run K
+  // times as many threads and oversubscribe a machine ggml already fills.
+  AMS_EXECUTION_SEGMENTED = 2,
+} ams_execution_mode_t;
+
+typedef enum ams_event_kind_e {
+  AMS_EVENT_JOB = 0,
+  AMS_EVENT_PREPARE = 1,
+} ams_event_kind_t;
+
+// `state` is an ams_job_state_t; `stage` is an ams_job_stage_t for jobs and
+// an ams_prepare_stage_t for prepare tasks. Called on the worker thread that
+// changed the task, so it must return quickly and must not call back into
+// the library.
+typedef void (*ams_event_callback_t)(int32_t kind,
+                                     uint64_t handle,
+                                     int32_t state,
+                                     int32_t stage,
+                                     double progress_0_1,
+                                     void* user_data);
+
+// One task's status as reported by ams_job_poll_many and
+// ams_prepare_poll_many.
+typedef struct ams_task_snapshot_s {
+  // 0 when the handle is unknown or destroyed; the other fields are then 0.
+  int32_t found;
+  int32_t state;
+  int32_t stage;
+  double progress_0_1;
+  // Queued tasks that start before this one; -1 once it has started.
+  int32_t queue_position;
+  // Estimated time left while running, from the progress rate so far; -1
+  // while queued or too early to tell, 0 once finished.
+  int64_t eta_ms;
+} ams_task_snapshot_t;
+
 typedef struct ams_run_config_s {
   const char* input_path;
   const char* prepared_input_path;
@@ -72,18 +125,125 @@ typedef struct ams_run_config_s {
   int32_t output_format;
   int32_t chunk_size;
   int32_t overlap;
+  int32_t execution_mode;
+  // Directory of the separation result cache; NULL or empty disables it.
+  // Pipelined jobs only use it when they start from audio already in memory
+  // (a retained prepare buffer or PCM), so they never decode up front.
+  const char* result_cache_dir;
+  // Byte cap of the result cache; 0 uses the default (4 GiB).
+  int64_t result_cache_max_bytes;
+  // Queued jobs with a higher priority start first; equal priorities start
+  // in submission order.
+  int32_t priority;
+  // Tuning profile written by ams_engine_autotune. When it has an entry for
+  // this model on this device, it supplies chunk_size and overlap left at
+  // -1. NULL or empty skips it.
+  const char* tuning_profile_path;
+  // Inference windows whose input RMS is below this level in dBFS (e.g. -60)
+  // are not run through the model and produce silence in every stem. 0 or
+  // above disables skipping. Sequential and pipelined jobs both honour it;
+  // ams_job_start rejects a negative value in segmented mode. The result
+  // JSON reports the skipped input as "silence_skipped_seconds".
+  double silence_threshold_db;
+  // Segmented mode only: model instances to run segments on, 1 to 16; 0
+  // selects 2.
+  int32_t replicas;
 } ams_run_config_t;
 
 typedef struct ams_prepare_config_s {
   const char* input_path;
   const char* work_dir;
   const char* output_prefix;
+  // Non-zero keeps the decoded f32 audio in memory for
+  // ams_job_start_from_prepare until the task is destroyed. The buffer is
+  // available once decoding is done; the canonical WAV is then written on a
+  // separate lane, and the task succeeds when that file is in place.
+  int32_t retain_decoded_audio;
+  // Byte cap of the canonical input cache under work_dir; 0 uses the default
+  // (2 GiB) and a negative value disables caching. The reported
+  // canonical_input_file is a hard link to (or copy of) the cache entry under
+  // work_dir, so evicting the entry never removes a file already handed out.
+  int64_t cache_max_bytes;
 } ams_prepare_config_t;
 
+typedef struct ams_autotune_config_s {
+  // Profile file to update; entries for other models and devices are kept.
+  const char* profile_path;
+  // Seconds of synthetic audio separated per trial; 0 uses 10 seconds.
+  int32_t trial_seconds;
+  // Chunk sizes to try; NULL or a count of 0 tries half, once and twice the
+  // model default.
+  const int32_t* chunk_sizes;
+  int32_t chunk_size_count;
+  int32_t priority;
+} ams_autotune_config_t;
+
+typedef struct ams_engine_open_options_s {
+  int32_t backend_preference;
+  // Non-zero asks the OS to read the whole model file into the page cache
+  // ahead of the loader (MADV_WILLNEED / PrefetchVirtualMemory), so the load
+  // does not stall on demand reads. This is a prefetch only: the loader
+  // reads the file itself and copies every tensor into backend buffers, so
+  // weights are never mapped or shared between engines.
+  int32_t prefetch_model_file;
+} ams_engine_open_options_t;
+
+typedef struct ams_engine_pool_stats_s {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  int32_t resident_models;
+  int32_t idle_models;
+  int64_t resident_bytes;
+} ams_engine_pool_stats_t;
+
+// Engines opened with the same model path and backend preference share one
+// loaded model while the file's size and mtime are unchanged; a replaced
+// file loads afresh. Closing the last handle leaves it resident for reuse.
+//
+// The model loader takes no backend argument and reads BSR_FORCE_CPU from
+// the process environment, so the preference is passed by setting that
+// variable for the duration of the load. Loads with different preferences
+// are therefore serialized, and the write can race with other threads
+// reading the environment. The result JSON's `requested_backend` is this
+// preference after platform policy; the loader does not report the device
+// it actually chose.
 AMS_EXPORT ams_code_t ams_engine_open(const char* model_path,
                                       int32_t backend_preference,
                                       ams_engine_t* out_engine);
 
+// ams_engine_open with load options. Options only affect a load; opening a
+// model that is already resident reuses it as is.
+AMS_EXPORT ams_code_t ams_engine_open_ex(const char* model_path,
+                                         const ams_engine_open_options_t* options,
+                                         ams_engine_t* out_engine);
+
+// Opens an engine on a background worker. Poll reports AMS_JOB_* states and
+// progress by how much of the model file is in the page cache, which follows
+// the loader's own reads; it holds near the end while backend buffers are
+// built, and does not move on platforms that cannot report residency.
+// Cancellation takes effect before the loader starts, including during a
+// prefetch; a load already constructing the model runs to completion and its
+// engine stays pooled. Once the load succeeds, take the engine with
+// ams_engine_load_take_engine and close it with ams_engine_close as usual.
+AMS_EXPORT ams_code_t ams_engine_open_async(const char* model_path,
+                                            const ams_engine_open_options_t* options,
+                                            ams_engine_load_t* out_load);
+
+AMS_EXPORT ams_code_t ams_engine_load_poll(ams_engine_load_t load,
+                                           int32_t* out_state,
+                                           double* out_progress_0_1);
+
+AMS_EXPORT ams_code_t ams_engine_load_cancel(ams_engine_load_t load);
+
+AMS_EXPORT ams_code_t ams_engine_load_take_engine(ams_engine_load_t load,
+                                                  ams_engine_t* out_engine);
+
+// Cancels the load and releases its handle without waiting for it to stop.
+// An engine that was never taken is closed, including one that finishes
+// loading after this call.
+AMS_EXPORT ams_code_t ams_engine_load_destroy(ams_engine_load_t load);
+
 AMS_EXPORT ams_code_t ams_engine_get_defaults(ams_engine_t engine,
                                               int32_t* out_chunk_size,
                                               int32_t* out_overlap,
@@ -91,6 +251,20 @@ AMS_EXPORT ams_code_t ams_engine_get_defaults(ams_engine_t engine,
 
 AMS_EXPORT ams_code_t ams_engine_close(ams_engine_t engine);
 
+// Reads model metadata (sample rate, default chunk size and overlap, stem
+// count, parameter count, weight dtype) from the GGUF header without loading
+// the model. Fields the header does not carry are 0 or empty. Free the JSON
+// with ams_string_free.
+AMS_EXPORT ams_code_t ams_model_probe(const char* model_path, const char** out_json_utf8);
+
+// Idle models are released after `idle_ttl_ms` (default 5 minutes) and, least
+// recently used first, whenever resident models exceed `max_resident_bytes`
+// (default 2 GiB, measured by model file size). Negative values keep the
+// current setting.
+AMS_EXPORT ams_code_t ams_engine_pool_configure(int64_t idle_ttl_ms, int64_t max_resident_bytes);
+
+AMS_EXPORT ams_code_t ams_engine_pool_get_stats(ams_engine_pool_stats_t* out_stats);
+
 AMS_EXPORT ams_code_t ams_prepare_start(ams_engine_t engine,
                                         const ams_prepare_config_t* config,
                                         ams_prepare_t* out_prepare);
@@ -100,6 +274,18 @@ AMS_EXPORT ams_code_t ams_prepare_poll(ams_prepare_t task,
                                        double* out_progress_0_1,
                                        int32_t* out_stage);
 
+// Queued tasks report AMS_JOB_PENDING; `out_position` is how many queued
+// tasks start before this one, or -1 once it has started.
+AMS_EXPORT ams_code_t ams_prepare_get_queue_position(ams_prepare_t task,
+                                                     int32_t* out_position);
+
+// Polls `count` prepare tasks in one call, filling `out_snapshots[i]` for
+// `tasks[i]`. Unknown handles do not fail the call; their snapshot has
+// `found` = 0.
+AMS_EXPORT ams_code_t ams_prepare_poll_many(const ams_prepare_t* tasks,
+                                            int32_t count,
+                                            ams_task_snapshot_t* out_snapshots);
+
 AMS_EXPORT ams_code_t ams_prepare_cancel(ams_prepare_t task);
 
 AMS_EXPORT ams_code_t ams_prepare_get_result_json(ams_prepare_t task,
@@ -111,22 +297,112 @@ AMS_EXPORT ams_code_t ams_job_start(ams_engine_t engine,
                                     const ams_run_config_t* config,
                                     ams_job_t* out_job);
 
+// Starts a job on the decoded buffer retained by `prepare` instead of decoding
+// the canonical WAV again. It works as soon as the buffer is decoded, before
+// the prepare task succeeds; the buffer is resampled in memory when the model
+// runs at another rate. The buffer stays alive for the job even if the
+// prepare task is destroyed first.
+AMS_EXPORT ams_code_t ams_job_start_from_prepare(ams_engine_t engine,
+                                                 ams_prepare_t prepare,
+                                                 const ams_run_config_t* config,
+                                                 ams_job_t* out_job);
+
+// Starts a job on audio already in memory: `frames` frames of interleaved
+// f32 PCM with `channels` channels at `sample_rate`. Channel counts other
+// than two are mixed to stereo with FFmpeg's default layout and matrix for
+// that count, as decoding a file would, so mono plays at -3 dB per side. The
+// audio is copied once into the job's stereo buffer, so `interleaved` may be
+// freed when this returns; it is resampled in memory only when `sample_rate`
+// differs from the model's. `config` supplies everything but the input, and
+// its input paths may be NULL. No canonical or model input file is written,
+// so the result JSON reports those as empty.
+AMS_EXPORT ams_code_t ams_job_start_pcm(ams_engine_t engine,
+                                        const float* interleaved,
+                                        int64_t frames,
+                                        int32_t sample_rate,
+                                        int32_t channels,
+                                        const ams_run_config_t* config,
+                                        ams_job_t* out_job);
+
+// Times separation of synthetic audio for every chunk size in the grid, then
+// stores the one with the lowest real-time factor in the profile, keyed by
+// model file and device. Runs as a job: poll, cancel, read the result JSON
+// (best settings plus every trial's real-time factor and peak memory) and
+// destroy it with the ams_job_* functions.
+AMS_EXPORT ams_code_t ams_engine_autotune(ams_engine_t engine,
+                                          const ams_autotune_config_t* config,
+                                          ams_job_t* out_job);
+
 AMS_EXPORT ams_code_t ams_job_poll(ams_job_t job,
                                    int32_t* out_state,
                                    double* out_progress_0_1,
                                    int32_t* out_stage);
 
+AMS_EXPORT ams_code_t ams_job_get_queue_position(ams_job_t job, int32_t* out_position);
+
+// Polls `count` jobs in one call, filling `out_snapshots[i]` for `jobs[i]`.
+// Unknown handles do not fail the call; their snapshot has `found` = 0. Job
+// and prepare handles are numbered separately, hence the two functions.
+AMS_EXPORT ams_code_t ams_job_poll_many(const ams_job_t* jobs,
+                                        int32_t count,
+                                        ams_task_snapshot_t* out_snapshots);
+
 AMS_EXPORT ams_code_t ams_job_cancel(ams_job_t job);
 
 AMS_EXPORT ams_code_t ams_job_get_result_json(ams_job_t job,
                                               const char** out_json_utf8);
 
+// Number of stems a succeeded AMS_OUTPUT_MEMORY job holds; 0 for jobs that
+// wrote files.
+AMS_EXPORT ams_code_t ams_job_get_stem_count(ams_job_t job, int32_t* out_count);
+
+// Borrows stem `index` of a succeeded AMS_OUTPUT_MEMORY job: `out_frames`
+// frames of interleaved stereo f32 at the model's sample rate. The buffer
+// belongs to the job and stays valid, unchanged, until ams_job_destroy.
+AMS_EXPORT ams_code_t ams_job_get_stem(ams_job_t job,
+                                       int32_t index,
+                                       const float** out_interleaved,
+                                       int64_t* out_frames);
+
+// ams_job_get_stem that also keeps the buffer alive past ams_job_destroy:
+// it stays valid, unchanged, until `*out_token` is passed to
+// ams_stem_release. Lets callers wrap it as external typed data without a
+// copy and free it from a finalizer.
+AMS_EXPORT ams_code_t ams_job_retain_stem(ams_job_t job,
+                                          int32_t index,
+                                          const float** out_interleaved,
+                                          int64_t* out_frames,
+                                          void** out_token);
+
+// Releases a token from ams_job_retain_stem; NULL is ignored. Safe to call
+// from any thread, including a Dart finalizer.
+AMS_EXPORT void ams_stem_release(void* token);
+
 AMS_EXPORT ams_code_t ams_job_destroy(ams_job_t job);
 
+// Jobs and prepare tasks run on a shared worker pool; these cap how many of
+// each run at once (defaults: 1 job, 2 prepares). Values <= 0 keep the
+// current limit. Already running tasks are not interrupted.
+AMS_EXPORT ams_code_t ams_scheduler_configure(int32_t max_running_jobs,
+                                              int32_t max_running_prepares);
+
+// Reports job and prepare task changes as they happen, so callers can react
+// without polling: every state and stage change, and progress whenever it has
+// moved by `progress_step` (default 0.01 when <= 0) since the last event for
+// that task. Tasks cancelled while still queued report their final state as
+// well. One callback serves the whole process; NULL removes it. Once this
+// returns, the previous callback is no longer running or called. Polling
+// keeps working either way.
+AMS_EXPORT ams_code_t ams_set_event_callback(ams_event_callback_t callback,
+                                             void* user_data,
+                                             double progress_step);
+
 AMS_EXPORT const char* ams_last_error(void);
 
 AMS_EXPORT void ams_string_free(const char* ptr);
 
+// Never waits for an engine load: while one is constructing a model, the
+// write is queued and applied as soon as its backend flags are restored.
 AMS_EXPORT ams_code_t ams_runtime_set_env(const char* key, const char* value);
 
 AMS_EXPORT ams_code_t ams_runtime_unset_env(const char* key);
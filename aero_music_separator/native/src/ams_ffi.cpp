@@ -1,13 +1,21 @@
 #include "ams_ffi.h"
 
-#include <cstdlib>
 #include <exception>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "engine_load_manager.h"
 #include "engine_manager.h"
 #include "error_store.h"
+#include "ffmpeg_decode_resample.h"
 #include "job_manager.h"
+#include "json_result.h"
+#include "model_probe.h"
 #include "prepare_manager.h"
+#include "runtime_env.h"
+#include "task_events.h"
+#include "task_scheduler.h"
 
 namespace {
 
@@ -24,20 +32,29 @@ ams_code_t WrapCapi(Fn&& fn) {
   }
 }
 
-void SetEnvValue(const char* key, const char* value) {
-#ifdef _WIN32
-  _putenv_s(key, value);
-#else
-  setenv(key, value, 1);
-#endif
+bool HasOutputTarget(const ams_run_config_t& config) {
+  return config.output_dir != nullptr || config.output_format == AMS_OUTPUT_MEMORY;
 }
 
-void UnsetEnvValue(const char* key) {
-#ifdef _WIN32
-  _putenv_s(key, "");
-#else
-  unsetenv(key);
-#endif
+ams::JobConfig ToJobConfig(const ams_run_config_t& config) {
+  ams::JobConfig job_config;
+  job_config.input_path = config.input_path != nullptr ? config.input_path : "";
+  job_config.prepared_input_path =
+      config.prepared_input_path != nullptr ? config.prepared_input_path : "";
+  job_config.output_dir = config.output_dir != nullptr ? config.output_dir : "";
+  job_config.output_prefix = config.output_prefix != nullptr ? config.output_prefix : "separated";
+  job_config.output_format = config.output_format;
+  job_config.chunk_size = config.chunk_size;
+  job_config.overlap = config.overlap;
+  job_config.execution_mode = config.execution_mode;
+  job_config.result_cache_dir = config.result_cache_dir != nullptr ? config.result_cache_dir : "";
+  job_config.result_cache_max_bytes = config.result_cache_max_bytes;
+  job_config.priority = config.priority;
+  job_config.tuning_profile_path =
+      config.tuning_profile_path != nullptr ? config.tuning_profile_path : "";
+  job_config.silence_threshold_db = config.silence_threshold_db;
+  job_config.replicas = config.replicas;
+  return job_config;
 }
 
 }  // namespace
@@ -52,10 +69,56 @@ ams_code_t ams_engine_open(const char* model_path,
       ams::SetLastError("invalid argument: model_path");
       return AMS_ERR_INVALID_ARG;
     }
-    return ams::EngineManager::Instance().Open(model_path, backend_preference, out_engine);
+    ams_engine_open_options_t options{};
+    options.backend_preference = backend_preference;
+    return ams::EngineManager::Instance().Open(model_path, options, out_engine);
   });
 }
 
+ams_code_t ams_engine_open_ex(const char* model_path,
+                              const ams_engine_open_options_t* options,
+                              ams_engine_t* out_engine) {
+  return WrapCapi([&]() {
+    if (model_path == nullptr || options == nullptr) {
+      ams::SetLastError("invalid argument: model_path/options");
+      return AMS_ERR_INVALID_ARG;
+    }
+    return ams::EngineManager::Instance().Open(model_path, *options, out_engine);
+  });
+}
+
+ams_code_t ams_engine_open_async(const char* model_path,
+                                 const ams_engine_open_options_t* options,
+                                 ams_engine_load_t* out_load) {
+  return WrapCapi([&]() {
+    if (model_path == nullptr || options == nullptr) {
+      ams::SetLastError("invalid argument: model_path/options");
+      return AMS_ERR_INVALID_ARG;
+    }
+    return ams::EngineLoadManager::Instance().Start(model_path, *options, out_load);
+  });
+}
+
+ams_code_t ams_engine_load_poll(ams_engine_load_t load,
+                                int32_t* out_state,
+                                double* out_progress_0_1) {
+  return WrapCapi(
+      [&]() { return ams::EngineLoadManager::Instance().Poll(load, out_state, out_progress_0_1); });
+}
+
+ams_code_t ams_engine_load_cancel(ams_engine_load_t load) {
+  return WrapCapi([&]() { return ams::EngineLoadManager::Instance().Cancel(load); });
+}
+
+ams_code_t ams_engine_load_take_engine(ams_engine_load_t load, ams_engine_t* out_engine) {
+  return WrapCapi(
+      [&]() { return ams::EngineLoadManager::Instance().TakeEngine(load, out_engine); });
+}
+
+ams_code_t ams_engine_load_destroy(ams_engine_load_t load) {
+  return WrapCapi([&]() { return ams::EngineLoadManager::Instance().Destroy(load); });
+}
+
 ams_code_t ams_engine_get_defaults(ams_engine_t engine,
                                    int32_t* out_chunk_size,
                                    int32_t* out_overlap,
@@ -72,9 +135,37 @@ ams_code_t ams_engine_get_defaults(ams_engine_t engine,
       return AMS_ERR_NOT_FOUND;
     }
 
-    *out_chunk_size = engine_ctx->inference->GetDefaultChunkSize();
-    *out_overlap = engine_ctx->inference->GetDefaultNumOverlap();
-    *out_sample_rate = engine_ctx->inference->GetSampleRate();
+    const ams::ModelInfo& info = engine_ctx->model->info;
+    *out_chunk_size = info.chunk_size;
+    *out_overlap = info.num_overlap;
+    *out_sample_rate = info.sample_rate;
+    return AMS_OK;
+  });
+}
+
+ams_code_t ams_model_probe(const char* model_path, const char** out_json_utf8) {
+  return WrapCapi([&]() {
+    if (model_path == nullptr || out_json_utf8 == nullptr) {
+      ams::SetLastError("invalid argument: model_path/probe output");
+      return AMS_ERR_INVALID_ARG;
+    }
+
+    ams::ModelInfo info;
+    if (!ams::EngineManager::Instance().FindResidentInfo(model_path, &info)) {
+      std::string error_message;
+      if (!ams::ProbeGgufModel(model_path, &info, &error_message)) {
+        ams::SetLastError(error_message);
+        return AMS_ERR_RUNTIME;
+      }
+    }
+
+    char* c_str = ams::AllocCString(ams::BuildModelProbeJson(model_path, info));
+    if (c_str == nullptr) {
+      ams::SetLastError("memory allocation failed");
+      return AMS_ERR_RUNTIME;
+    }
+
+    *out_json_utf8 = c_str;
     return AMS_OK;
   });
 }
@@ -83,6 +174,24 @@ ams_code_t ams_engine_close(ams_engine_t engine) {
   return WrapCapi([&]() { return ams::EngineManager::Instance().Close(engine); });
 }
 
+ams_code_t ams_engine_pool_configure(int64_t idle_ttl_ms, int64_t max_resident_bytes) {
+  return WrapCapi([&]() {
+    ams::EngineManager::Instance().ConfigurePool(idle_ttl_ms, max_resident_bytes);
+    return AMS_OK;
+  });
+}
+
+ams_code_t ams_engine_pool_get_stats(ams_engine_pool_stats_t* out_stats) {
+  return WrapCapi([&]() {
+    if (out_stats == nullptr) {
+      ams::SetLastError("invalid argument: engine pool stats output");
+      return AMS_ERR_INVALID_ARG;
+    }
+    ams::EngineManager::Instance().GetPoolStats(out_stats);
+    return AMS_OK;
+  });
+}
+
 ams_code_t ams_prepare_start(ams_engine_t engine,
                              const ams_prepare_config_t* config,
                              ams_prepare_t* out_prepare) {
@@ -107,6 +216,8 @@ ams_code_t ams_prepare_start(ams_engine_t engine,
     prepare_config.work_dir = config->work_dir;
     prepare_config.output_prefix =
         config->output_prefix != nullptr ? config->output_prefix : "input";
+    prepare_config.retain_decoded_audio = config->retain_decoded_audio != 0;
+    prepare_config.cache_max_bytes = config->cache_max_bytes;
     return ams::PrepareManager::Instance().Start(engine_ctx, prepare_config, out_prepare);
   });
 }
@@ -120,6 +231,20 @@ ams_code_t ams_prepare_poll(ams_prepare_t task,
   });
 }
 
+ams_code_t ams_prepare_poll_many(const ams_prepare_t* tasks,
+                                 int32_t count,
+                                 ams_task_snapshot_t* out_snapshots) {
+  return WrapCapi([&]() {
+    return ams::PrepareManager::Instance().PollMany(tasks, count, out_snapshots);
+  });
+}
+
+ams_code_t ams_prepare_get_queue_position(ams_prepare_t task, int32_t* out_position) {
+  return WrapCapi([&]() {
+    return ams::PrepareManager::Instance().GetQueuePosition(task, out_position);
+  });
+}
+
 ams_code_t ams_prepare_cancel(ams_prepare_t task) {
   return WrapCapi([&]() { return ams::PrepareManager::Instance().Cancel(task); });
 }
@@ -156,7 +281,7 @@ ams_code_t ams_job_start(ams_engine_t engine,
                          const ams_run_config_t* config,
                          ams_job_t* out_job) {
   return WrapCapi([&]() {
-    if (config == nullptr || out_job == nullptr || config->output_dir == nullptr) {
+    if (config == nullptr || out_job == nullptr || !HasOutputTarget(*config)) {
       ams::SetLastError("invalid argument: job start config");
       return AMS_ERR_INVALID_ARG;
     }
@@ -167,20 +292,105 @@ ams_code_t ams_job_start(ams_engine_t engine,
       return AMS_ERR_NOT_FOUND;
     }
 
-    ams::JobConfig job_config;
-    job_config.input_path = config->input_path != nullptr ? config->input_path : "";
-    job_config.prepared_input_path =
-        config->prepared_input_path != nullptr ? config->prepared_input_path : "";
-    job_config.output_dir = config->output_dir;
-    job_config.output_prefix = config->output_prefix != nullptr ? config->output_prefix : "separated";
-    job_config.output_format = config->output_format;
-    job_config.chunk_size = config->chunk_size;
-    job_config.overlap = config->overlap;
+    return ams::JobManager::Instance().Start(engine_ctx, ToJobConfig(*config), out_job);
+  });
+}
+
+ams_code_t ams_job_start_from_prepare(ams_engine_t engine,
+                                      ams_prepare_t prepare,
+                                      const ams_run_config_t* config,
+                                      ams_job_t* out_job) {
+  return WrapCapi([&]() {
+    if (config == nullptr || out_job == nullptr || !HasOutputTarget(*config)) {
+      ams::SetLastError("invalid argument: job start config");
+      return AMS_ERR_INVALID_ARG;
+    }
+
+    auto engine_ctx = ams::EngineManager::Instance().Find(engine);
+    if (engine_ctx == nullptr) {
+      ams::SetLastError("engine not found");
+      return AMS_ERR_NOT_FOUND;
+    }
+
+    ams::JobConfig job_config = ToJobConfig(*config);
+    const ams_code_t code = ams::PrepareManager::Instance().GetDecodedAudio(
+        prepare,
+        &job_config.input_audio,
+        &job_config.input_audio_sample_rate);
+    if (code != AMS_OK) {
+      return code;
+    }
 
     return ams::JobManager::Instance().Start(engine_ctx, job_config, out_job);
   });
 }
 
+ams_code_t ams_job_start_pcm(ams_engine_t engine,
+                             const float* interleaved,
+                             int64_t frames,
+                             int32_t sample_rate,
+                             int32_t channels,
+                             const ams_run_config_t* config,
+                             ams_job_t* out_job) {
+  return WrapCapi([&]() {
+    if (config == nullptr || out_job == nullptr || !HasOutputTarget(*config) ||
+        interleaved == nullptr || frames <= 0 || sample_rate <= 0 || channels <= 0) {
+      ams::SetLastError("invalid argument: pcm job start");
+      return AMS_ERR_INVALID_ARG;
+    }
+
+    auto engine_ctx = ams::EngineManager::Instance().Find(engine);
+    if (engine_ctx == nullptr) {
+      ams::SetLastError("engine not found");
+      return AMS_ERR_NOT_FOUND;
+    }
+
+    auto audio = std::make_shared<std::vector<float>>();
+    std::string downmix_error;
+    if (!ams::DownmixToStereoF32(
+            interleaved, frames, channels, sample_rate, audio.get(), &downmix_error)) {
+      ams::SetLastError("pcm downmix failed: " + downmix_error);
+      return AMS_ERR_RUNTIME;
+    }
+
+    ams::JobConfig job_config = ToJobConfig(*config);
+    job_config.input_path.clear();
+    job_config.prepared_input_path.clear();
+    job_config.input_audio = std::move(audio);
+    job_config.input_audio_sample_rate = sample_rate;
+    return ams::JobManager::Instance().Start(engine_ctx, job_config, out_job);
+  });
+}
+
+ams_code_t ams_engine_autotune(ams_engine_t engine,
+                               const ams_autotune_config_t* config,
+                               ams_job_t* out_job) {
+  return WrapCapi([&]() {
+    if (config == nullptr || out_job == nullptr || config->profile_path == nullptr ||
+        config->profile_path[0] == '\0' ||
+        (config->chunk_size_count > 0 && config->chunk_sizes == nullptr)) {
+      ams::SetLastError("invalid argument: autotune config");
+      return AMS_ERR_INVALID_ARG;
+    }
+
+    auto engine_ctx = ams::EngineManager::Instance().Find(engine);
+    if (engine_ctx == nullptr) {
+      ams::SetLastError("engine not found");
+      return AMS_ERR_NOT_FOUND;
+    }
+
+    ams::AutotuneConfig autotune_config;
+    autotune_config.profile_path = config->profile_path;
+    autotune_config.trial_seconds = config->trial_seconds;
+    if (config->chunk_size_count > 0) {
+      autotune_config.chunk_sizes.assign(config->chunk_sizes,
+                                         config->chunk_sizes + config->chunk_size_count);
+    }
+    autotune_config.priority = config->priority;
+    return ams::JobManager::Instance().StartAutotune(engine_ctx, autotune_config, out_job);
+  });
+}
+
 ams_code_t ams_job_poll(ams_job_t job,
                         int32_t* out_state,
                         double* out_progress_0_1,
@@ -190,6 +400,18 @@ ams_code_t ams_job_poll(ams_job_t job,
   });
 }
 
+ams_code_t ams_job_poll_many(const ams_job_t* jobs,
+                             int32_t count,
+                             ams_task_snapshot_t* out_snapshots) {
+  return WrapCapi([&]() {
+    return ams::JobManager::Instance().PollMany(jobs, count, out_snapshots);
+  });
+}
+
+ams_code_t ams_job_get_queue_position(ams_job_t job, int32_t* out_position) {
+  return WrapCapi([&]() { return ams::JobManager::Instance().GetQueuePosition(job, out_position); });
+}
+
 ams_code_t ams_job_cancel(ams_job_t job) {
   return WrapCapi([&]() { return ams::JobManager::Instance().Cancel(job); });
 }
@@ -218,10 +440,54 @@ ams_code_t ams_job_get_result_json(ams_job_t job, const char** out_json_utf8) {
   });
 }
 
+ams_code_t ams_job_get_stem_count(ams_job_t job, int32_t* out_count) {
+  return WrapCapi([&]() { return ams::JobManager::Instance().GetStemCount(job, out_count); });
+}
+
+ams_code_t ams_job_get_stem(ams_job_t job,
+                            int32_t index,
+                            const float** out_interleaved,
+                            int64_t* out_frames) {
+  return WrapCapi([&]() {
+    return ams::JobManager::Instance().GetStem(job, index, out_interleaved, out_frames);
+  });
+}
+
+ams_code_t ams_job_retain_stem(ams_job_t job,
+                               int32_t index,
+                               const float** out_interleaved,
+                               int64_t* out_frames,
+                               void** out_token) {
+  return WrapCapi([&]() {
+    return ams::JobManager::Instance().RetainStem(
+        job, index, out_interleaved, out_frames, out_token);
+  });
+}
+
+void ams_stem_release(void* token) {
+  ams::JobManager::ReleaseStem(token);
+}
+
 ams_code_t ams_job_destroy(ams_job_t job) {
   return WrapCapi([&]() { return ams::JobManager::Instance().Destroy(job); });
 }
 
+ams_code_t ams_scheduler_configure(int32_t max_running_jobs, int32_t max_running_prepares) {
+  return WrapCapi([&]() {
+    ams::TaskScheduler::Instance().Configure(max_running_jobs, max_running_prepares);
+    return AMS_OK;
+  });
+}
+
+ams_code_t ams_set_event_callback(ams_event_callback_t callback,
+                                  void* user_data,
+                                  double progress_step) {
+  return WrapCapi([&]() {
+    ams::SetEventCallback(callback, user_data, progress_step);
+    return AMS_OK;
+  });
+}
+
 const char* ams_last_error(void) {
   return ams::GetLastError();
 }
@@ -236,7 +502,7 @@ ams_code_t ams_runtime_set_env(const char* key, const char* value) {
       ams::SetLastError("invalid argument: runtime set env");
       return AMS_ERR_INVALID_ARG;
     }
-    SetEnvValue(key, value);
+    ams::SetEnvValue(key, value);
     return AMS_OK;
   });
 }
@@ -247,7 +513,7 @@ ams_code_t ams_runtime_unset_env(const char* key) {
       ams::SetLastError("invalid argument: runtime unset env");
       return AMS_ERR_INVALID_ARG;
     }
-    UnsetEnvValue(key);
+    ams::UnsetEnvValue(key);
     return AMS_OK;
   });
 }
@@ -0,0 +1,252 @@
+#include "autotune.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+constexpr int32_t kDefaultTrialSeconds = 10;
+constexpr auto kMemorySampleInterval = std::chrono::milliseconds(10);
+constexpr const char* kCancelledMessage = "cancelled";
+
+int64_t ResidentMemoryBytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return static_cast<int64_t>(counters.WorkingSetSize);
+  }
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info{};
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info),
+                &count) == KERN_SUCCESS) {
+    return static_cast<int64_t>(info.resident_size);
+  }
+  return 0;
+#else
+  std::FILE* file = std::fopen("/proc/self/statm", "r");
+  if (file == nullptr) {
+    return 0;
+  }
+  long long total_pages = 0;
+  long long resident_pages = 0;
+  const int fields = std::fscanf(file, "%lld %lld", &total_pages, &resident_pages);
+  std::fclose(file);
+  if (fields != 2) {
+    return 0;
+  }
+  return static_cast<int64_t>(resident_pages) * static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Polls the resident set on a side thread; Stop() returns the highest level
+// seen above the level at construction.
+class PeakMemorySampler {
+ public:
+  PeakMemorySampler() : baseline_(ResidentMemoryBytes()), peak_(baseline_) {
+    thread_ = std::thread([this]() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stopped_) {
+        peak_ = std::max(peak_, ResidentMemoryBytes());
+        cv_.wait_for(lock, kMemorySampleInterval);
+      }
+    });
+  }
+
+  ~PeakMemorySampler() { Stop(); }
+
+  PeakMemorySampler(const PeakMemorySampler&) = delete;
+  PeakMemorySampler& operator=(const PeakMemorySampler&) = delete;
+
+  int64_t Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    peak_ = std::max(peak_, ResidentMemoryBytes());
+    return std::max<int64_t>(0, peak_ - baseline_);
+  }
+
+ private:
+  const int64_t baseline_;
+  int64_t peak_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopped_ = false;
+  std::thread thread_;
+};
+
+// Band-limited noise plus two tones: enough structure that no stage can
+// short-circuit on silence. Interleaved stereo, deterministic across runs.
+std::vector<float> SyntheticAudio(int64_t frames, int sample_rate) {
+  std::vector<float> audio(static_cast<size_t>(frames) * 2);
+  uint32_t state = 0x9E3779B9u;
+  float smoothed = 0.0f;
+  const double two_pi = 6.283185307179586;
+  for (int64_t i = 0; i < frames; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    const float noise = static_cast<float>(state) / 4294967295.0f * 2.0f - 1.0f;
+    smoothed = 0.8f * smoothed + 0.2f * noise;
+    const double t = static_cast<double>(i) / sample_rate;
+    const float tone_a = static_cast<float>(std::sin(two_pi * 220.0 * t));
+    const float tone_b = static_cast<float>(std::sin(two_pi * 330.0 * t));
+    audio[static_cast<size_t>(i) * 2] = 0.15f * smoothed + 0.2f * tone_a;
+    audio[static_cast<size_t>(i) * 2 + 1] = 0.15f * smoothed + 0.2f * tone_b;
+  }
+  return audio;
+}
+
+std::vector<int32_t> Deduplicated(std::vector<int32_t> values) {
+  std::vector<int32_t> unique;
+  for (int32_t value : values) {
+    if (std::find(unique.begin(), unique.end(), value) == unique.end()) {
+      unique.push_back(value);
+    }
+  }
+  return unique;
+}
+
+std::vector<int32_t> ChunkSizeGrid(const ams::AutotuneConfig& config, int32_t default_chunk) {
+  std::vector<int32_t> grid;
+  if (!config.chunk_sizes.empty()) {
+    for (int32_t value : config.chunk_sizes) {
+      if (value > 0) {
+        grid.push_back(value);
+      }
+    }
+  } else if (default_chunk > 0) {
+    grid = {default_chunk / 2, default_chunk, default_chunk * 2};
+    grid.erase(std::remove(grid.begin(), grid.end(), 0), grid.end());
+  }
+  return Deduplicated(std::move(grid));
+}
+
+}  // namespace
+
+namespace ams {
+
+bool RunAutotuneTrials(ResidentModel* model,
+                       const AutotuneConfig& config,
+                       const std::function<bool()>& should_cancel,
+                       const std::function<void(double)>& on_progress,
+                       AutotuneResult* out_result,
+                       std::string* error_message) {
+  auto fail = [&](const std::string& message) {
+    if (error_message != nullptr) {
+      *error_message = message;
+    }
+    return false;
+  };
+
+  if (model == nullptr || model->inference == nullptr || out_result == nullptr) {
+    return fail("invalid argument: autotune");
+  }
+
+  const int sample_rate = model->inference->GetSampleRate();
+  const int32_t overlap = model->inference->GetDefaultNumOverlap();
+  const std::vector<int32_t> chunk_sizes =
+      ChunkSizeGrid(config, model->inference->GetDefaultChunkSize());
+  if (sample_rate <= 0 || overlap <= 0 || chunk_sizes.empty()) {
+    return fail("autotune has no valid chunk size to try");
+  }
+
+  const int32_t trial_seconds = config.trial_seconds > 0 ? config.trial_seconds : kDefaultTrialSeconds;
+  const int32_t max_chunk = *std::max_element(chunk_sizes.begin(), chunk_sizes.end());
+  const int64_t frames =
+      std::max<int64_t>(static_cast<int64_t>(trial_seconds) * sample_rate, max_chunk);
+  const std::vector<float> audio = SyntheticAudio(frames, sample_rate);
+  const double audio_seconds = static_cast<double>(frames) / sample_rate;
+
+  AutotuneResult result;
+  const double total_trials = static_cast<double>(chunk_sizes.size());
+  size_t finished_trials = 0;
+
+  for (int32_t chunk_size : chunk_sizes) {
+    std::lock_guard<std::mutex> model_lock(model->run_mutex);
+
+    {
+      const std::vector<float> warm_up(audio.begin(),
+                                       audio.begin() + static_cast<size_t>(chunk_size) * 2);
+      model->inference->Process(warm_up, chunk_size, overlap, nullptr, should_cancel);
+    }
+    if (should_cancel()) {
+      return fail(kCancelledMessage);
+    }
+
+    PeakMemorySampler sampler;
+    const auto begin = std::chrono::steady_clock::now();
+    const auto stems = model->inference->Process(
+        audio,
+        chunk_size,
+        overlap,
+        [&](float p) {
+          if (on_progress) {
+            on_progress((static_cast<double>(finished_trials) + p) / total_trials);
+          }
+        },
+        should_cancel);
+    const auto end = std::chrono::steady_clock::now();
+    const int64_t peak_memory_bytes = sampler.Stop();
+
+    if (should_cancel()) {
+      return fail(kCancelledMessage);
+    }
+    if (stems.empty()) {
+      return fail("autotune trial produced no stems");
+    }
+
+    AutotuneTrial trial;
+    trial.chunk_size = chunk_size;
+    trial.real_time_factor = std::chrono::duration<double>(end - begin).count() / audio_seconds;
+    trial.peak_memory_bytes = peak_memory_bytes;
+    result.trials.push_back(trial);
+
+    ++finished_trials;
+    if (on_progress) {
+      on_progress(static_cast<double>(finished_trials) / total_trials);
+    }
+  }
+
+  const auto best = std::min_element(
+      result.trials.begin(), result.trials.end(), [](const AutotuneTrial& a, const AutotuneTrial& b) {
+        if (a.real_time_factor != b.real_time_factor) {
+          return a.real_time_factor < b.real_time_factor;
+        }
+        return a.peak_memory_bytes < b.peak_memory_bytes;
+      });
+  result.best.chunk_size = best->chunk_size;
+  result.best.overlap = overlap;
+  result.best.real_time_factor = best->real_time_factor;
+  result.best.peak_memory_bytes = best->peak_memory_bytes;
+
+  *out_result = std::move(result);
+  return true;
+}
+
+}  // namespace ams
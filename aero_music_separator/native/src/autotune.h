@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "engine_manager.h"
+#include "tuning_profile.h"
+
+namespace ams {
+
+struct AutotuneConfig {
+  std::string profile_path;
+  // Seconds of synthetic audio per trial; <= 0 selects the default.
+  int32_t trial_seconds = 0;
+  // An empty grid is derived from the model default.
+  std::vector<int32_t> chunk_sizes;
+  int32_t priority = 0;
+};
+
+struct AutotuneTrial {
+  int32_t chunk_size = 0;
+  double real_time_factor = 0.0;
+  int64_t peak_memory_bytes = 0;
+};
+
+struct AutotuneResult {
+  TuningEntry best;
+  std::vector<AutotuneTrial> trials;
+};
+
+// Separates the same synthetic audio once per chunk size with the model's
+// default overlap, and picks the lowest real-time factor. Each chunk size
+// gets an untimed warm-up run first so graph allocation is not billed to the
+// first trial. Trials hold the model's run lock, so they never overlap a job
+// on the same model. Thread counts are not tuned: ggml's CPU backend picks
+// its own, so there is no setting to measure or store.
+bool RunAutotuneTrials(ResidentModel* model,
+                       const AutotuneConfig& config,
+                       const std::function<bool()>& should_cancel,
+                       const std::function<void(double)>& on_progress,
+                       AutotuneResult* out_result,
+                       std::string* error_message);
+
+}  // namespace ams
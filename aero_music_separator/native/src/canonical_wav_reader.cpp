@@ -0,0 +1,249 @@
+#include "canonical_wav_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AMS_WAV_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AMS_WAV_NEON 1
+#endif
+
+namespace {
+
+constexpr int kChannels = 2;
+constexpr uint16_t kWaveFormatPcm = 1;
+constexpr uint16_t kWaveFormatExtensible = 0xFFFE;
+constexpr float kS16Scale = 1.0f / 32768.0f;
+
+uint16_t ReadLe16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t ReadLe32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+      (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool IsLittleEndianHost() {
+  const uint16_t probe = 1;
+  uint8_t first = 0;
+  std::memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+}  // namespace
+
+namespace ams {
+
+void ConvertS16ToF32(const int16_t* in, float* out, size_t count) {
+  size_t i = 0;
+#if defined(AMS_WAV_SSE2)
+  const __m128 scale = _mm_set1_ps(kS16Scale);
+  for (; i + 8 <= count; i += 8) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    // Sign-extend by placing each sample in the high half, then shifting.
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+#elif defined(AMS_WAV_NEON)
+  const float32x4_t scale = vdupq_n_f32(kS16Scale);
+  for (; i + 8 <= count; i += 8) {
+    const int16x8_t v = vld1q_s16(in + i);
+    const int32x4_t lo = vmovl_s16(vget_low_s16(v));
+    const int32x4_t hi = vmovl_s16(vget_high_s16(v));
+    vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(lo), scale));
+    vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(hi), scale));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = static_cast<float>(in[i]) * kS16Scale;
+  }
+}
+
+CanonicalWavReader::~CanonicalWavReader() {
+  Unmap();
+}
+
+void CanonicalWavReader::Unmap() {
+#ifdef _WIN32
+  if (mapping_ != nullptr) {
+    UnmapViewOfFile(mapping_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(mapping_handle_));
+  }
+  if (file_handle_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_handle_));
+  }
+  mapping_handle_ = nullptr;
+  file_handle_ = nullptr;
+#else
+  if (mapping_ != nullptr) {
+    munmap(const_cast<uint8_t*>(mapping_), mapping_size_);
+  }
+#endif
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  samples_ = nullptr;
+  total_frames_ = 0;
+  position_ = 0;
+}
+
+bool CanonicalWavReader::Open(const std::string& path, int sample_rate, std::string* reason) {
+  auto reject = [&](const char* why) {
+    Unmap();
+    if (reason != nullptr) {
+      *reason = why;
+    }
+    return false;
+  };
+
+  Unmap();
+  if (path.empty() || sample_rate <= 0) {
+    return reject("invalid arguments");
+  }
+  if (!IsLittleEndianHost()) {
+    return reject("big-endian host");
+  }
+
+#ifdef _WIN32
+  const int wide_len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  if (wide_len <= 0) {
+    return reject("path conversion failed");
+  }
+  std::wstring wide_path(static_cast<size_t>(wide_len), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wide_path.data(), wide_len);
+
+  HANDLE file = CreateFileW(wide_path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return reject("open failed");
+  }
+  file_handle_ = file;
+
+  LARGE_INTEGER file_size{};
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+    return reject("empty or unreadable file");
+  }
+  mapping_size_ = static_cast<size_t>(file_size.QuadPart);
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    return reject("mapping failed");
+  }
+  mapping_handle_ = mapping;
+  mapping_ = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mapping_ == nullptr) {
+    return reject("mapping failed");
+  }
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return reject("open failed");
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return reject("empty or unreadable file");
+  }
+  void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return reject("mapping failed");
+  }
+  mapping_ = static_cast<const uint8_t*>(mapped);
+  mapping_size_ = static_cast<size_t>(st.st_size);
+  madvise(mapped, mapping_size_, MADV_SEQUENTIAL);
+#endif
+
+  if (mapping_size_ < 12 || std::memcmp(mapping_, "RIFF", 4) != 0 ||
+      std::memcmp(mapping_ + 8, "WAVE", 4) != 0) {
+    return reject("not a RIFF/WAVE file");
+  }
+
+  bool have_fmt = false;
+  size_t offset = 12;
+  while (offset + 8 <= mapping_size_) {
+    const uint8_t* chunk = mapping_ + offset;
+    const uint32_t chunk_size = ReadLe32(chunk + 4);
+    const size_t body = offset + 8;
+
+    if (std::memcmp(chunk, "fmt ", 4) == 0) {
+      if (chunk_size < 16 || body + 16 > mapping_size_) {
+        return reject("truncated fmt chunk");
+      }
+      const uint16_t format_tag = ReadLe16(mapping_ + body);
+      const uint16_t channels = ReadLe16(mapping_ + body + 2);
+      const uint32_t rate = ReadLe32(mapping_ + body + 4);
+      const uint16_t block_align = ReadLe16(mapping_ + body + 12);
+      const uint16_t bits = ReadLe16(mapping_ + body + 14);
+      bool pcm = format_tag == kWaveFormatPcm;
+      if (format_tag == kWaveFormatExtensible && chunk_size >= 40 && body + 40 <= mapping_size_) {
+        // The sub-format GUID starts with the plain format tag.
+        pcm = ReadLe16(mapping_ + body + 24) == kWaveFormatPcm;
+      }
+      if (!pcm || channels != kChannels || bits != 16 || block_align != kChannels * 2 ||
+          rate != static_cast<uint32_t>(sample_rate)) {
+        return reject("not PCM16 stereo at the target sample rate");
+      }
+      have_fmt = true;
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      if (!have_fmt) {
+        return reject("data chunk before fmt chunk");
+      }
+      // Writers that could not seek back leave a placeholder size; trust the
+      // file length in that case.
+      const size_t available = mapping_size_ - body;
+      const size_t data_size =
+          chunk_size == 0 || chunk_size == 0xFFFFFFFFu ? available
+                                                       : std::min<size_t>(chunk_size, available);
+      samples_ = reinterpret_cast<const int16_t*>(mapping_ + body);
+      total_frames_ = static_cast<int64_t>(data_size / (kChannels * 2));
+      position_ = 0;
+      return true;
+    }
+
+    offset = body + chunk_size + (chunk_size & 1u);
+  }
+
+  return reject("no data chunk");
+}
+
+int64_t CanonicalWavReader::Read(float* out_interleaved, int64_t max_frames) {
+  if (samples_ == nullptr || out_interleaved == nullptr || max_frames <= 0) {
+    return 0;
+  }
+  const int64_t frames = std::min(max_frames, total_frames_ - position_);
+  if (frames <= 0) {
+    return 0;
+  }
+  ConvertS16ToF32(samples_ + position_ * kChannels,
+                  out_interleaved,
+                  static_cast<size_t>(frames) * kChannels);
+  position_ += frames;
+  return frames;
+}
+
+}  // namespace ams
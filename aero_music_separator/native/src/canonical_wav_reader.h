@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ams {
+
+// Memory-mapped reader for 16-bit PCM stereo WAV files at a known sample
+// rate, i.e. the canonical input written by prepare. Files in any other
+// layout are rejected by Open() so callers can fall back to FFmpeg.
+class CanonicalWavReader {
+ public:
+  CanonicalWavReader() = default;
+  ~CanonicalWavReader();
+
+  CanonicalWavReader(const CanonicalWavReader&) = delete;
+  CanonicalWavReader& operator=(const CanonicalWavReader&) = delete;
+
+  // Returns false when the file cannot be mapped or does not match the
+  // canonical layout at `sample_rate`; `reason` says why.
+  bool Open(const std::string& path, int sample_rate, std::string* reason);
+
+  // Converts up to `max_frames` frames to interleaved f32. Returns the number
+  // of frames written, 0 at end of data.
+  int64_t Read(float* out_interleaved, int64_t max_frames);
+
+  int64_t TotalFrames() const { return total_frames_; }
+  int64_t Position() const { return position_; }
+
+ private:
+  void Unmap();
+
+  const uint8_t* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+#ifdef _WIN32
+  void* file_handle_ = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+
+  const int16_t* samples_ = nullptr;
+  int64_t total_frames_ = 0;
+  int64_t position_ = 0;
+};
+
+// s16 -> f32 with the same 1/32768 scale swresample uses.
+void ConvertS16ToF32(const int16_t* in, float* out, size_t count);
+
+}  // namespace ams
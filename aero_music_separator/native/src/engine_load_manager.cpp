@@ -0,0 +1,234 @@
+#include "engine_load_manager.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "engine_manager.h"
+#include "error_store.h"
+
+namespace {
+
+constexpr const char* kCancelledMessage = "cancelled";
+
+}  // namespace
+
+namespace ams {
+
+EngineLoadManager& EngineLoadManager::Instance() {
+  static EngineLoadManager manager;
+  return manager;
+}
+
+std::shared_ptr<EngineLoadContext> EngineLoadManager::FindLocked(ams_engine_load_t load) {
+  auto it = loads_.find(load);
+  if (it == loads_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+ams_code_t EngineLoadManager::Start(const std::string& model_path,
+                                    const ams_engine_open_options_t& options,
+                                    ams_engine_load_t* out_load) {
+  if (out_load == nullptr || model_path.empty()) {
+    SetLastError("invalid argument: start engine load");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  auto load = std::make_shared<EngineLoadContext>();
+  load->model_path = model_path;
+  load->options = options;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  load->handle = next_handle_++;
+  loads_[load->handle] = load;
+  try {
+    load->scheduled = TaskScheduler::Instance().Submit(
+        TaskLane::kEngineLoad, 0, [load]() { RunLoad(load); });
+  } catch (const std::exception& e) {
+    loads_.erase(load->handle);
+    SetLastError(std::string("failed to schedule engine load: ") + e.what());
+    return AMS_ERR_RUNTIME;
+  } catch (...) {
+    loads_.erase(load->handle);
+    SetLastError("failed to schedule engine load: unknown exception");
+    return AMS_ERR_RUNTIME;
+  }
+
+  *out_load = load->handle;
+  return AMS_OK;
+}
+
+void EngineLoadManager::RunLoad(const std::shared_ptr<EngineLoadContext>& load) {
+  load->state.store(AMS_JOB_RUNNING, std::memory_order_release);
+
+  auto should_cancel = [&]() -> bool {
+    return load->cancel_requested.load(std::memory_order_acquire);
+  };
+
+  auto finish_with_error = [&](int32_t state, const std::string& message) {
+    {
+      std::lock_guard<std::mutex> lock(load->data_mutex);
+      load->error_message = message;
+    }
+    load->state.store(state, std::memory_order_release);
+  };
+
+  EngineLoadObserver observer;
+  observer.should_cancel = should_cancel;
+  observer.set_progress = [&](double value) {
+    load->progress.store(std::max(0.0, std::min(1.0, value)), std::memory_order_release);
+  };
+
+  ams_engine_t engine = 0;
+  const ams_code_t code =
+      EngineManager::Instance().Open(load->model_path, load->options, &engine, &observer);
+  if (code != AMS_OK) {
+    if (code == AMS_ERR_CANCELLED || should_cancel()) {
+      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    } else {
+      const std::string error = GetLastError();
+      finish_with_error(AMS_JOB_FAILED, error.empty() ? "engine load failed" : error);
+    }
+    return;
+  }
+
+  // Cancelled after the file was read: the model stays in the idle pool, so
+  // a later open of the same model is still fast.
+  if (should_cancel()) {
+    EngineManager::Instance().Close(engine);
+    finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    return;
+  }
+
+  bool detached = false;
+  {
+    std::lock_guard<std::mutex> lock(load->data_mutex);
+    detached = load->detached;
+    if (!detached) {
+      load->engine = engine;
+    }
+  }
+  if (detached) {
+    EngineManager::Instance().Close(engine);
+  }
+  load->progress.store(1.0, std::memory_order_release);
+  load->state.store(AMS_JOB_SUCCEEDED, std::memory_order_release);
+}
+
+ams_code_t EngineLoadManager::Poll(ams_engine_load_t load,
+                                   int32_t* out_state,
+                                   double* out_progress_0_1) {
+  if (out_state == nullptr || out_progress_0_1 == nullptr) {
+    SetLastError("invalid argument: engine load poll");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<EngineLoadContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(load);
+  }
+  if (ctx == nullptr) {
+    SetLastError("engine load not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+
+  *out_state = ctx->state.load(std::memory_order_acquire);
+  *out_progress_0_1 = ctx->progress.load(std::memory_order_acquire);
+  return AMS_OK;
+}
+
+ams_code_t EngineLoadManager::Cancel(ams_engine_load_t load) {
+  std::shared_ptr<EngineLoadContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(load);
+  }
+  if (ctx == nullptr) {
+    SetLastError("engine load not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+
+  ctx->cancel_requested.store(true, std::memory_order_release);
+  if (TaskScheduler::Instance().Withdraw(ctx->scheduled)) {
+    {
+      std::lock_guard<std::mutex> lock(ctx->data_mutex);
+      ctx->error_message = kCancelledMessage;
+    }
+    ctx->state.store(AMS_JOB_CANCELLED, std::memory_order_release);
+  }
+  return AMS_OK;
+}
+
+ams_code_t EngineLoadManager::TakeEngine(ams_engine_load_t load, ams_engine_t* out_engine) {
+  if (out_engine == nullptr) {
+    SetLastError("invalid argument: engine output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<EngineLoadContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(load);
+  }
+  if (ctx == nullptr) {
+    SetLastError("engine load not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+
+  const int32_t state = ctx->state.load(std::memory_order_acquire);
+  std::lock_guard<std::mutex> lock(ctx->data_mutex);
+
+  if (state == AMS_JOB_SUCCEEDED) {
+    if (ctx->engine == 0) {
+      SetLastError("engine already taken from this load");
+      return AMS_ERR_RUNTIME;
+    }
+    *out_engine = ctx->engine;
+    ctx->engine = 0;
+    return AMS_OK;
+  }
+  if (state == AMS_JOB_CANCELLED) {
+    SetLastError(ctx->error_message.empty() ? kCancelledMessage : ctx->error_message);
+    return AMS_ERR_CANCELLED;
+  }
+  if (state == AMS_JOB_FAILED) {
+    SetLastError(ctx->error_message.empty() ? "engine load failed" : ctx->error_message);
+    return AMS_ERR_RUNTIME;
+  }
+
+  SetLastError("engine load is not completed yet");
+  return AMS_ERR_RUNTIME;
+}
+
+ams_code_t EngineLoadManager::Destroy(ams_engine_load_t load) {
+  std::shared_ptr<EngineLoadContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = loads_.find(load);
+    if (it == loads_.end()) {
+      SetLastError("engine load not found");
+      return AMS_ERR_NOT_FOUND;
+    }
+    ctx = it->second;
+    loads_.erase(it);
+  }
+
+  ctx->cancel_requested.store(true, std::memory_order_release);
+  TaskScheduler::Instance().Withdraw(ctx->scheduled);
+
+  ams_engine_t engine = 0;
+  {
+    std::lock_guard<std::mutex> lock(ctx->data_mutex);
+    ctx->detached = true;
+    engine = std::exchange(ctx->engine, 0);
+  }
+  if (engine != 0) {
+    EngineManager::Instance().Close(engine);
+  }
+  return AMS_OK;
+}
+
+}  // namespace ams
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ams_ffi.h"
+#include "task_scheduler.h"
+
+namespace ams {
+
+struct EngineLoadContext {
+  ams_engine_load_t handle = 0;
+  std::string model_path;
+  ams_engine_open_options_t options{};
+
+  std::atomic<int32_t> state{AMS_JOB_PENDING};
+  std::atomic<double> progress{0.0};
+  std::atomic<bool> cancel_requested{false};
+
+  std::mutex data_mutex;
+  std::string error_message;
+  // Owned by the load until TakeEngine() hands it to the caller.
+  ams_engine_t engine = 0;
+  // Set by Destroy(); a load that finishes afterwards closes its engine.
+  bool detached = false;
+
+  std::shared_ptr<ScheduledTask> scheduled;
+};
+
+// Opens engines on the scheduler's engine-load lane so callers never block
+// on a model load.
+class EngineLoadManager {
+ public:
+  static EngineLoadManager& Instance();
+
+  ams_code_t Start(const std::string& model_path,
+                   const ams_engine_open_options_t& options,
+                   ams_engine_load_t* out_load);
+
+  ams_code_t Poll(ams_engine_load_t load, int32_t* out_state, double* out_progress_0_1);
+  ams_code_t Cancel(ams_engine_load_t load);
+
+  // Transfers the opened engine to the caller, who closes it with
+  // ams_engine_close. Fails with the load's error unless it succeeded.
+  ams_code_t TakeEngine(ams_engine_load_t load, ams_engine_t* out_engine);
+
+  // Closes the engine too when it was never taken. Does not wait for a load
+  // that is constructing Inference; that load closes its engine when done.
+  ams_code_t Destroy(ams_engine_load_t load);
+
+ private:
+  EngineLoadManager() = default;
+
+  static void RunLoad(const std::shared_ptr<EngineLoadContext>& load);
+
+  std::shared_ptr<EngineLoadContext> FindLocked(ams_engine_load_t load);
+
+  std::mutex mutex_;
+  ams_engine_load_t next_handle_ = 1;
+  std::unordered_map<ams_engine_load_t, std::shared_ptr<EngineLoadContext>> loads_;
+};
+
+}  // namespace ams
@@ -1,17 +1,37 @@
 #include "engine_manager.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <exception>
+#include <filesystem>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #if defined(__ANDROID__)
 #include <android/log.h>
 #endif
 
 #include "error_store.h"
+#include "model_file_mapping.h"
+#include "runtime_env.h"
 
 namespace {
 constexpr const char* kGgmlDisableVulkan = "GGML_DISABLE_VULKAN";
+// Share of an asynchronous open's progress given to the model file reaching
+// the page cache; the rest is Inference building its backend buffers, which
+// reports nothing.
+constexpr double kFileReadShare = 0.9;
+constexpr auto kPrefetchPollInterval = std::chrono::milliseconds(20);
+// Residency that stops growing this long means the OS will not read further
+// ahead, and the loader reads the rest on demand.
+constexpr auto kPrefetchStallTimeout = std::chrono::milliseconds(500);
 
 const char* BackendPreferenceName(int32_t backend_preference) {
   switch (backend_preference) {
@@ -30,22 +50,108 @@ const char* BackendPreferenceName(int32_t backend_preference) {
   }
 }
 
-void SetEnvFlag(const char* key, const char* value) {
-#ifdef _WIN32
-  _putenv_s(key, value);
+// Inference does not report the device it picked, so models record the
+// backend they were requested for. Android always loads on the CPU.
+std::string RequestedBackendName(int32_t backend_preference) {
+#if defined(__ANDROID__)
+  (void)backend_preference;
+  return "CPU";
 #else
-  setenv(key, value, 1);
+  return BackendPreferenceName(backend_preference);
 #endif
 }
 
-void UnsetEnvFlag(const char* key) {
-#ifdef _WIN32
-  _putenv_s(key, "");
-#else
-  unsetenv(key);
-#endif
+// Reports progress from how much of a prefetched mapping is resident, so an
+// asynchronous open shows the disk read without reading the file a second
+// time. Returns false when cancelled.
+bool WatchPrefetch(const ams::ModelFileMapping& mapping,
+                   const ams::EngineLoadObserver& observer) {
+  double last = mapping.ResidentFraction();
+  if (last < 0.0) {
+    return true;
+  }
+  auto last_growth = std::chrono::steady_clock::now();
+  while (last < 1.0) {
+    if (observer.should_cancel && observer.should_cancel()) {
+      return false;
+    }
+    if (observer.set_progress) {
+      observer.set_progress(kFileReadShare * last);
+    }
+    std::this_thread::sleep_for(kPrefetchPollInterval);
+    const double resident = mapping.ResidentFraction();
+    const auto now = std::chrono::steady_clock::now();
+    if (resident > last) {
+      last = resident;
+      last_growth = now;
+    } else if (now - last_growth >= kPrefetchStallTimeout) {
+      break;
+    }
+  }
+  if (observer.set_progress) {
+    observer.set_progress(kFileReadShare * last);
+  }
+  return true;
 }
 
+// Reports how much of the model file is in the page cache on its own thread
+// while Inference reads it, so a load shows the loader's reads without the
+// file being read a second time. Progress only moves forward, and stops when
+// the watcher is destroyed.
+class ResidencyWatcher {
+ public:
+  ResidencyWatcher(std::shared_ptr<const ams::ModelFileMapping> mapping,
+                   std::function<void(double)> set_progress)
+      : mapping_(std::move(mapping)), set_progress_(std::move(set_progress)) {
+    if (mapping_ != nullptr && set_progress_) {
+      thread_ = std::thread([this] { Run(); });
+    }
+  }
+
+  ~ResidencyWatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  ResidencyWatcher(const ResidencyWatcher&) = delete;
+  ResidencyWatcher& operator=(const ResidencyWatcher&) = delete;
+
+ private:
+  void Run() {
+    double reported = 0.0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+      lock.unlock();
+      const double resident = mapping_->ResidentFraction();
+      lock.lock();
+      if (resident < 0.0) {
+        return;
+      }
+      if (resident > reported) {
+        reported = resident;
+        set_progress_(kFileReadShare * reported);
+      }
+      if (reported >= 1.0) {
+        return;
+      }
+      wake_.wait_for(lock, kPrefetchPollInterval, [this] { return stop_; });
+    }
+  }
+
+  std::shared_ptr<const ams::ModelFileMapping> mapping_;
+  std::function<void(double)> set_progress_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
 void LogBackendPolicy(const char* policy) {
 #if defined(__ANDROID__)
   __android_log_print(
@@ -64,24 +170,15 @@ EngineManager& EngineManager::Instance() {
   return manager;
 }
 
-void EngineManager::ApplyBackendPreference(int32_t backend_preference) {
+std::vector<EnvSetting> EngineManager::BackendEnvSettings(int32_t backend_preference) {
 #if defined(__ANDROID__)
-  SetEnvFlag("BSR_FORCE_CPU", "1");
-  SetEnvFlag(kGgmlDisableVulkan, "1");
   const std::string policy =
       std::string("AndroidCPUOnly(request=") +
       BackendPreferenceName(backend_preference) + ")";
   LogBackendPolicy(policy.c_str());
+  return {{"BSR_FORCE_CPU", std::string("1")}, {kGgmlDisableVulkan, std::string("1")}};
 #else
 
-  const bool force_cpu = backend_preference == AMS_BACKEND_CPU;
-  if (force_cpu) {
-    SetEnvFlag("BSR_FORCE_CPU", "1");
-  } else {
-    // For non-CPU modes keep auto path by removing the force flag.
-    UnsetEnvFlag("BSR_FORCE_CPU");
-  }
-
   const char* policy = "Auto";
   switch (backend_preference) {
     case AMS_BACKEND_CPU:
@@ -104,29 +201,136 @@ void EngineManager::ApplyBackendPreference(int32_t backend_preference) {
       break;
   }
   LogBackendPolicy(policy);
+
+  if (backend_preference == AMS_BACKEND_CPU) {
+    return {{"BSR_FORCE_CPU", std::string("1")}};
+  }
+  // For non-CPU modes keep auto path by removing the force flag.
+  return {{"BSR_FORCE_CPU", std::nullopt}};
 #endif
 }
 
+EngineManager::~EngineManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  reaper_cv_.notify_all();
+  if (reaper_.joinable()) {
+    reaper_.join();
+  }
+}
+
 ams_code_t EngineManager::Open(const std::string& model_path,
-                               int32_t backend_preference,
-                               ams_engine_t* out_handle) {
+                               const ams_engine_open_options_t& options,
+                               ams_engine_t* out_handle,
+                               const EngineLoadObserver* observer) {
   if (out_handle == nullptr || model_path.empty()) {
     SetLastError("invalid argument: model_path/out_handle");
     return AMS_ERR_INVALID_ARG;
   }
 
+  const int32_t backend_preference = options.backend_preference;
+  // A file that cannot be stat'ed still goes to the loader, which reports the
+  // real error if it cannot read it either.
+  FileStamp file_stamp;
+  const bool has_stamp = ReadFileStamp(model_path, &file_stamp);
+  const PoolKey key{model_path, backend_preference, file_stamp};
+  auto context = std::make_shared<EngineContext>();
+  context->backend_preference = backend_preference;
+  context->model_path = model_path;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (has_stamp) {
+      MarkStaleLocked(model_path, file_stamp);
+      TrimLocked(std::chrono::steady_clock::now());
+    }
+    auto it = pool_.find(key);
+    if (it != pool_.end()) {
+      it->second.open_handles += 1;
+      hits_ += 1;
+      context->model = it->second.model;
+      context->handle = next_handle_++;
+      engines_[context->handle] = context;
+      *out_handle = context->handle;
+      return AMS_OK;
+    }
+  }
+
   try {
-    ApplyBackendPreference(backend_preference);
+    // Loading reads the whole GGUF and allocates backend buffers, so it runs
+    // without holding the manager lock.
+    //
+    // The mapping lives only for the load: the loader copies tensors into
+    // backend buffers, and dropping it afterwards keeps the pages out of
+    // RSS. An asynchronous open maps the file even without prefetching, to
+    // watch the loader's reads; mapping alone reads nothing.
+    std::shared_ptr<ModelFileMapping> mapping;
+    if (options.prefetch_model_file != 0 || observer != nullptr) {
+      // A file that cannot be mapped still goes to the loader, which reports
+      // the real error if it cannot read it either.
+      mapping = ModelFileMapping::Acquire(model_path, nullptr);
+      if (mapping != nullptr && options.prefetch_model_file != 0) {
+        mapping->Prefetch();
+      }
+    }
 
-    auto context = std::make_shared<EngineContext>();
-    context->backend_preference = backend_preference;
-    context->model_path = model_path;
-    context->inference = std::make_unique<Inference>(model_path);
+    // A prefetched mapping is reading the file before the loader needs it,
+    // so an asynchronous open follows that read and can still be cancelled
+    // during it. Once Inference is being constructed the load runs to
+    // completion.
+    if (observer != nullptr) {
+      const bool completed = mapping != nullptr && options.prefetch_model_file != 0
+                                  ? WatchPrefetch(*mapping, *observer)
+                                  : !(observer->should_cancel && observer->should_cancel());
+      if (!completed) {
+        SetLastError("cancelled");
+        return AMS_ERR_CANCELLED;
+      }
+    }
+
+    auto model = std::make_shared<ResidentModel>();
+    {
+      // Inference takes no backend parameter: BSRoformer.cpp reads its
+      // backend flags from the environment while it is constructed, so the
+      // preference can only be passed that way. The override keeps the flags
+      // set for that window, skips the write when they already match, and
+      // makes opens with different preferences wait for each other. It
+      // cannot stop other threads reading the environment during a write.
+      ScopedEnvOverride env(BackendEnvSettings(backend_preference));
+      ResidencyWatcher watcher(observer != nullptr ? mapping : nullptr,
+                               observer != nullptr ? observer->set_progress : nullptr);
+      model->inference = std::make_unique<Inference>(model_path);
+    }
+    model->requested_backend = RequestedBackendName(backend_preference);
+    model->file_stamp = file_stamp;
+    mapping.reset();
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(std::filesystem::u8path(model_path), ec);
+    model->resident_bytes = ec ? 0 : static_cast<int64_t>(file_size);
+    // The model already loaded, so a header this probe cannot parse only
+    // leaves the optional fields empty.
+    ProbeGgufModel(model_path, &model->info, nullptr);
+    model->info.chunk_size = model->inference->GetDefaultChunkSize();
+    model->info.num_overlap = model->inference->GetDefaultNumOverlap();
+    model->info.sample_rate = model->inference->GetSampleRate();
 
     std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pool_.find(key);
+    if (it != pool_.end()) {
+      // Another Open loaded the same model meanwhile; keep the first one.
+      hits_ += 1;
+    } else {
+      misses_ += 1;
+      it = pool_.emplace(key, PoolEntry{std::move(model), 0, {}}).first;
+    }
+    it->second.open_handles += 1;
+    context->model = it->second.model;
     context->handle = next_handle_++;
     engines_[context->handle] = context;
     *out_handle = context->handle;
+    TrimLocked(std::chrono::steady_clock::now());
     return AMS_OK;
   } catch (const std::exception& e) {
     SetLastError(std::string("failed to create engine: ") + e.what());
@@ -134,6 +338,45 @@ ams_code_t EngineManager::Open(const std::string& model_path,
   }
 }
 
+bool EngineManager::EnsureReplicas(const EngineContext& engine,
+                                   size_t count,
+                                   std::string* error_message) {
+  ResidentModel& model = *engine.model;
+  if (model.replicas.size() + 1 < count) {
+    // A replica is loaded from the path again; after a replacement it would
+    // hold different weights than the model it is meant to copy.
+    FileStamp current;
+    if (!ReadFileStamp(engine.model_path, &current) || current != model.file_stamp) {
+      if (error_message != nullptr) {
+        *error_message = "model file changed since the engine was opened";
+      }
+      return false;
+    }
+  }
+  try {
+    while (model.replicas.size() + 1 < count) {
+      std::unique_ptr<Inference> replica;
+      {
+        ScopedEnvOverride env(BackendEnvSettings(engine.backend_preference));
+        replica = std::make_unique<Inference>(engine.model_path);
+      }
+      model.replicas.push_back(std::move(replica));
+
+      std::error_code ec;
+      const auto file_size =
+          std::filesystem::file_size(std::filesystem::u8path(engine.model_path), ec);
+      std::lock_guard<std::mutex> lock(mutex_);
+      model.resident_bytes += ec ? 0 : static_cast<int64_t>(file_size);
+    }
+  } catch (const std::exception& e) {
+    if (error_message != nullptr) {
+      *error_message = std::string("failed to load model replica: ") + e.what();
+    }
+    return false;
+  }
+  return true;
+}
+
 std::shared_ptr<EngineContext> EngineManager::Find(ams_engine_t handle) {
   std::lock_guard<std::mutex> lock(mutex_);
   auto it = engines_.find(handle);
@@ -155,8 +398,143 @@ ams_code_t EngineManager::Close(ams_engine_t handle) {
     SetLastError("engine not found");
     return AMS_ERR_NOT_FOUND;
   }
+  const PoolKey key{it->second->model_path,
+                    it->second->backend_preference,
+                    it->second->model->file_stamp};
   engines_.erase(it);
+
+  auto entry = pool_.find(key);
+  if (entry != pool_.end() && entry->second.open_handles > 0) {
+    entry->second.open_handles -= 1;
+    if (entry->second.open_handles == 0) {
+      entry->second.idle_since = std::chrono::steady_clock::now();
+    }
+  }
+  TrimLocked(std::chrono::steady_clock::now());
+  EnsureReaperLocked();
   return AMS_OK;
 }
 
+bool EngineManager::FindResidentInfo(const std::string& model_path, ModelInfo* out_info) {
+  FileStamp current;
+  if (!ReadFileStamp(model_path, &current)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [key, entry] : pool_) {
+    if (key.model_path == model_path && key.file_stamp == current) {
+      *out_info = entry.model->info;
+      return true;
+    }
+  }
+  return false;
+}
+
+void EngineManager::ConfigurePool(int64_t idle_ttl_ms, int64_t max_resident_bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_ttl_ms >= 0) {
+      idle_ttl_ms_ = idle_ttl_ms;
+    }
+    if (max_resident_bytes >= 0) {
+      max_resident_bytes_ = max_resident_bytes;
+    }
+    TrimLocked(std::chrono::steady_clock::now());
+  }
+  reaper_cv_.notify_all();
+}
+
+void EngineManager::GetPoolStats(ams_engine_pool_stats_t* out_stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  TrimLocked(std::chrono::steady_clock::now());
+  ams_engine_pool_stats_t stats{};
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  for (const auto& [key, entry] : pool_) {
+    stats.resident_models += 1;
+    stats.resident_bytes += entry.model->resident_bytes;
+    if (entry.open_handles == 0) {
+      stats.idle_models += 1;
+    }
+  }
+  *out_stats = stats;
+}
+
+void EngineManager::MarkStaleLocked(const std::string& model_path, const FileStamp& current) {
+  for (auto& [key, entry] : pool_) {
+    if (key.model_path == model_path && key.file_stamp != current) {
+      entry.stale = true;
+    }
+  }
+}
+
+void EngineManager::TrimLocked(std::chrono::steady_clock::time_point now) {
+  const auto ttl = std::chrono::milliseconds(idle_ttl_ms_);
+  int64_t resident_bytes = 0;
+  for (auto it = pool_.begin(); it != pool_.end();) {
+    if (it->second.open_handles == 0 &&
+        (it->second.stale || now - it->second.idle_since >= ttl)) {
+      // Jobs still running on this model keep it alive through their
+      // EngineContext; only the pool lets go here.
+      it = pool_.erase(it);
+      evictions_ += 1;
+      continue;
+    }
+    resident_bytes += it->second.model->resident_bytes;
+    ++it;
+  }
+
+  // Over the cap, drop idle models least recently used first. Models with
+  // open handles are never evicted, so the cap can still be exceeded.
+  while (resident_bytes > max_resident_bytes_) {
+    auto oldest = pool_.end();
+    for (auto it = pool_.begin(); it != pool_.end(); ++it) {
+      if (it->second.open_handles == 0 &&
+          (oldest == pool_.end() || it->second.idle_since < oldest->second.idle_since)) {
+        oldest = it;
+      }
+    }
+    if (oldest == pool_.end()) {
+      break;
+    }
+    resident_bytes -= oldest->second.model->resident_bytes;
+    pool_.erase(oldest);
+    evictions_ += 1;
+  }
+}
+
+void EngineManager::EnsureReaperLocked() {
+  if (reaper_.joinable()) {
+    reaper_cv_.notify_all();
+    return;
+  }
+  try {
+    reaper_ = std::thread([this]() { ReaperLoop(); });
+  } catch (const std::exception&) {
+    // Without the reaper idle models are still trimmed on every Open/Close.
+  }
+}
+
+void EngineManager::ReaperLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    auto next_expiry = std::chrono::steady_clock::time_point::max();
+    for (const auto& [key, entry] : pool_) {
+      if (entry.open_handles == 0) {
+        next_expiry =
+            std::min(next_expiry, entry.idle_since + std::chrono::milliseconds(idle_ttl_ms_));
+      }
+    }
+    if (next_expiry == std::chrono::steady_clock::time_point::max()) {
+      reaper_cv_.wait(lock);
+    } else {
+      reaper_cv_.wait_until(lock, next_expiry);
+    }
+    if (!stopping_) {
+      TrimLocked(std::chrono::steady_clock::now());
+    }
+  }
+}
+
 }  // namespace ams
@@ -1,41 +1,152 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "ams_ffi.h"
 #include "bs_roformer/inference.h"
+#include "file_cache.h"
+#include "model_probe.h"
+#include "runtime_env.h"
 
 namespace ams {
 
+// A loaded model, shared by every engine handle opened with the same model
+// file and backend preference.
+struct ResidentModel {
+  std::unique_ptr<Inference> inference;
+  // Extra instances for segmented jobs, loaded on first use and kept for as
+  // long as the model. `inference` is replica 0.
+  std::vector<std::unique_ptr<Inference>> replicas;
+  // Inference keeps per-call scratch state; jobs on handles sharing one
+  // model run it one at a time. Also guards `replicas`.
+  std::mutex run_mutex;
+  int64_t resident_bytes = 0;
+  // Size and mtime of the model file when it was loaded. Apps replace a model
+  // in place, so the path alone does not say which weights these are.
+  FileStamp file_stamp;
+  // Backend the model was requested for, e.g. "CPU" or "Auto". Inference
+  // does not report the device it actually picked, so this is the
+  // preference after platform policy, not a confirmed device.
+  std::string requested_backend;
+  // Header metadata, with chunk size, overlap and sample rate taken from the
+  // loaded model so they always match what inference uses.
+  ModelInfo info;
+};
+
 struct EngineContext {
   ams_engine_t handle = 0;
   int32_t backend_preference = AMS_BACKEND_AUTO;
   std::string model_path;
-  std::unique_ptr<Inference> inference;
+  std::shared_ptr<ResidentModel> model;
+};
+
+// Lets an asynchronous open report load progress and stop early. Progress
+// follows how much of the model file is in the page cache. Cancellation is
+// only seen before Inference is constructed; after that the load runs to
+// completion.
+struct EngineLoadObserver {
+  std::function<bool()> should_cancel;
+  std::function<void(double)> set_progress;
 };
 
 class EngineManager {
  public:
+  static constexpr int64_t kDefaultIdleTtlMs = 5 * 60 * 1000;
+  static constexpr int64_t kDefaultMaxResidentBytes = int64_t{2} << 30;
+
   static EngineManager& Instance();
 
+  ~EngineManager();
+
+  // Reuses a resident model for the same (model_path, backend_preference)
+  // when the file has not changed since it was loaded; otherwise loads it.
+  // Idle models of a replaced file are evicted here, busy ones as soon as
+  // their last handle closes.
   ams_code_t Open(const std::string& model_path,
-                  int32_t backend_preference,
-                  ams_engine_t* out_handle);
+                  const ams_engine_open_options_t& options,
+                  ams_engine_t* out_handle,
+                  const EngineLoadObserver* observer = nullptr);
 
   std::shared_ptr<EngineContext> Find(ams_engine_t handle);
+
+  // Releases the handle. Its model stays resident while idle until the TTL
+  // expires or the resident byte cap needs the room.
   ams_code_t Close(ams_engine_t handle);
 
+  // Negative values keep the current setting; a TTL of 0 releases models as
+  // soon as their last handle closes.
+  void ConfigurePool(int64_t idle_ttl_ms, int64_t max_resident_bytes);
+  void GetPoolStats(ams_engine_pool_stats_t* out_stats);
+
+  // Loads replicas of the engine's model until it has `count` instances in
+  // total, with the engine's backend preference. Each counts toward the
+  // resident byte cap. Fails when the file was replaced since the model was
+  // loaded. The caller must hold the model's run lock.
+  bool EnsureReplicas(const EngineContext& engine, size_t count, std::string* error_message);
+
+  // Copies the info of any resident model loaded from the file now at
+  // `model_path`, so a probe of a loaded model needs no header read.
+  bool FindResidentInfo(const std::string& model_path, ModelInfo* out_info);
+
  private:
+  struct PoolKey {
+    std::string model_path;
+    int32_t backend_preference = AMS_BACKEND_AUTO;
+    FileStamp file_stamp;
+
+    bool operator<(const PoolKey& other) const {
+      if (model_path != other.model_path) {
+        return model_path < other.model_path;
+      }
+      if (backend_preference != other.backend_preference) {
+        return backend_preference < other.backend_preference;
+      }
+      return file_stamp < other.file_stamp;
+    }
+  };
+
+  struct PoolEntry {
+    std::shared_ptr<ResidentModel> model;
+    int32_t open_handles = 0;
+    std::chrono::steady_clock::time_point idle_since;
+    // The file at the path was replaced; evicted once idle.
+    bool stale = false;
+  };
+
   EngineManager() = default;
 
-  void ApplyBackendPreference(int32_t backend_preference);
+  // Environment flags that steer BSRoformer.cpp to `backend_preference`.
+  std::vector<EnvSetting> BackendEnvSettings(int32_t backend_preference);
+  // Marks entries for `model_path` loaded from another version of the file.
+  void MarkStaleLocked(const std::string& model_path, const FileStamp& current);
+  void TrimLocked(std::chrono::steady_clock::time_point now);
+  void EnsureReaperLocked();
+  void ReaperLoop();
 
   std::mutex mutex_;
   ams_engine_t next_handle_ = 1;
   std::unordered_map<ams_engine_t, std::shared_ptr<EngineContext>> engines_;
+
+  std::map<PoolKey, PoolEntry> pool_;
+  int64_t idle_ttl_ms_ = kDefaultIdleTtlMs;
+  int64_t max_resident_bytes_ = kDefaultMaxResidentBytes;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+
+  std::condition_variable reaper_cv_;
+  std::thread reaper_;
+  bool stopping_ = false;
 };
 
 }  // namespace ams
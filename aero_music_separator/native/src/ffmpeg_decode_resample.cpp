@@ -3,9 +3,13 @@
 #include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "canonical_wav_reader.h"
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
@@ -23,7 +27,7 @@ struct InterruptContext {
 
 int InterruptCallback(void* opaque) {
   auto* ctx = static_cast<InterruptContext*>(opaque);
-  if (ctx == nullptr || ctx->cancel == nullptr) {
+  if (ctx == nullptr || ctx->cancel == nullptr || !*ctx->cancel) {
     return 0;
   }
   return (*ctx->cancel)() ? 1 : 0;
@@ -43,16 +47,21 @@ void InitInputLayout(const AVCodecContext* codec_ctx, AVChannelLayout* in_layout
   av_channel_layout_default(in_layout, 2);
 }
 
-bool ConvertFrame(SwrContext* swr,
-                  AVFrame* frame,
-                  int output_sample_rate,
-                  std::vector<float>* out_interleaved,
-                  std::string* error_message) {
+// Resamples `in_samples` samples per channel straight into the tail of
+// `out_interleaved`; the vector only reallocates when its reserved capacity
+// runs out. Null input with 0 samples flushes the resampler.
+bool ConvertSamples(SwrContext* swr,
+                    const uint8_t** in_data,
+                    int in_samples,
+                    int input_sample_rate,
+                    int output_sample_rate,
+                    std::vector<float>* out_interleaved,
+                    std::string* error_message) {
   const int out_channels = 2;
   const int64_t out_samples64 = av_rescale_rnd(
-      swr_get_delay(swr, frame->sample_rate) + frame->nb_samples,
+      swr_get_delay(swr, input_sample_rate) + in_samples,
       output_sample_rate,
-      frame->sample_rate,
+      input_sample_rate,
       AV_ROUND_UP);
   const int out_samples = static_cast<int>(std::min<int64_t>(out_samples64, INT_MAX));
 
@@ -60,49 +69,50 @@ bool ConvertFrame(SwrContext* swr,
     return true;
   }
 
-  std::vector<float> converted(static_cast<size_t>(out_samples) * out_channels);
+  const size_t base = out_interleaved->size();
+  out_interleaved->resize(base + static_cast<size_t>(out_samples) * out_channels);
   uint8_t* out_data[1] = {
-      reinterpret_cast<uint8_t*>(converted.data()),
+      reinterpret_cast<uint8_t*>(out_interleaved->data() + base),
   };
 
-  int converted_samples = swr_convert(
-      swr,
-      out_data,
-      out_samples,
-      const_cast<const uint8_t**>(frame->extended_data),
-      frame->nb_samples);
+  int converted_samples = swr_convert(swr, out_data, out_samples, in_data, in_samples);
 
   if (converted_samples < 0) {
+    out_interleaved->resize(base);
     if (error_message != nullptr) {
       *error_message = "swr_convert failed: " + AvErrToString(converted_samples);
     }
     return false;
   }
 
-  converted.resize(static_cast<size_t>(converted_samples) * out_channels);
-  out_interleaved->insert(out_interleaved->end(), converted.begin(), converted.end());
+  out_interleaved->resize(base + static_cast<size_t>(converted_samples) * out_channels);
   return true;
 }
 
-}  // namespace
+bool ConvertFrame(SwrContext* swr,
+                  AVFrame* frame,
+                  int output_sample_rate,
+                  std::vector<float>* out_interleaved,
+                  std::string* error_message) {
+  return ConvertSamples(swr,
+                        const_cast<const uint8_t**>(frame->extended_data),
+                        frame->nb_samples,
+                        frame->sample_rate,
+                        output_sample_rate,
+                        out_interleaved,
+                        error_message);
+}
 
-namespace ams {
+constexpr int64_t kDecodeBlockFrames = 1 << 16;
+// Room for one decoded codec frame beyond a request so the FIFO does not
+// reallocate while a block is being filled.
+constexpr size_t kFifoSlackSamples = 1 << 14;
 
-bool DecodeToStereoF32(const std::string& input_path,
-                       int target_sample_rate,
-                       std::vector<float>* out_interleaved,
-                       std::function<bool()> cancel_requested,
-                       std::function<void(double)> progress,
-                       std::string* error_message) {
-  if (out_interleaved == nullptr || input_path.empty() || target_sample_rate <= 0) {
-    if (error_message != nullptr) {
-      *error_message = "invalid decode arguments";
-    }
-    return false;
-  }
+}  // namespace
 
-  out_interleaved->clear();
+namespace ams {
 
+struct StreamingDecoder::State {
   AVFormatContext* format_ctx = nullptr;
   AVCodecContext* codec_ctx = nullptr;
   SwrContext* swr_ctx = nullptr;
@@ -112,129 +122,121 @@ bool DecodeToStereoF32(const std::string& input_path,
   AVChannelLayout out_layout = AV_CHANNEL_LAYOUT_STEREO;
 
   int audio_stream_index = -1;
-  bool ok = false;
+  int target_sample_rate = 0;
+  int64_t stream_duration = 0;
+  int64_t estimated_total_frames = -1;
 
-  InterruptContext interrupt{&cancel_requested};
+  std::function<bool()> cancel_requested;
+  InterruptContext interrupt;
 
-  do {
-    format_ctx = avformat_alloc_context();
-    if (format_ctx == nullptr) {
-      if (error_message != nullptr) {
-        *error_message = "avformat_alloc_context failed";
-      }
-      break;
-    }
+  // Set when the input is already PCM16 stereo at the target rate; FFmpeg is
+  // not opened at all in that case.
+  std::unique_ptr<CanonicalWavReader> wav;
 
-    format_ctx->interrupt_callback.callback = InterruptCallback;
-    format_ctx->interrupt_callback.opaque = &interrupt;
+  // Resampled interleaved samples not handed out yet. Consumed from the front
+  // and compacted, so its size never exceeds one request plus one decoded frame.
+  std::vector<float> fifo;
+  size_t fifo_begin = 0;
 
-    int ret = avformat_open_input(&format_ctx, input_path.c_str(), nullptr, nullptr);
-    if (ret < 0) {
-      if (error_message != nullptr) {
-        *error_message = "avformat_open_input failed: " + AvErrToString(ret);
-      }
-      break;
-    }
+  bool draining = false;
+  bool at_end = false;
+  double progress = 0.0;
 
-    ret = avformat_find_stream_info(format_ctx, nullptr);
-    if (ret < 0) {
-      if (error_message != nullptr) {
-        *error_message = "avformat_find_stream_info failed: " + AvErrToString(ret);
-      }
-      break;
+  ~State() {
+    if (frame != nullptr) {
+      av_frame_free(&frame);
     }
-
-    audio_stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
-    if (audio_stream_index < 0) {
-      if (error_message != nullptr) {
-        *error_message = "no audio stream found";
-      }
-      break;
+    if (packet != nullptr) {
+      av_packet_free(&packet);
     }
-
-    AVStream* stream = format_ctx->streams[audio_stream_index];
-    const AVCodecID codec_id = stream->codecpar->codec_id;
-    const AVCodec* decoder = avcodec_find_decoder(codec_id);
-    if (decoder == nullptr) {
-      if (error_message != nullptr) {
-        const char* codec_name = avcodec_get_name(codec_id);
-        *error_message = "audio decoder not found for codec_id=" +
-            std::to_string(static_cast<int>(codec_id)) + ", codec_name=" +
-            (codec_name != nullptr ? std::string(codec_name) : "unknown");
-      }
-      break;
+    if (swr_ctx != nullptr) {
+      swr_free(&swr_ctx);
     }
-
-    codec_ctx = avcodec_alloc_context3(decoder);
-    if (codec_ctx == nullptr) {
-      if (error_message != nullptr) {
-        *error_message = "avcodec_alloc_context3 failed";
-      }
-      break;
+    av_channel_layout_uninit(&in_layout);
+    av_channel_layout_uninit(&out_layout);
+    if (codec_ctx != nullptr) {
+      avcodec_free_context(&codec_ctx);
     }
-
-    ret = avcodec_parameters_to_context(codec_ctx, stream->codecpar);
-    if (ret < 0) {
-      if (error_message != nullptr) {
-        *error_message = "avcodec_parameters_to_context failed: " + AvErrToString(ret);
-      }
-      break;
+    if (format_ctx != nullptr) {
+      avformat_close_input(&format_ctx);
     }
+  }
 
-    ret = avcodec_open2(codec_ctx, decoder, nullptr);
-    if (ret < 0) {
-      if (error_message != nullptr) {
-        *error_message = "avcodec_open2 failed: " + AvErrToString(ret);
-      }
-      break;
-    }
-
-    InitInputLayout(codec_ctx, &in_layout);
-    av_channel_layout_default(&out_layout, 2);
-
-    ret = swr_alloc_set_opts2(
-        &swr_ctx,
-        &out_layout,
-        AV_SAMPLE_FMT_FLT,
-        target_sample_rate,
-        &in_layout,
-        codec_ctx->sample_fmt,
-        codec_ctx->sample_rate,
-        0,
-        nullptr);
-    if (ret < 0 || swr_ctx == nullptr) {
-      if (error_message != nullptr) {
-        *error_message = "swr_alloc_set_opts2 failed: " + AvErrToString(ret);
-      }
-      break;
-    }
+  size_t FifoSamples() const { return fifo.size() - fifo_begin; }
 
-    ret = swr_init(swr_ctx);
-    if (ret < 0) {
-      if (error_message != nullptr) {
-        *error_message = "swr_init failed: " + AvErrToString(ret);
-      }
-      break;
-    }
+  bool Cancelled() const { return cancel_requested && cancel_requested(); }
 
-    packet = av_packet_alloc();
-    frame = av_frame_alloc();
-    if (packet == nullptr || frame == nullptr) {
+  int64_t ReadWav(float* out_interleaved, int64_t max_frames, std::string* error_message) {
+    if (Cancelled()) {
       if (error_message != nullptr) {
-        *error_message = "failed to allocate packet/frame";
+        *error_message = "cancelled";
       }
-      break;
+      return -1;
     }
+    const int64_t frames = wav->Read(out_interleaved, max_frames);
+    const int64_t total = wav->TotalFrames();
+    progress = total > 0 ? static_cast<double>(wav->Position()) / static_cast<double>(total) : 1.0;
+    if (wav->Position() >= total) {
+      at_end = true;
+      progress = 1.0;
+    }
+    return frames;
+  }
 
-    const int64_t duration = stream->duration;
-    while ((ret = av_read_frame(format_ctx, packet)) >= 0) {
-      if (cancel_requested()) {
+  // Decodes into `sink` until it holds `wanted_size` samples or the stream is
+  // exhausted. Mid-stream codec errors end the stream early (matching the
+  // tolerant whole-file decode); only read failures and cancellation are fatal.
+  bool Fill(std::vector<float>* sink, size_t wanted_size, std::string* error_message) {
+    while (sink->size() < wanted_size && !at_end) {
+      if (Cancelled()) {
         if (error_message != nullptr) {
           *error_message = "cancelled";
         }
+        return false;
+      }
+
+      int ret = avcodec_receive_frame(codec_ctx, frame);
+      if (ret >= 0) {
+        std::string convert_error;
+        const bool converted =
+            ConvertFrame(swr_ctx, frame, target_sample_rate, sink, &convert_error);
+        if (stream_duration > 0 && frame->pts != AV_NOPTS_VALUE) {
+          const double ratio =
+              static_cast<double>(frame->pts) / static_cast<double>(stream_duration);
+          progress = std::max(progress, std::max(0.0, std::min(1.0, ratio)));
+        }
+        av_frame_unref(frame);
+        if (!converted) {
+          at_end = true;
+        }
+        continue;
+      }
+      if (ret != AVERROR(EAGAIN)) {
+        at_end = true;
+        break;
+      }
+      if (draining) {
+        at_end = true;
         break;
       }
 
+      ret = av_read_frame(format_ctx, packet);
+      if (ret < 0) {
+        if (ret != AVERROR_EOF) {
+          if (Cancelled()) {
+            if (error_message != nullptr) {
+              *error_message = "cancelled";
+            }
+          } else if (error_message != nullptr) {
+            *error_message = "av_read_frame failed: " + AvErrToString(ret);
+          }
+          return false;
+        }
+        avcodec_send_packet(codec_ctx, nullptr);
+        draining = true;
+        continue;
+      }
+
       if (packet->stream_index != audio_stream_index) {
         av_packet_unref(packet);
         continue;
@@ -242,111 +244,485 @@ bool DecodeToStereoF32(const std::string& input_path,
 
       ret = avcodec_send_packet(codec_ctx, packet);
       av_packet_unref(packet);
-
       if (ret < 0) {
-        if (error_message != nullptr) {
-          *error_message = "avcodec_send_packet failed: " + AvErrToString(ret);
-        }
-        break;
+        avcodec_send_packet(codec_ctx, nullptr);
+        draining = true;
       }
+    }
 
-      while ((ret = avcodec_receive_frame(codec_ctx, frame)) >= 0) {
-        if (!ConvertFrame(
-                swr_ctx,
-                frame,
-                target_sample_rate,
-                out_interleaved,
-                error_message)) {
-          ret = AVERROR_EXTERNAL;
-          break;
-        }
+    if (at_end) {
+      progress = 1.0;
+    }
+    return true;
+  }
+};
 
-        if (progress && duration > 0 && frame->pts != AV_NOPTS_VALUE) {
-          double ratio = static_cast<double>(frame->pts) / static_cast<double>(duration);
-          ratio = std::max(0.0, std::min(1.0, ratio));
-          progress(ratio);
-        }
+StreamingDecoder::StreamingDecoder() = default;
 
-        av_frame_unref(frame);
-      }
+StreamingDecoder::~StreamingDecoder() = default;
 
-      if (ret == AVERROR(EAGAIN)) {
-        continue;
-      }
-      if (ret < 0 && ret != AVERROR_EOF) {
-        if (error_message != nullptr && error_message->empty()) {
-          *error_message = "avcodec_receive_frame failed: " + AvErrToString(ret);
-        }
-        break;
-      }
-      if (ret == AVERROR_EXTERNAL) {
-        break;
-      }
+bool StreamingDecoder::Open(const std::string& input_path,
+                            int target_sample_rate,
+                            std::function<bool()> cancel_requested,
+                            std::string* error_message) {
+  if (input_path.empty() || target_sample_rate <= 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid decode arguments";
     }
+    return false;
+  }
 
-    if (ret < 0 && ret != AVERROR_EOF && (error_message == nullptr || error_message->empty())) {
-      if (error_message != nullptr) {
-        *error_message = "av_read_frame failed: " + AvErrToString(ret);
-      }
-      break;
+  auto state = std::make_unique<State>();
+  state->target_sample_rate = target_sample_rate;
+  state->cancel_requested = std::move(cancel_requested);
+  state->interrupt.cancel = &state->cancel_requested;
+
+  auto wav = std::make_unique<CanonicalWavReader>();
+  if (wav->Open(input_path, target_sample_rate, nullptr)) {
+    state->estimated_total_frames = wav->TotalFrames();
+    state->wav = std::move(wav);
+    state_ = std::move(state);
+    return true;
+  }
+
+  state->format_ctx = avformat_alloc_context();
+  if (state->format_ctx == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "avformat_alloc_context failed";
     }
+    return false;
+  }
+
+  state->format_ctx->interrupt_callback.callback = InterruptCallback;
+  state->format_ctx->interrupt_callback.opaque = &state->interrupt;
 
-    if (error_message != nullptr && *error_message == "cancelled") {
-      break;
+  int ret = avformat_open_input(&state->format_ctx, input_path.c_str(), nullptr, nullptr);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "avformat_open_input failed: " + AvErrToString(ret);
     }
+    return false;
+  }
 
-    avcodec_send_packet(codec_ctx, nullptr);
-    while ((ret = avcodec_receive_frame(codec_ctx, frame)) >= 0) {
-      if (!ConvertFrame(
-              swr_ctx,
-              frame,
-              target_sample_rate,
-              out_interleaved,
-              error_message)) {
-        ret = AVERROR_EXTERNAL;
-        break;
-      }
-      av_frame_unref(frame);
+  ret = avformat_find_stream_info(state->format_ctx, nullptr);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "avformat_find_stream_info failed: " + AvErrToString(ret);
     }
+    return false;
+  }
 
-    if (ret != AVERROR_EOF && ret != AVERROR(EAGAIN) && ret != AVERROR_EXTERNAL) {
-      if (ret < 0 && error_message != nullptr && error_message->empty()) {
-        *error_message = "decoder flush failed: " + AvErrToString(ret);
-      }
+  state->audio_stream_index =
+      av_find_best_stream(state->format_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+  if (state->audio_stream_index < 0) {
+    if (error_message != nullptr) {
+      *error_message = "no audio stream found";
     }
+    return false;
+  }
 
-    if (cancel_requested()) {
-      if (error_message != nullptr) {
-        *error_message = "cancelled";
+  AVStream* stream = state->format_ctx->streams[state->audio_stream_index];
+  const AVCodecID codec_id = stream->codecpar->codec_id;
+  const AVCodec* decoder = avcodec_find_decoder(codec_id);
+  if (decoder == nullptr) {
+    if (error_message != nullptr) {
+      const char* codec_name = avcodec_get_name(codec_id);
+      *error_message = "audio decoder not found for codec_id=" +
+          std::to_string(static_cast<int>(codec_id)) + ", codec_name=" +
+          (codec_name != nullptr ? std::string(codec_name) : "unknown");
+    }
+    return false;
+  }
+
+  state->codec_ctx = avcodec_alloc_context3(decoder);
+  if (state->codec_ctx == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "avcodec_alloc_context3 failed";
+    }
+    return false;
+  }
+
+  ret = avcodec_parameters_to_context(state->codec_ctx, stream->codecpar);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "avcodec_parameters_to_context failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+
+  ret = avcodec_open2(state->codec_ctx, decoder, nullptr);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "avcodec_open2 failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+
+  InitInputLayout(state->codec_ctx, &state->in_layout);
+  av_channel_layout_default(&state->out_layout, 2);
+
+  ret = swr_alloc_set_opts2(
+      &state->swr_ctx,
+      &state->out_layout,
+      AV_SAMPLE_FMT_FLT,
+      target_sample_rate,
+      &state->in_layout,
+      state->codec_ctx->sample_fmt,
+      state->codec_ctx->sample_rate,
+      0,
+      nullptr);
+  if (ret < 0 || state->swr_ctx == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "swr_alloc_set_opts2 failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+
+  ret = swr_init(state->swr_ctx);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "swr_init failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+
+  state->packet = av_packet_alloc();
+  state->frame = av_frame_alloc();
+  if (state->packet == nullptr || state->frame == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "failed to allocate packet/frame";
+    }
+    return false;
+  }
+
+  state->stream_duration = stream->duration;
+  const AVRational output_time_base{1, target_sample_rate};
+  if (stream->duration > 0) {
+    state->estimated_total_frames =
+        av_rescale_q(stream->duration, stream->time_base, output_time_base);
+  } else if (state->format_ctx->duration > 0) {
+    state->estimated_total_frames = av_rescale_q(
+        state->format_ctx->duration, AVRational{1, AV_TIME_BASE}, output_time_base);
+  }
+
+  state_ = std::move(state);
+  return true;
+}
+
+int64_t StreamingDecoder::ReadFrames(float* out_interleaved,
+                                     int64_t max_frames,
+                                     std::string* error_message) {
+  if (state_ == nullptr || out_interleaved == nullptr || max_frames < 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid decode arguments";
+    }
+    return -1;
+  }
+
+  if (state_->wav != nullptr) {
+    return state_->ReadWav(out_interleaved, max_frames, error_message);
+  }
+
+  const size_t wanted_samples = static_cast<size_t>(max_frames) * 2;
+  if (state_->fifo.capacity() < state_->fifo_begin + wanted_samples) {
+    state_->fifo.reserve(state_->fifo_begin + wanted_samples + kFifoSlackSamples);
+  }
+  if (!state_->Fill(&state_->fifo, state_->fifo_begin + wanted_samples, error_message)) {
+    return -1;
+  }
+
+  const size_t samples = std::min(state_->FifoSamples(), wanted_samples);
+  std::copy_n(state_->fifo.data() + state_->fifo_begin, samples, out_interleaved);
+  state_->fifo_begin += samples;
+
+  if (state_->fifo_begin == state_->fifo.size()) {
+    state_->fifo.clear();
+    state_->fifo_begin = 0;
+  } else if (state_->fifo_begin >= state_->FifoSamples()) {
+    state_->fifo.erase(
+        state_->fifo.begin(),
+        state_->fifo.begin() + static_cast<std::ptrdiff_t>(state_->fifo_begin));
+    state_->fifo_begin = 0;
+  }
+
+  return static_cast<int64_t>(samples / 2);
+}
+
+bool StreamingDecoder::ReadAll(std::vector<float>* out_interleaved,
+                               const std::function<void(double)>& progress,
+                               std::string* error_message) {
+  if (state_ == nullptr || out_interleaved == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "invalid decode arguments";
+    }
+    return false;
+  }
+
+  State& s = *state_;
+  if (s.wav != nullptr) {
+    const size_t base = out_interleaved->size();
+    const int64_t remaining = s.wav->TotalFrames() - s.wav->Position();
+    out_interleaved->resize(base + static_cast<size_t>(std::max<int64_t>(remaining, 0)) * 2);
+    size_t written = base;
+    while (!s.at_end) {
+      const int64_t frames =
+          s.ReadWav(out_interleaved->data() + written, kDecodeBlockFrames, error_message);
+      if (frames < 0) {
+        out_interleaved->resize(written);
+        return false;
+      }
+      written += static_cast<size_t>(frames) * 2;
+      if (progress) {
+        progress(s.progress);
       }
-      break;
     }
+    out_interleaved->resize(written);
+    return true;
+  }
+
+  if (s.estimated_total_frames > 0) {
+    // Container durations are approximate; leave a little headroom so the
+    // final frames do not trigger a full reallocation.
+    const size_t estimated_samples =
+        static_cast<size_t>(s.estimated_total_frames + s.target_sample_rate / 10) * 2;
+    out_interleaved->reserve(out_interleaved->size() + estimated_samples);
+  }
+
+  out_interleaved->insert(out_interleaved->end(),
+                          s.fifo.begin() + static_cast<std::ptrdiff_t>(s.fifo_begin),
+                          s.fifo.end());
+  s.fifo.clear();
+  s.fifo_begin = 0;
 
+  const size_t block_samples = static_cast<size_t>(kDecodeBlockFrames) * 2;
+  while (!s.at_end) {
+    if (!s.Fill(out_interleaved, out_interleaved->size() + block_samples, error_message)) {
+      return false;
+    }
     if (progress) {
-      progress(1.0);
+      progress(s.progress);
+    }
+  }
+  return true;
+}
+
+bool StreamingDecoder::AtEnd() const {
+  return state_ == nullptr || (state_->at_end && state_->FifoSamples() == 0);
+}
+
+int StreamingDecoder::SampleRate() const {
+  return state_ != nullptr ? state_->target_sample_rate : 0;
+}
+
+double StreamingDecoder::Progress() const {
+  return state_ != nullptr ? state_->progress : 0.0;
+}
+
+int64_t StreamingDecoder::EstimatedTotalFrames() const {
+  return state_ != nullptr ? state_->estimated_total_frames : -1;
+}
+
+bool DecodeToStereoF32(const std::string& input_path,
+                       int target_sample_rate,
+                       std::vector<float>* out_interleaved,
+                       std::function<bool()> cancel_requested,
+                       std::function<void(double)> progress,
+                       std::string* error_message) {
+  if (out_interleaved == nullptr || input_path.empty() || target_sample_rate <= 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid decode arguments";
+    }
+    return false;
+  }
+
+  out_interleaved->clear();
+
+  StreamingDecoder decoder;
+  if (!decoder.Open(input_path, target_sample_rate, cancel_requested, error_message)) {
+    return false;
+  }
+
+  if (!decoder.ReadAll(out_interleaved, progress, error_message)) {
+    return false;
+  }
+
+  if (cancel_requested()) {
+    if (error_message != nullptr) {
+      *error_message = "cancelled";
     }
-    ok = true;
-  } while (false);
+    return false;
+  }
+
+  if (progress) {
+    progress(1.0);
+  }
+  return true;
+}
 
-  if (frame != nullptr) {
-    av_frame_free(&frame);
+bool DownmixToStereoF32(const float* interleaved,
+                        int64_t frames,
+                        int channels,
+                        int sample_rate,
+                        std::vector<float>* out_interleaved,
+                        std::string* error_message) {
+  if (interleaved == nullptr || out_interleaved == nullptr || frames < 0 || channels <= 0 ||
+      sample_rate <= 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid downmix arguments";
+    }
+    return false;
   }
-  if (packet != nullptr) {
-    av_packet_free(&packet);
+
+  // Both the input span and the stereo output must be addressable.
+  const int64_t widest = std::max(channels, 2);
+  if (frames > std::numeric_limits<int64_t>::max() / widest ||
+      static_cast<uint64_t>(frames) * static_cast<uint64_t>(widest) >
+          std::numeric_limits<size_t>::max() / sizeof(float)) {
+    if (error_message != nullptr) {
+      *error_message = "downmix input too large";
+    }
+    return false;
   }
-  if (swr_ctx != nullptr) {
-    swr_free(&swr_ctx);
+
+  out_interleaved->clear();
+  if (channels == 2) {
+    out_interleaved->assign(interleaved, interleaved + frames * 2);
+    return true;
   }
+
+  AVChannelLayout in_layout;
+  AVChannelLayout out_layout;
+  av_channel_layout_default(&in_layout, channels);
+  av_channel_layout_default(&out_layout, 2);
+  SwrContext* swr = nullptr;
+  int ret = swr_alloc_set_opts2(&swr,
+                                &out_layout,
+                                AV_SAMPLE_FMT_FLT,
+                                sample_rate,
+                                &in_layout,
+                                AV_SAMPLE_FMT_FLT,
+                                sample_rate,
+                                0,
+                                nullptr);
   av_channel_layout_uninit(&in_layout);
   av_channel_layout_uninit(&out_layout);
-  if (codec_ctx != nullptr) {
-    avcodec_free_context(&codec_ctx);
+  std::unique_ptr<SwrContext, void (*)(SwrContext*)> swr_guard(
+      swr, [](SwrContext* ctx) { swr_free(&ctx); });
+  if (ret < 0 || swr == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "swr_alloc_set_opts2 failed: " + AvErrToString(ret);
+    }
+    return false;
   }
-  if (format_ctx != nullptr) {
-    avformat_close_input(&format_ctx);
+  ret = swr_init(swr);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "swr_init failed: " + AvErrToString(ret);
+    }
+    return false;
   }
 
-  return ok;
+  out_interleaved->reserve(static_cast<size_t>(frames) * 2 + kFifoSlackSamples);
+  for (int64_t offset = 0; offset < frames; offset += kDecodeBlockFrames) {
+    const int block = static_cast<int>(std::min(kDecodeBlockFrames, frames - offset));
+    const uint8_t* in_data[1] = {
+        reinterpret_cast<const uint8_t*>(interleaved + offset * channels),
+    };
+    if (!ConvertSamples(
+            swr, in_data, block, sample_rate, sample_rate, out_interleaved, error_message)) {
+      return false;
+    }
+  }
+  return ConvertSamples(
+      swr, nullptr, 0, sample_rate, sample_rate, out_interleaved, error_message);
+}
+
+bool ResampleStereoF32(const std::vector<float>& input,
+                       int input_sample_rate,
+                       int target_sample_rate,
+                       std::vector<float>* out_interleaved,
+                       std::function<bool()> cancel_requested,
+                       std::function<void(double)> progress,
+                       std::string* error_message) {
+  if (out_interleaved == nullptr || input.size() % 2 != 0 || input_sample_rate <= 0 ||
+      target_sample_rate <= 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid resample arguments";
+    }
+    return false;
+  }
+
+  out_interleaved->clear();
+  if (input_sample_rate == target_sample_rate) {
+    *out_interleaved = input;
+    return true;
+  }
+
+  AVChannelLayout layout;
+  av_channel_layout_default(&layout, 2);
+  SwrContext* swr = nullptr;
+  int ret = swr_alloc_set_opts2(&swr,
+                                &layout,
+                                AV_SAMPLE_FMT_FLT,
+                                target_sample_rate,
+                                &layout,
+                                AV_SAMPLE_FMT_FLT,
+                                input_sample_rate,
+                                0,
+                                nullptr);
+  av_channel_layout_uninit(&layout);
+  std::unique_ptr<SwrContext, void (*)(SwrContext*)> swr_guard(
+      swr, [](SwrContext* ctx) { swr_free(&ctx); });
+  if (ret < 0 || swr == nullptr) {
+    if (error_message != nullptr) {
+      *error_message = "swr_alloc_set_opts2 failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+  ret = swr_init(swr);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "swr_init failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+
+  const int64_t total_frames = static_cast<int64_t>(input.size() / 2);
+  const int64_t expected_frames =
+      av_rescale_rnd(total_frames, target_sample_rate, input_sample_rate, AV_ROUND_UP);
+  out_interleaved->reserve(static_cast<size_t>(expected_frames) * 2 + kFifoSlackSamples);
+
+  for (int64_t offset = 0; offset < total_frames; offset += kDecodeBlockFrames) {
+    if (cancel_requested && cancel_requested()) {
+      if (error_message != nullptr) {
+        *error_message = "cancelled";
+      }
+      return false;
+    }
+    const int frames = static_cast<int>(std::min(kDecodeBlockFrames, total_frames - offset));
+    const uint8_t* in_data[1] = {
+        reinterpret_cast<const uint8_t*>(input.data() + offset * 2),
+    };
+    if (!ConvertSamples(swr,
+                        in_data,
+                        frames,
+                        input_sample_rate,
+                        target_sample_rate,
+                        out_interleaved,
+                        error_message)) {
+      return false;
+    }
+    if (progress) {
+      progress(static_cast<double>(offset + frames) / static_cast<double>(total_frames));
+    }
+  }
+  return ConvertSamples(swr,
+                        nullptr,
+                        0,
+                        input_sample_rate,
+                        target_sample_rate,
+                        out_interleaved,
+                        error_message);
 }
 
 }  // namespace ams
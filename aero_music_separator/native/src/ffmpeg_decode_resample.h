@@ -1,11 +1,56 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "pcm_source.h"
+
 namespace ams {
 
+// Pull-based decoder that yields interleaved stereo f32 frames at the target
+// sample rate. Only a bounded FIFO of resampled audio is kept in memory, so
+// callers can start consuming after the first block regardless of file length.
+class StreamingDecoder : public PcmSource {
+ public:
+  StreamingDecoder();
+  ~StreamingDecoder() override;
+
+  StreamingDecoder(const StreamingDecoder&) = delete;
+  StreamingDecoder& operator=(const StreamingDecoder&) = delete;
+
+  bool Open(const std::string& input_path,
+            int target_sample_rate,
+            std::function<bool()> cancel_requested,
+            std::string* error_message);
+
+  // Fills `out_interleaved` with up to `max_frames` stereo frames. Blocks are
+  // always full except the last one. Returns the number of frames written,
+  // 0 at end of stream, or -1 on failure/cancellation.
+  int64_t ReadFrames(float* out_interleaved, int64_t max_frames, std::string* error_message) override;
+
+  // Appends all remaining audio to `out_interleaved`, reserving capacity from
+  // the container duration and resampling straight into the vector's tail.
+  bool ReadAll(std::vector<float>* out_interleaved,
+               const std::function<void(double)>& progress,
+               std::string* error_message);
+
+  bool AtEnd() const;
+  int SampleRate() const;
+
+  // Position of the last decoded frame relative to the stream duration (0..1).
+  double Progress() const override;
+
+  // Estimated output length from container metadata, or -1 when unknown.
+  int64_t EstimatedTotalFrames() const override;
+
+ private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
 bool DecodeToStereoF32(const std::string& input_path,
                        int target_sample_rate,
                        std::vector<float>* out_interleaved,
@@ -13,4 +58,26 @@ bool DecodeToStereoF32(const std::string& input_path,
                        std::function<void(double)> progress,
                        std::string* error_message);
 
+// Converts `frames` frames of interleaved f32 audio with `channels` channels
+// to stereo. Any count other than two takes FFmpeg's default layout for it
+// and swresample's standard matrix, the same one decoding a file with that
+// layout applies: mono reaches both sides at -3 dB and a centre channel is
+// kept. Stereo is copied as is.
+bool DownmixToStereoF32(const float* interleaved,
+                        int64_t frames,
+                        int channels,
+                        int sample_rate,
+                        std::vector<float>* out_interleaved,
+                        std::string* error_message);
+
+// Resamples interleaved stereo f32 audio held in memory. Copies `input` as
+// is when the rates already match.
+bool ResampleStereoF32(const std::vector<float>& input,
+                       int input_sample_rate,
+                       int target_sample_rate,
+                       std::vector<float>* out_interleaved,
+                       std::function<bool()> cancel_requested,
+                       std::function<void(double)> progress,
+                       std::string* error_message);
+
 }  // namespace ams
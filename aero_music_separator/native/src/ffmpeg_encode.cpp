@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -23,6 +24,8 @@ struct EncodeConfig {
   AVSampleFormat forced_sample_format = AV_SAMPLE_FMT_NONE;
 };
 
+constexpr int64_t kEncodeBlockFrames = 1 << 14;
+
 std::string AvErrToString(int errnum) {
   char buffer[AV_ERROR_MAX_STRING_SIZE] = {0};
   av_strerror(errnum, buffer, sizeof(buffer));
@@ -76,6 +79,8 @@ void InitStereoLayout(AVChannelLayout* layout) {
 int SendFrameAndWritePackets(AVCodecContext* codec_ctx,
                              AVFormatContext* format_ctx,
                              AVFrame* frame,
+                             AVPacket* packet,
+                             int64_t* packets_written,
                              std::string* error_message) {
   int ret = avcodec_send_frame(codec_ctx, frame);
   if (ret < 0) {
@@ -85,14 +90,6 @@ int SendFrameAndWritePackets(AVCodecContext* codec_ctx,
     return ret;
   }
 
-  AVPacket* packet = av_packet_alloc();
-  if (packet == nullptr) {
-    if (error_message != nullptr) {
-      *error_message = "av_packet_alloc failed";
-    }
-    return AVERROR(ENOMEM);
-  }
-
   while ((ret = avcodec_receive_packet(codec_ctx, packet)) >= 0) {
     av_packet_rescale_ts(packet, codec_ctx->time_base, format_ctx->streams[0]->time_base);
     packet->stream_index = 0;
@@ -102,12 +99,11 @@ int SendFrameAndWritePackets(AVCodecContext* codec_ctx,
       if (error_message != nullptr) {
         *error_message = "av_interleaved_write_frame failed: " + AvErrToString(ret);
       }
-      av_packet_free(&packet);
       return ret;
     }
+    ++*packets_written;
   }
 
-  av_packet_free(&packet);
   if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
     return 0;
   }
@@ -120,37 +116,120 @@ int SendFrameAndWritePackets(AVCodecContext* codec_ctx,
   return 0;
 }
 
-bool EncodeToFile(const std::string& output_path,
-                  const std::vector<float>& interleaved_audio,
-                  int sample_rate,
-                  const EncodeConfig& config,
-                  std::function<bool()> cancel_requested,
-                  std::function<void(double)> progress,
-                  std::string* error_message) {
-  if (output_path.empty() || sample_rate <= 0 || interleaved_audio.size() % 2 != 0 ||
-      config.codec_id == AV_CODEC_ID_NONE || config.muxer_name == nullptr) {
-    if (error_message != nullptr) {
-      *error_message = "invalid encoder arguments";
+EncodeConfig ConfigForOutputFormat(int32_t output_format) {
+  switch (output_format) {
+    case AMS_OUTPUT_WAV:
+      return EncodeConfig{AV_CODEC_ID_PCM_F32LE, "wav", false, AV_SAMPLE_FMT_NONE};
+    case AMS_OUTPUT_FLAC:
+      return EncodeConfig{AV_CODEC_ID_FLAC, "flac", false, AV_SAMPLE_FMT_NONE};
+    case AMS_OUTPUT_MP3:
+      return EncodeConfig{AV_CODEC_ID_MP3, "mp3", true, AV_SAMPLE_FMT_NONE};
+    default:
+      return EncodeConfig{};
+  }
+}
+
+bool WriteAll(ams::StreamingEncoder* encoder,
+              const std::vector<float>& interleaved_audio,
+              const std::function<bool()>& cancel_requested,
+              const std::function<void(double)>& progress,
+              std::string* error_message) {
+  const int64_t total_frames = static_cast<int64_t>(interleaved_audio.size() / 2);
+  int64_t offset = 0;
+  while (offset < total_frames) {
+    if (cancel_requested()) {
+      if (error_message != nullptr) {
+        *error_message = "cancelled";
+      }
+      return false;
     }
+
+    const int64_t frames = std::min(kEncodeBlockFrames, total_frames - offset);
+    if (!encoder->Write(interleaved_audio.data() + offset * 2, frames, error_message)) {
+      return false;
+    }
+    offset += frames;
+    if (progress) {
+      progress(static_cast<double>(offset) / static_cast<double>(total_frames));
+    }
+  }
+
+  if (!encoder->Finish(error_message)) {
     return false;
   }
+  if (progress) {
+    progress(1.0);
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace ams {
 
+struct StreamingEncoder::State {
   AVFormatContext* format_ctx = nullptr;
   AVCodecContext* codec_ctx = nullptr;
   SwrContext* swr_ctx = nullptr;
-  AVFrame* frame = nullptr;
   AVChannelLayout in_layout = AV_CHANNEL_LAYOUT_STEREO;
   AVChannelLayout out_layout = AV_CHANNEL_LAYOUT_STEREO;
-  bool ok = false;
 
-  do {
+  int sample_rate = 0;
+  int frame_size = 1024;
+  int64_t next_pts = 0;
+  int64_t frames_written = 0;
+  bool finished = false;
+
+  // One frame and one packet are reused for the whole session unless
+  // buffer reuse is switched off for comparison.
+  bool reuse_buffers = true;
+  AVFrame* frame = nullptr;
+  AVPacket* packet = nullptr;
+  EncoderStats stats;
+
+  // Sub-frame remainder between Write() calls; fixed-frame-size encoders only
+  // accept a short frame at the very end of the stream.
+  std::vector<float> pending;
+
+  ~State() {
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    if (swr_ctx != nullptr) {
+      swr_free(&swr_ctx);
+    }
+    av_channel_layout_uninit(&in_layout);
+    av_channel_layout_uninit(&out_layout);
+    if (codec_ctx != nullptr) {
+      avcodec_free_context(&codec_ctx);
+    }
+    if (format_ctx != nullptr) {
+      if (!(format_ctx->oformat->flags & AVFMT_NOFILE) && format_ctx->pb != nullptr) {
+        avio_closep(&format_ctx->pb);
+      }
+      avformat_free_context(format_ctx);
+    }
+  }
+
+  bool Open(const std::string& output_path,
+            int rate,
+            const EncodeConfig& config,
+            std::string* error_message) {
+    if (output_path.empty() || rate <= 0 || config.codec_id == AV_CODEC_ID_NONE ||
+        config.muxer_name == nullptr) {
+      if (error_message != nullptr) {
+        *error_message = "invalid encoder arguments";
+      }
+      return false;
+    }
+    sample_rate = rate;
+
     int ret =
         avformat_alloc_output_context2(&format_ctx, nullptr, config.muxer_name, output_path.c_str());
     if (ret < 0 || format_ctx == nullptr) {
       if (error_message != nullptr) {
         *error_message = "avformat_alloc_output_context2 failed: " + AvErrToString(ret);
       }
-      break;
+      return false;
     }
 
     const AVCodec* codec = avcodec_find_encoder(config.codec_id);
@@ -158,7 +237,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "encoder not found for requested output format";
       }
-      break;
+      return false;
     }
 
     AVStream* stream = avformat_new_stream(format_ctx, codec);
@@ -166,7 +245,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "avformat_new_stream failed";
       }
-      break;
+      return false;
     }
 
     codec_ctx = avcodec_alloc_context3(codec);
@@ -174,7 +253,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "avcodec_alloc_context3 failed";
       }
-      break;
+      return false;
     }
 
     codec_ctx->sample_rate = sample_rate;
@@ -197,7 +276,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "avcodec_open2 failed: " + AvErrToString(ret);
       }
-      break;
+      return false;
     }
 
     ret = avcodec_parameters_from_context(stream->codecpar, codec_ctx);
@@ -205,7 +284,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "avcodec_parameters_from_context failed: " + AvErrToString(ret);
       }
-      break;
+      return false;
     }
     stream->time_base = codec_ctx->time_base;
 
@@ -215,7 +294,7 @@ bool EncodeToFile(const std::string& output_path,
         if (error_message != nullptr) {
           *error_message = "avio_open failed: " + AvErrToString(ret);
         }
-        break;
+        return false;
       }
     }
 
@@ -224,7 +303,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "avformat_write_header failed: " + AvErrToString(ret);
       }
-      break;
+      return false;
     }
 
     av_channel_layout_copy(&out_layout, &codec_ctx->ch_layout);
@@ -243,7 +322,7 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "swr_alloc_set_opts2 failed: " + AvErrToString(ret);
       }
-      break;
+      return false;
     }
 
     ret = swr_init(swr_ctx);
@@ -251,153 +330,276 @@ bool EncodeToFile(const std::string& output_path,
       if (error_message != nullptr) {
         *error_message = "swr_init failed: " + AvErrToString(ret);
       }
-      break;
+      return false;
     }
 
-    const int total_samples = static_cast<int>(interleaved_audio.size() / 2);
-    const int frame_size = codec_ctx->frame_size > 0 ? codec_ctx->frame_size : 1024;
-    int input_offset = 0;
-    int64_t next_pts = 0;
+    frame_size = codec_ctx->frame_size > 0 ? codec_ctx->frame_size : 1024;
+    pending.reserve(static_cast<size_t>(frame_size) * 2);
+    return true;
+  }
 
-    while (input_offset < total_samples || swr_get_delay(swr_ctx, sample_rate) > 0) {
-      if (cancel_requested()) {
-        if (error_message != nullptr) {
-          *error_message = "cancelled";
-        }
-        break;
+  AVFrame* AllocateFrame(std::string* error_message) {
+    AVFrame* allocated = av_frame_alloc();
+    if (allocated == nullptr) {
+      if (error_message != nullptr) {
+        *error_message = "av_frame_alloc failed";
       }
+      return nullptr;
+    }
 
-      const int remaining = total_samples - input_offset;
-      const int in_samples = remaining > 0 ? std::min(frame_size, remaining) : 0;
+    allocated->nb_samples = frame_size;
+    SetupFrameLayout(allocated, codec_ctx);
+    allocated->format = codec_ctx->sample_fmt;
+    allocated->sample_rate = codec_ctx->sample_rate;
 
-      frame = av_frame_alloc();
-      if (frame == nullptr) {
-        if (error_message != nullptr) {
-          *error_message = "av_frame_alloc failed";
-        }
-        break;
+    const int ret = av_frame_get_buffer(allocated, 0);
+    if (ret < 0) {
+      if (error_message != nullptr) {
+        *error_message = "av_frame_get_buffer failed: " + AvErrToString(ret);
       }
+      av_frame_free(&allocated);
+      return nullptr;
+    }
+    ++stats.frame_allocations;
+    return allocated;
+  }
 
-      frame->nb_samples = frame_size;
-      SetupFrameLayout(frame, codec_ctx);
-      frame->format = codec_ctx->sample_fmt;
-      frame->sample_rate = codec_ctx->sample_rate;
-
-      ret = av_frame_get_buffer(frame, 0);
-      if (ret < 0) {
-        if (error_message != nullptr) {
-          *error_message = "av_frame_get_buffer failed: " + AvErrToString(ret);
-        }
-        break;
-      }
+  // Returns a frame whose buffer may be written. The pooled frame is only
+  // reallocated when the encoder still holds a reference to its data.
+  AVFrame* AcquireFrame(std::string* error_message) {
+    if (!reuse_buffers) {
+      return AllocateFrame(error_message);
+    }
+    if (frame == nullptr) {
+      frame = AllocateFrame(error_message);
+      return frame;
+    }
 
-      const uint8_t* in_data[1] = {nullptr};
-      if (in_samples > 0) {
-        in_data[0] = reinterpret_cast<const uint8_t*>(interleaved_audio.data() + (input_offset * 2));
+    frame->nb_samples = frame_size;
+    const int ret = av_frame_make_writable(frame);
+    if (ret < 0) {
+      if (error_message != nullptr) {
+        *error_message = "av_frame_make_writable failed: " + AvErrToString(ret);
       }
+      return nullptr;
+    }
+    return frame;
+  }
 
-      const int converted = swr_convert(
-          swr_ctx,
-          frame->data,
-          frame->nb_samples,
-          in_samples > 0 ? in_data : nullptr,
-          in_samples);
+  void ReleaseFrame(AVFrame* used) {
+    if (used != frame) {
+      av_frame_free(&used);
+    }
+  }
 
-      if (converted < 0) {
+  int SendAndWrite(AVFrame* input, std::string* error_message) {
+    AVPacket* target = packet;
+    if (target == nullptr || !reuse_buffers) {
+      target = av_packet_alloc();
+      if (target == nullptr) {
         if (error_message != nullptr) {
-          *error_message = "swr_convert failed: " + AvErrToString(converted);
+          *error_message = "av_packet_alloc failed";
         }
-        break;
+        return AVERROR(ENOMEM);
       }
-
-      if (converted == 0 && in_samples == 0) {
-        av_frame_free(&frame);
-        frame = nullptr;
-        break;
+      ++stats.packet_allocations;
+      if (reuse_buffers) {
+        packet = target;
       }
+    }
 
-      frame->nb_samples = converted;
-      frame->pts = next_pts;
-      next_pts += converted;
+    const int ret = SendFrameAndWritePackets(
+        codec_ctx, format_ctx, input, target, &stats.packets_written, error_message);
+    if (target != packet) {
+      av_packet_free(&target);
+    }
+    return ret;
+  }
 
-      ret = SendFrameAndWritePackets(codec_ctx, format_ctx, frame, error_message);
-      av_frame_free(&frame);
-      frame = nullptr;
-      if (ret < 0) {
-        break;
-      }
+  // Converts up to one codec frame of input and sends it. Passing no input
+  // drains the resampler. Returns 1 when a frame was sent, 0 when there was
+  // nothing left to send, and -1 on failure.
+  int EncodeFrame(const float* interleaved, int in_samples, std::string* error_message) {
+    AVFrame* target = AcquireFrame(error_message);
+    if (target == nullptr) {
+      return -1;
+    }
 
-      input_offset += in_samples;
-      if (progress) {
-        const double p = total_samples > 0
-                             ? static_cast<double>(input_offset) / static_cast<double>(total_samples)
-                             : 1.0;
-        progress(std::max(0.0, std::min(1.0, p)));
+    const uint8_t* in_data[1] = {reinterpret_cast<const uint8_t*>(interleaved)};
+    const int converted = swr_convert(
+        swr_ctx,
+        target->data,
+        target->nb_samples,
+        in_samples > 0 ? in_data : nullptr,
+        in_samples);
+
+    if (converted < 0) {
+      if (error_message != nullptr) {
+        *error_message = "swr_convert failed: " + AvErrToString(converted);
       }
+      ReleaseFrame(target);
+      return -1;
     }
 
-    if (error_message != nullptr && *error_message == "cancelled") {
-      break;
+    if (converted == 0 && in_samples == 0) {
+      ReleaseFrame(target);
+      return 0;
     }
 
-    if (error_message == nullptr || error_message->empty()) {
-      ret = SendFrameAndWritePackets(codec_ctx, format_ctx, nullptr, error_message);
-      if (ret < 0) {
-        break;
-      }
-    }
+    target->nb_samples = converted;
+    target->pts = next_pts;
+    next_pts += converted;
 
-    ret = av_write_trailer(format_ctx);
+    const int ret = SendAndWrite(target, error_message);
+    ReleaseFrame(target);
     if (ret < 0) {
-      if (error_message != nullptr) {
-        *error_message = "av_write_trailer failed: " + AvErrToString(ret);
-      }
-      break;
+      return -1;
     }
+    ++stats.frames_encoded;
+    return 1;
+  }
+};
 
-    if (progress) {
-      progress(1.0);
+StreamingEncoder::StreamingEncoder() = default;
+
+StreamingEncoder::~StreamingEncoder() = default;
+
+bool StreamingEncoder::Open(const std::string& output_path,
+                            int sample_rate,
+                            int32_t output_format,
+                            std::string* error_message) {
+  const EncodeConfig config = ConfigForOutputFormat(output_format);
+  if (config.codec_id == AV_CODEC_ID_NONE) {
+    if (error_message != nullptr) {
+      *error_message = "unsupported output format";
     }
-    ok = true;
-  } while (false);
+    return false;
+  }
 
-  if (frame != nullptr) {
-    av_frame_free(&frame);
+  auto state = std::make_unique<State>();
+  state->reuse_buffers = reuse_buffers_;
+  if (!state->Open(output_path, sample_rate, config, error_message)) {
+    return false;
+  }
+  state_ = std::move(state);
+  return true;
+}
+
+bool StreamingEncoder::OpenCanonicalWavPcm16(const std::string& output_path,
+                                             int sample_rate,
+                                             std::string* error_message) {
+  const EncodeConfig config{
+      AV_CODEC_ID_PCM_S16LE,
+      "wav",
+      false,
+      AV_SAMPLE_FMT_S16,
+  };
+
+  auto state = std::make_unique<State>();
+  state->reuse_buffers = reuse_buffers_;
+  if (!state->Open(output_path, sample_rate, config, error_message)) {
+    return false;
   }
-  if (swr_ctx != nullptr) {
-    swr_free(&swr_ctx);
+  state_ = std::move(state);
+  return true;
+}
+
+bool StreamingEncoder::Write(const float* interleaved, int64_t frames, std::string* error_message) {
+  if (state_ == nullptr || state_->finished || frames < 0 ||
+      (interleaved == nullptr && frames > 0)) {
+    if (error_message != nullptr) {
+      *error_message = "invalid encoder arguments";
+    }
+    return false;
   }
-  av_channel_layout_uninit(&in_layout);
-  av_channel_layout_uninit(&out_layout);
-  if (codec_ctx != nullptr) {
-    avcodec_free_context(&codec_ctx);
+
+  State& s = *state_;
+  const int64_t frame_size = s.frame_size;
+  int64_t offset = 0;
+
+  if (!s.pending.empty()) {
+    const int64_t pending_frames = static_cast<int64_t>(s.pending.size() / 2);
+    const int64_t take = std::min(frame_size - pending_frames, frames);
+    s.pending.insert(s.pending.end(), interleaved, interleaved + take * 2);
+    offset = take;
+    if (pending_frames + take < frame_size) {
+      s.frames_written += frames;
+      return true;
+    }
+    if (s.EncodeFrame(s.pending.data(), s.frame_size, error_message) < 0) {
+      return false;
+    }
+    s.pending.clear();
   }
-  if (format_ctx != nullptr) {
-    if (!(format_ctx->oformat->flags & AVFMT_NOFILE) && format_ctx->pb != nullptr) {
-      avio_closep(&format_ctx->pb);
+
+  while (frames - offset >= frame_size) {
+    if (s.EncodeFrame(interleaved + offset * 2, s.frame_size, error_message) < 0) {
+      return false;
     }
-    avformat_free_context(format_ctx);
+    offset += frame_size;
   }
 
-  return ok;
+  if (offset < frames) {
+    s.pending.assign(interleaved + offset * 2, interleaved + frames * 2);
+  }
+  s.frames_written += frames;
+  return true;
 }
 
-EncodeConfig ConfigForOutputFormat(int32_t output_format) {
-  switch (output_format) {
-    case AMS_OUTPUT_WAV:
-      return EncodeConfig{AV_CODEC_ID_PCM_F32LE, "wav", false, AV_SAMPLE_FMT_NONE};
-    case AMS_OUTPUT_FLAC:
-      return EncodeConfig{AV_CODEC_ID_FLAC, "flac", false, AV_SAMPLE_FMT_NONE};
-    case AMS_OUTPUT_MP3:
-      return EncodeConfig{AV_CODEC_ID_MP3, "mp3", true, AV_SAMPLE_FMT_NONE};
-    default:
-      return EncodeConfig{};
+bool StreamingEncoder::Finish(std::string* error_message) {
+  if (state_ == nullptr || state_->finished) {
+    if (error_message != nullptr) {
+      *error_message = "invalid encoder arguments";
+    }
+    return false;
+  }
+
+  State& s = *state_;
+  if (!s.pending.empty()) {
+    const int pending_frames = static_cast<int>(s.pending.size() / 2);
+    if (s.EncodeFrame(s.pending.data(), pending_frames, error_message) < 0) {
+      return false;
+    }
+    s.pending.clear();
+  }
+
+  while (swr_get_delay(s.swr_ctx, s.sample_rate) > 0) {
+    const int sent = s.EncodeFrame(nullptr, 0, error_message);
+    if (sent < 0) {
+      return false;
+    }
+    if (sent == 0) {
+      break;
+    }
   }
+
+  if (s.SendAndWrite(nullptr, error_message) < 0) {
+    return false;
+  }
+
+  const int ret = av_write_trailer(s.format_ctx);
+  if (ret < 0) {
+    if (error_message != nullptr) {
+      *error_message = "av_write_trailer failed: " + AvErrToString(ret);
+    }
+    return false;
+  }
+
+  s.finished = true;
+  return true;
 }
 
-}  // namespace
+int64_t StreamingEncoder::FramesWritten() const {
+  return state_ != nullptr ? state_->frames_written : 0;
+}
 
-namespace ams {
+void StreamingEncoder::SetBufferReuse(bool enabled) {
+  reuse_buffers_ = enabled;
+}
+
+EncoderStats StreamingEncoder::Stats() const {
+  return state_ != nullptr ? state_->stats : EncoderStats{};
+}
 
 const char* OutputFormatExtension(int32_t output_format) {
   switch (output_format) {
@@ -419,22 +621,18 @@ bool EncodeFromStereoF32(const std::string& output_path,
                          std::function<bool()> cancel_requested,
                          std::function<void(double)> progress,
                          std::string* error_message) {
-  const EncodeConfig config = ConfigForOutputFormat(output_format);
-  if (config.codec_id == AV_CODEC_ID_NONE) {
+  if (interleaved_audio.size() % 2 != 0) {
     if (error_message != nullptr) {
-      *error_message = "unsupported output format";
+      *error_message = "invalid encoder arguments";
     }
     return false;
   }
 
-  return EncodeToFile(
-      output_path,
-      interleaved_audio,
-      sample_rate,
-      config,
-      std::move(cancel_requested),
-      std::move(progress),
-      error_message);
+  StreamingEncoder encoder;
+  if (!encoder.Open(output_path, sample_rate, output_format, error_message)) {
+    return false;
+  }
+  return WriteAll(&encoder, interleaved_audio, cancel_requested, progress, error_message);
 }
 
 bool WriteCanonicalInputWavPcm16(const std::string& output_path,
@@ -443,20 +641,18 @@ bool WriteCanonicalInputWavPcm16(const std::string& output_path,
                                  std::function<bool()> cancel_requested,
                                  std::function<void(double)> progress,
                                  std::string* error_message) {
-  const EncodeConfig config{
-      AV_CODEC_ID_PCM_S16LE,
-      "wav",
-      false,
-      AV_SAMPLE_FMT_S16,
-  };
-  return EncodeToFile(
-      output_path,
-      interleaved_audio,
-      sample_rate,
-      config,
-      std::move(cancel_requested),
-      std::move(progress),
-      error_message);
+  if (interleaved_audio.size() % 2 != 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid encoder arguments";
+    }
+    return false;
+  }
+
+  StreamingEncoder encoder;
+  if (!encoder.OpenCanonicalWavPcm16(output_path, sample_rate, error_message)) {
+    return false;
+  }
+  return WriteAll(&encoder, interleaved_audio, cancel_requested, progress, error_message);
 }
 
 }  // namespace ams
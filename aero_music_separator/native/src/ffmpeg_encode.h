@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -8,6 +10,51 @@
 
 namespace ams {
 
+struct EncoderStats {
+  int64_t frames_encoded = 0;
+  int64_t packets_written = 0;
+  int64_t frame_allocations = 0;
+  int64_t packet_allocations = 0;
+};
+
+// Incremental stereo f32 encoder. Audio is encoded as it is written; only a
+// sub-frame remainder is buffered between Write() calls.
+class StreamingEncoder {
+ public:
+  StreamingEncoder();
+  ~StreamingEncoder();
+
+  StreamingEncoder(const StreamingEncoder&) = delete;
+  StreamingEncoder& operator=(const StreamingEncoder&) = delete;
+
+  bool Open(const std::string& output_path,
+            int sample_rate,
+            int32_t output_format,
+            std::string* error_message);
+
+  bool OpenCanonicalWavPcm16(const std::string& output_path,
+                             int sample_rate,
+                             std::string* error_message);
+
+  bool Write(const float* interleaved, int64_t frames, std::string* error_message);
+
+  // Flushes the encoder and writes the container trailer.
+  bool Finish(std::string* error_message);
+
+  int64_t FramesWritten() const;
+
+  // Reuse of the codec frame and packet across the session is on by default;
+  // turning it off (before Open) restores per-frame allocation for comparison.
+  void SetBufferReuse(bool enabled);
+
+  EncoderStats Stats() const;
+
+ private:
+  struct State;
+  std::unique_ptr<State> state_;
+  bool reuse_buffers_ = true;
+};
+
 bool EncodeFromStereoF32(const std::string& output_path,
                          const std::vector<float>& interleaved_audio,
                          int sample_rate,
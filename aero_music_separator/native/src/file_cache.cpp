@@ -0,0 +1,196 @@
+#include "file_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+// Temp files this old belong to a writer that crashed.
+constexpr auto kStaleTempAge = std::chrono::hours(24);
+
+// Eviction scans and deletes across a whole directory; serialize it within
+// the process so two finishing tasks do not race on the same files.
+std::mutex& EvictionMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+}  // namespace
+
+namespace ams {
+
+void ContentHasher::Update(const void* data, size_t size) {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = hash_;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= kFnvPrime;
+  }
+  hash_ = hash;
+}
+
+std::string ContentHasher::HexDigest() const {
+  char text[17] = {0};
+  std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash_));
+  return text;
+}
+
+bool ReadFileStamp(const std::string& path, FileStamp* out_stamp) {
+  std::error_code ec;
+  const fs::path file = fs::u8path(path);
+  const uint64_t size = fs::file_size(file, ec);
+  if (ec) {
+    return false;
+  }
+  const auto mtime = fs::last_write_time(file, ec).time_since_epoch().count();
+  if (ec) {
+    return false;
+  }
+  out_stamp->size = size;
+  out_stamp->mtime = static_cast<int64_t>(mtime);
+  return true;
+}
+
+bool AddFileIdentity(const std::string& path, ContentHasher* hasher) {
+  std::error_code ec;
+  const fs::path absolute = fs::absolute(fs::u8path(path), ec);
+  if (ec) {
+    return false;
+  }
+  FileStamp stamp;
+  if (!ReadFileStamp(absolute.u8string(), &stamp)) {
+    return false;
+  }
+  hasher->UpdateString(absolute.u8string());
+  hasher->UpdateValue(stamp.size);
+  hasher->UpdateValue(stamp.mtime);
+  return true;
+}
+
+bool CommitCacheFile(const std::string& temp_path,
+                     const std::string& entry_path,
+                     std::string* error_message) {
+  std::error_code ec;
+  fs::rename(fs::u8path(temp_path), fs::u8path(entry_path), ec);
+  if (ec) {
+    fs::remove(fs::u8path(temp_path), ec);
+    if (error_message != nullptr) {
+      *error_message = "failed to commit cache entry";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool PublishCacheFile(const std::string& entry_path,
+                      const std::string& target_path,
+                      uint64_t token,
+                      std::string* error_message) {
+  const fs::path entry = fs::u8path(entry_path);
+  const fs::path temp = fs::u8path(target_path + "." + std::to_string(token) + kCacheTempExtension);
+  std::error_code ec;
+  fs::remove(temp, ec);
+  ec.clear();
+  fs::create_hard_link(entry, temp, ec);
+  if (ec) {
+    ec.clear();
+    fs::copy_file(entry, temp, fs::copy_options::overwrite_existing, ec);
+  }
+  if (!ec) {
+    fs::rename(temp, fs::u8path(target_path), ec);
+  }
+  // rename() leaves the source in place when both names already link the
+  // same file, so the temp name is removed either way.
+  std::error_code remove_ec;
+  fs::remove(temp, remove_ec);
+  if (ec) {
+    if (error_message != nullptr) {
+      *error_message = "failed to publish cache entry";
+    }
+    return false;
+  }
+  return true;
+}
+
+void TouchCacheFile(const std::string& path) {
+  std::error_code ec;
+  fs::last_write_time(fs::u8path(path), fs::file_time_type::clock::now(), ec);
+}
+
+void EvictCacheFiles(const std::string& dir,
+                     const std::string& entry_extension,
+                     int64_t max_bytes,
+                     const std::string& keep_file_name) {
+  std::lock_guard<std::mutex> lock(EvictionMutex());
+
+  struct Entry {
+    fs::path path;
+    uint64_t size = 0;
+    fs::file_time_type mtime;
+  };
+
+  std::error_code ec;
+  const auto now = fs::file_time_type::clock::now();
+  std::vector<Entry> entries;
+  uint64_t total = 0;
+
+  for (fs::directory_iterator it(fs::u8path(dir), ec), end; !ec && it != end; it.increment(ec)) {
+    const fs::path& path = it->path();
+    std::error_code entry_ec;
+    if (!it->is_regular_file(entry_ec)) {
+      continue;
+    }
+    const fs::file_time_type mtime = fs::last_write_time(path, entry_ec);
+    if (entry_ec) {
+      continue;
+    }
+    if (path.extension() == kCacheTempExtension) {
+      if (now - mtime > kStaleTempAge) {
+        fs::remove(path, entry_ec);
+      }
+      continue;
+    }
+    if (path.extension() != entry_extension) {
+      continue;
+    }
+    const uint64_t size = fs::file_size(path, entry_ec);
+    if (entry_ec) {
+      continue;
+    }
+    total += size;
+    if (path.filename().u8string() != keep_file_name) {
+      entries.push_back(Entry{path, size, mtime});
+    }
+  }
+
+  const uint64_t cap = static_cast<uint64_t>(std::max<int64_t>(max_bytes, 0));
+  if (total <= cap) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.mtime < b.mtime;
+  });
+  for (const Entry& entry : entries) {
+    if (total <= cap) {
+      break;
+    }
+    std::error_code remove_ec;
+    // Removal fails on Windows while a reader still has the file open; it
+    // will be retried on the next eviction.
+    if (fs::remove(entry.path, remove_ec) && !remove_ec) {
+      total -= entry.size;
+    }
+  }
+}
+
+}  // namespace ams
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ams {
+
+// Suffix of entries still being written; see EvictCacheFiles().
+constexpr const char* kCacheTempExtension = ".tmp";
+
+// 64-bit FNV-1a; stable across runs and platforms, which is all the on-disk
+// cache keys need.
+class ContentHasher {
+ public:
+  void Update(const void* data, size_t size);
+
+  template <typename T>
+  void UpdateValue(const T& value) {
+    Update(&value, sizeof(value));
+  }
+
+  void UpdateString(const std::string& text) {
+    UpdateValue(static_cast<uint64_t>(text.size()));
+    Update(text.data(), text.size());
+  }
+
+  // 16 lowercase hex digits.
+  std::string HexDigest() const;
+
+ private:
+  uint64_t hash_ = 1469598103934665603ull;
+};
+
+// Size and modification time of a file; either changes when it is replaced.
+struct FileStamp {
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  bool operator==(const FileStamp& other) const {
+    return size == other.size && mtime == other.mtime;
+  }
+  bool operator!=(const FileStamp& other) const { return !(*this == other); }
+  bool operator<(const FileStamp& other) const {
+    return size != other.size ? size < other.size : mtime < other.mtime;
+  }
+};
+
+// False when `path` cannot be stat'ed.
+bool ReadFileStamp(const std::string& path, FileStamp* out_stamp);
+
+// Adds the absolute path, size and mtime of `path` to `hasher`, so keys built
+// on it change when the file is replaced. False when the file cannot be read.
+bool AddFileIdentity(const std::string& path, ContentHasher* hasher);
+
+// Renames a fully written temp file onto its entry path. The temp file is
+// removed when the rename fails.
+bool CommitCacheFile(const std::string& temp_path,
+                     const std::string& entry_path,
+                     std::string* error_message);
+
+// Hard-links the entry at `entry_path` to `target_path`, or copies it where
+// links are not supported, replacing any file there. The handed-out file
+// survives eviction of the entry. `token` keeps concurrent publishers of the
+// same target apart.
+bool PublishCacheFile(const std::string& entry_path,
+                      const std::string& target_path,
+                      uint64_t token,
+                      std::string* error_message);
+
+// Marks an entry as most recently used.
+void TouchCacheFile(const std::string& path);
+
+// Removes the least recently used `*<entry_extension>` files in `dir` until
+// their total size fits `max_bytes`, never touching `keep_file_name`. Temp
+// files (`*.tmp`) left by a crashed writer are removed once they are a day old.
+void EvictCacheFiles(const std::string& dir,
+                     const std::string& entry_extension,
+                     int64_t max_bytes,
+                     const std::string& keep_file_name);
+
+}  // namespace ams
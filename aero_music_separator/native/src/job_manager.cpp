@@ -1,26 +1,161 @@
 #include "job_manager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <exception>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <sstream>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "error_store.h"
 #include "ffmpeg_decode_resample.h"
 #include "ffmpeg_encode.h"
+#include "file_cache.h"
 #include "json_result.h"
+#include "pcm_source.h"
+#include "result_cache.h"
+#include "segmented_separation.h"
+#include "separation_pipeline.h"
+#include "stem_sink.h"
+#include "task_snapshot.h"
+#include "tuning_profile.h"
 
 namespace {
 
 constexpr const char* kCancelledMessage = "cancelled";
+constexpr int32_t kDefaultReplicas = 2;
+constexpr int32_t kMaxReplicas = 16;
 
 bool IsCancelledMessage(const std::string& message) {
   return message == kCancelledMessage || message == "Inference cancelled";
 }
 
+void NotifyJobEvent(ams::JobContext* job) {
+  job->events.Emit(AMS_EVENT_JOB,
+                   job->handle,
+                   job->state.load(std::memory_order_acquire),
+                   job->stage.load(std::memory_order_acquire),
+                   job->progress.load(std::memory_order_acquire));
+}
+
+// Encodes every stem on a pool of at most hardware_concurrency() threads.
+// `progress` receives the mean completion over all stems; the first failure
+// stops the remaining workers and is the one reported.
+bool EncodeStemsConcurrently(const std::vector<std::vector<float>>& stems,
+                             const std::vector<std::string>& output_paths,
+                             int sample_rate,
+                             int32_t output_format,
+                             const std::function<bool()>& cancel_requested,
+                             const std::function<void(double)>& progress,
+                             std::string* error_message) {
+  const size_t stem_count = stems.size();
+  const size_t worker_count = std::min<size_t>(
+      stem_count, std::max<unsigned>(1, std::thread::hardware_concurrency()));
+
+  std::vector<double> stem_progress(stem_count, 0.0);
+  std::mutex progress_mutex;
+  double reported = 0.0;
+  auto report = [&](size_t index, double value) {
+    std::lock_guard<std::mutex> lock(progress_mutex);
+    stem_progress[index] = std::max(stem_progress[index], value);
+    double sum = 0.0;
+    for (double p : stem_progress) {
+      sum += p;
+    }
+    reported = std::max(reported, sum / static_cast<double>(stem_count));
+    progress(reported);
+  };
+
+  std::atomic<size_t> next_index{0};
+  std::atomic<bool> failed{false};
+  std::mutex error_mutex;
+  std::string first_error;
+  auto should_stop = [&]() -> bool {
+    return failed.load(std::memory_order_acquire) || cancel_requested();
+  };
+
+  auto worker = [&]() {
+    for (;;) {
+      const size_t i = next_index.fetch_add(1, std::memory_order_acq_rel);
+      if (i >= stem_count || should_stop()) {
+        return;
+      }
+
+      std::string encode_error;
+      bool encoded = false;
+      try {
+        encoded = ams::EncodeFromStereoF32(
+            output_paths[i],
+            stems[i],
+            sample_rate,
+            output_format,
+            should_stop,
+            [&](double p) { report(i, p); },
+            &encode_error);
+      } catch (const std::exception& e) {
+        encode_error = e.what();
+      }
+
+      if (!encoded) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        // A worker stopped by another's failure reports a cancel; keep the cause.
+        if (!failed.exchange(true, std::memory_order_acq_rel)) {
+          first_error = encode_error.empty() ? "encode failed" : encode_error;
+        }
+        return;
+      }
+      report(i, 1.0);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(worker_count > 0 ? worker_count - 1 : 0);
+  for (size_t i = 1; i < worker_count; ++i) {
+    try {
+      workers.emplace_back(worker);
+    } catch (const std::exception&) {
+      // Fewer threads only means less parallelism; the loop below still
+      // drains every stem.
+      break;
+    }
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  if (failed.load(std::memory_order_acquire)) {
+    if (error_message != nullptr) {
+      *error_message = first_error;
+    }
+    return false;
+  }
+  if (cancel_requested()) {
+    if (error_message != nullptr) {
+      *error_message = kCancelledMessage;
+    }
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::shared_ptr<const std::vector<float>>> ShareStems(
+    std::vector<std::vector<float>> stems) {
+  std::vector<std::shared_ptr<const std::vector<float>>> shared;
+  shared.reserve(stems.size());
+  for (auto& stem : stems) {
+    shared.push_back(std::make_shared<const std::vector<float>>(std::move(stem)));
+  }
+  return shared;
+}
+
 }  // namespace
 
 namespace ams {
@@ -49,33 +184,59 @@ ams_code_t JobManager::Start(std::shared_ptr<EngineContext> engine,
                              ams_job_t* out_job) {
   const bool has_source_input = !config.input_path.empty();
   const bool has_prepared_input = !config.prepared_input_path.empty();
-  if (engine == nullptr || out_job == nullptr || (!has_source_input && !has_prepared_input) ||
-      config.output_dir.empty()) {
+  const bool has_memory_input = config.input_audio != nullptr;
+  const bool has_output = !config.output_dir.empty() || config.output_format == AMS_OUTPUT_MEMORY;
+  if (engine == nullptr || out_job == nullptr ||
+      (!has_source_input && !has_prepared_input && !has_memory_input) || !has_output) {
     SetLastError("invalid argument: start job");
     return AMS_ERR_INVALID_ARG;
   }
+  // Segments run whole Process() calls on their replicas, with no window
+  // loop to skip from; refuse rather than ignore the threshold.
+  if (config.execution_mode == AMS_EXECUTION_SEGMENTED && config.silence_threshold_db < 0.0) {
+    SetLastError("invalid argument: silence skipping is not supported in segmented mode");
+    return AMS_ERR_INVALID_ARG;
+  }
 
   auto job = std::make_shared<JobContext>();
   job->engine = std::move(engine);
   job->config = config;
+  return Schedule(job, [job]() { RunJob(job); }, out_job);
+}
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    job->handle = next_handle_++;
-    jobs_[job->handle] = job;
+ams_code_t JobManager::StartAutotune(std::shared_ptr<EngineContext> engine,
+                                     const AutotuneConfig& config,
+                                     ams_job_t* out_job) {
+  if (engine == nullptr || out_job == nullptr || config.profile_path.empty()) {
+    SetLastError("invalid argument: start autotune");
+    return AMS_ERR_INVALID_ARG;
   }
 
+  auto job = std::make_shared<JobContext>();
+  job->engine = std::move(engine);
+  job->config.priority = config.priority;
+  return Schedule(job, [job, config]() { RunAutotune(job, config); }, out_job);
+}
+
+ams_code_t JobManager::Schedule(const std::shared_ptr<JobContext>& job,
+                                std::function<void()> task,
+                                ams_job_t* out_job) {
+  // Registered before it is queued so the task never runs, or reports an
+  // event, under a handle poll cannot find yet. Holding the lock across
+  // Submit also publishes `scheduled` to everyone who finds the job.
+  std::lock_guard<std::mutex> lock(mutex_);
+  job->handle = next_handle_++;
+  jobs_[job->handle] = job;
   try {
-    job->worker = std::thread([job]() { RunJob(job); });
+    job->scheduled = TaskScheduler::Instance().Submit(
+        TaskLane::kJob, job->config.priority, std::move(task));
   } catch (const std::exception& e) {
-    std::lock_guard<std::mutex> lock(mutex_);
     jobs_.erase(job->handle);
-    SetLastError(std::string("failed to start job worker thread: ") + e.what());
+    SetLastError(std::string("failed to schedule job: ") + e.what());
     return AMS_ERR_RUNTIME;
   } catch (...) {
-    std::lock_guard<std::mutex> lock(mutex_);
     jobs_.erase(job->handle);
-    SetLastError("failed to start job worker thread: unknown exception");
+    SetLastError("failed to schedule job: unknown exception");
     return AMS_ERR_RUNTIME;
   }
 
@@ -84,7 +245,20 @@ ams_code_t JobManager::Start(std::shared_ptr<EngineContext> engine,
 }
 
 void JobManager::RunJob(const std::shared_ptr<JobContext>& job) {
+  job->started_at_ms.store(SteadyNowMs(), std::memory_order_release);
   job->state.store(AMS_JOB_RUNNING, std::memory_order_release);
+  NotifyJobEvent(job.get());
+  // Settings left at their defaults come from the tuning profile when it has
+  // an entry for this model on this device.
+  TuningEntry tuned;
+  bool has_tuning = false;
+  if (!job->config.tuning_profile_path.empty()) {
+    std::string tuning_key;
+    has_tuning = ComputeTuningKey(job->engine->model_path,
+                                  job->engine->model->requested_backend,
+                                  &tuning_key) &&
+                 LoadTuningEntry(job->config.tuning_profile_path, tuning_key, &tuned);
+  }
 
   auto should_cancel = [&]() -> bool {
     return job->cancel_requested.load(std::memory_order_acquire);
@@ -94,6 +268,7 @@ void JobManager::RunJob(const std::shared_ptr<JobContext>& job) {
     const double clamped = std::max(0.0, std::min(1.0, value));
     job->stage.store(stage, std::memory_order_release);
     job->progress.store(clamped, std::memory_order_release);
+    NotifyJobEvent(job.get());
   };
 
   auto finish_with_error = [&](int32_t state, const std::string& message) {
@@ -102,59 +277,388 @@ void JobManager::RunJob(const std::shared_ptr<JobContext>& job) {
       job->error_message = message;
     }
     job->state.store(state, std::memory_order_release);
+    NotifyJobEvent(job.get());
+  };
+
+  auto fail_with = [&](const std::string& error, const char* fallback) {
+    if (should_cancel() || IsCancelledMessage(error)) {
+      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    } else {
+      finish_with_error(AMS_JOB_FAILED, error.empty() ? fallback : error);
+    }
   };
 
   try {
-    std::filesystem::create_directories(job->config.output_dir);
+    const bool memory_output = job->config.output_format == AMS_OUTPUT_MEMORY;
+    if (!memory_output) {
+      std::filesystem::create_directories(job->config.output_dir);
+    }
 
-    const int sample_rate = job->engine->inference->GetSampleRate();
+    const int sample_rate = job->engine->model->inference->GetSampleRate();
     const std::string model_input_path = job->config.prepared_input_path.empty()
                                              ? job->config.input_path
                                              : job->config.prepared_input_path;
-    std::vector<float> input_audio;
-    std::string ffmpeg_error;
+    const std::string canonical_input_file = job->config.prepared_input_path.empty()
+                                                 ? std::string()
+                                                 : job->config.prepared_input_path;
 
-    set_progress(0.0, AMS_STAGE_DECODE);
-    const bool decoded = DecodeToStereoF32(
-        model_input_path,
-        sample_rate,
-        &input_audio,
-        should_cancel,
-        [&](double p) { set_progress(0.15 * p, AMS_STAGE_DECODE); },
-        &ffmpeg_error);
+    int chunk_size = job->config.chunk_size;
+    int overlap = job->config.overlap;
+    if (chunk_size <= 0) {
+      chunk_size = has_tuning ? tuned.chunk_size
+                              : job->engine->model->inference->GetDefaultChunkSize();
+    }
+    if (overlap <= 0) {
+      overlap = has_tuning ? tuned.overlap : job->engine->model->inference->GetDefaultNumOverlap();
+    }
+    // Start rejects a threshold in segmented mode; pipelined and sequential
+    // jobs both run windows through OverlapAddSeparator when it is set.
+    const float silence_rms_threshold =
+        job->config.silence_threshold_db < 0.0
+            ? static_cast<float>(std::pow(10.0, job->config.silence_threshold_db / 20.0))
+            : 0.0f;
 
-    if (!decoded) {
-      if (should_cancel() || IsCancelledMessage(ffmpeg_error)) {
-        finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    const std::string prefix = job->config.output_prefix.empty() ? "separated" : job->config.output_prefix;
+    const char* extension = OutputFormatExtension(job->config.output_format);
+    auto stem_output_path = [&](size_t index) {
+      std::ostringstream filename;
+      filename << prefix << "_stem_" << index << "." << extension;
+      return JoinPath(job->config.output_dir, filename.str());
+    };
+
+    // Audio handed over in memory is resampled in memory when the model runs
+    // at another rate; a prepare task's canonical WAV may not exist yet.
+    std::shared_ptr<const std::vector<float>> shared_input =
+        job->config.input_audio != nullptr && job->config.input_audio_sample_rate == sample_rate
+            ? job->config.input_audio
+            : nullptr;
+    if (shared_input == nullptr && model_input_path.empty() && job->config.input_audio == nullptr) {
+      finish_with_error(AMS_JOB_FAILED, "job has no input");
+      return;
+    }
+    if (shared_input == nullptr && job->config.input_audio != nullptr) {
+      auto resampled = std::make_shared<std::vector<float>>();
+      std::string resample_error;
+      set_progress(0.0, AMS_STAGE_DECODE);
+      if (!ResampleStereoF32(
+              *job->config.input_audio,
+              job->config.input_audio_sample_rate,
+              sample_rate,
+              resampled.get(),
+              should_cancel,
+              [&](double p) { set_progress(0.15 * p, AMS_STAGE_DECODE); },
+              &resample_error)) {
+        fail_with(resample_error, "resample failed");
+        return;
+      }
+      shared_input = std::move(resampled);
+    }
+
+    // Segmented jobs split the input at replica boundaries, which changes
+    // the output, so the count is part of the result cache key.
+    const size_t replica_count =
+        job->config.execution_mode == AMS_EXECUTION_SEGMENTED
+            ? static_cast<size_t>(job->config.replicas > 0
+                                      ? std::min(job->config.replicas, kMaxReplicas)
+                                      : kDefaultReplicas)
+            : 1;
+
+    // Result cache keys hash the decoded input. Sequential and segmented jobs
+    // decode it in full anyway; a pipelined job only uses the cache when the
+    // input is already in memory, since decoding up front would defeat
+    // streaming.
+    std::unique_ptr<ResultCache> result_cache;
+    std::string result_key;
+    double decoded_up_front = 0.0;
+    // The key also hashes the model file as it is now, so an engine opened
+    // before the file was replaced must not fill or read it.
+    FileStamp model_stamp;
+    const bool model_current = ReadFileStamp(job->engine->model_path, &model_stamp) &&
+                               model_stamp == job->engine->model->file_stamp;
+    const bool cache_usable =
+        model_current &&
+        (job->config.execution_mode != AMS_EXECUTION_PIPELINED || shared_input != nullptr);
+    if (!job->config.result_cache_dir.empty() && cache_usable) {
+      std::error_code ec;
+      std::filesystem::create_directories(
+          std::filesystem::u8path(job->config.result_cache_dir), ec);
+      if (!ec) {
+        result_cache = std::make_unique<ResultCache>(job->config.result_cache_dir,
+                                                     job->config.result_cache_max_bytes);
+      }
+    }
+    if (result_cache != nullptr && shared_input == nullptr) {
+      auto decoded = std::make_shared<std::vector<float>>();
+      std::string decode_error;
+      set_progress(0.0, AMS_STAGE_DECODE);
+      if (!DecodeToStereoF32(
+              model_input_path,
+              sample_rate,
+              decoded.get(),
+              should_cancel,
+              [&](double p) { set_progress(0.15 * p, AMS_STAGE_DECODE); },
+              &decode_error)) {
+        fail_with(decode_error, "decode failed");
+        return;
+      }
+      shared_input = std::move(decoded);
+      decoded_up_front = 0.15;
+    }
+    if (result_cache != nullptr &&
+        !result_cache->ComputeKey(
+            *shared_input,
+            job->engine->model_path,
+            sample_rate,
+            chunk_size,
+            overlap,
+            silence_rms_threshold,
+            job->config.execution_mode,
+            static_cast<int32_t>(replica_count),
+            &result_key)) {
+      result_cache.reset();
+    }
+
+    // A failed store only costs the next run a cache miss.
+    auto store_result = [&](const std::vector<std::vector<float>>& stems) {
+      if (result_cache == nullptr || should_cancel()) {
+        return;
+      }
+      std::string cache_error;
+      if (result_cache->Store(result_key, stems, job->handle, &cache_error)) {
+        result_cache->Evict(result_key);
+      }
+    };
+
+    auto encode_and_finish = [&](std::vector<std::vector<float>> stems,
+                                 int64_t inference_elapsed_ms,
+                                 int32_t replicas,
+                                 double silence_skipped_seconds) {
+      std::vector<std::string> output_files;
+      if (!memory_output) {
+        set_progress(0.90, AMS_STAGE_ENCODE);
+        output_files.reserve(stems.size());
+        for (size_t i = 0; i < stems.size(); ++i) {
+          output_files.push_back(stem_output_path(i));
+        }
+
+        std::string encode_error;
+        const bool encoded = EncodeStemsConcurrently(
+            stems,
+            output_files,
+            sample_rate,
+            job->config.output_format,
+            should_cancel,
+            [&](double p) { set_progress(0.90 + 0.10 * p, AMS_STAGE_ENCODE); },
+            &encode_error);
+
+        if (!encoded) {
+          fail_with(encode_error, "encode failed");
+          return;
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(job->data_mutex);
+        job->result_json = BuildJobResultJson(output_files,
+                                              model_input_path,
+                                              canonical_input_file,
+                                              inference_elapsed_ms,
+                                              job->engine->model->requested_backend,
+                                              replicas,
+                                              silence_skipped_seconds);
+        job->error_message.clear();
+        if (memory_output) {
+          job->memory_stems = ShareStems(std::move(stems));
+        }
+      }
+
+      set_progress(1.0, AMS_STAGE_DONE);
+      job->state.store(AMS_JOB_SUCCEEDED, std::memory_order_release);
+      NotifyJobEvent(job.get());
+    };
+
+    if (result_cache != nullptr) {
+      std::vector<std::vector<float>> cached_stems;
+      if (result_cache->Load(result_key, &cached_stems)) {
+        encode_and_finish(std::move(cached_stems), 0, 1, 0.0);
+        return;
+      }
+    }
+
+    if (job->config.execution_mode == AMS_EXECUTION_PIPELINED) {
+      set_progress(decoded_up_front, AMS_STAGE_DECODE);
+      StreamingDecoder decoder;
+      std::unique_ptr<MemoryPcmSource> memory_source;
+      PcmSource* source = &decoder;
+      std::string pipeline_error;
+      PipelineResult pipeline_result;
+      EncoderStemSink encoder_sink(stem_output_path, sample_rate, job->config.output_format);
+      std::unique_ptr<MemoryStemSink> memory_sink;
+      // The cache entry is written region by region next to the encoders, so
+      // no stem is ever held in full; the key already required the decoded
+      // input, which gives the exact length up front.
+      std::unique_ptr<StemSink> cache_sink;
+      if (result_cache != nullptr) {
+        cache_sink = result_cache->NewEntryWriter(
+            result_key, static_cast<int64_t>(shared_input->size() / 2), job->handle);
+      }
+      bool ok = true;
+      if (shared_input != nullptr) {
+        memory_source = std::make_unique<MemoryPcmSource>(shared_input);
+        source = memory_source.get();
       } else {
-        finish_with_error(AMS_JOB_FAILED, ffmpeg_error.empty() ? "decode failed" : ffmpeg_error);
+        ok = decoder.Open(model_input_path, sample_rate, should_cancel, &pipeline_error);
+      }
+      if (ok) {
+        PipelineConfig pipeline_config;
+        pipeline_config.sample_rate = sample_rate;
+        pipeline_config.chunk_size = chunk_size;
+        pipeline_config.overlap = overlap;
+        if (memory_output) {
+          memory_sink = std::make_unique<MemoryStemSink>(source->EstimatedTotalFrames());
+          pipeline_config.sinks.push_back(memory_sink.get());
+        } else {
+          pipeline_config.sinks.push_back(&encoder_sink);
+        }
+        if (cache_sink != nullptr) {
+          pipeline_config.sinks.push_back(cache_sink.get());
+        }
+        pipeline_config.silence_rms_threshold = silence_rms_threshold;
+        std::lock_guard<std::mutex> model_lock(job->engine->model->run_mutex);
+        ok = RunPipelinedSeparation(
+            source,
+            job->engine->model->inference.get(),
+            pipeline_config,
+            should_cancel,
+            [&](double value, int32_t stage) {
+              set_progress(decoded_up_front + (1.0 - decoded_up_front) * value, stage);
+            },
+            &pipeline_result,
+            &pipeline_error);
       }
+
+      if (!ok) {
+        fail_with(pipeline_error, "pipeline failed");
+        return;
+      }
+      if (result_cache != nullptr) {
+        result_cache->Evict(result_key);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(job->data_mutex);
+        job->result_json = BuildJobResultJson(memory_output ? std::vector<std::string>()
+                                                            : encoder_sink.OutputFiles(),
+                                              model_input_path,
+                                              canonical_input_file,
+                                              pipeline_result.inference_elapsed_ms,
+                                              job->engine->model->requested_backend,
+                                              1,
+                                              pipeline_result.silence_skipped_seconds);
+        job->error_message.clear();
+        if (memory_output) {
+          job->memory_stems = ShareStems(memory_sink->TakeStems());
+        }
+      }
+
+      set_progress(1.0, AMS_STAGE_DONE);
+      job->state.store(AMS_JOB_SUCCEEDED, std::memory_order_release);
+      NotifyJobEvent(job.get());
       return;
     }
 
-    if (should_cancel()) {
-      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    std::vector<float> decoded_audio;
+    std::string ffmpeg_error;
+
+    set_progress(decoded_up_front, AMS_STAGE_DECODE);
+    const bool decoded = shared_input != nullptr ||
+        DecodeToStereoF32(
+            model_input_path,
+            sample_rate,
+            &decoded_audio,
+            should_cancel,
+            [&](double p) { set_progress(0.15 * p, AMS_STAGE_DECODE); },
+            &ffmpeg_error);
+    const std::vector<float>& input_audio = shared_input != nullptr ? *shared_input : decoded_audio;
+
+    if (!decoded) {
+      fail_with(ffmpeg_error, "decode failed");
       return;
     }
 
-    int chunk_size = job->config.chunk_size;
-    int overlap = job->config.overlap;
-    if (chunk_size <= 0) {
-      chunk_size = job->engine->inference->GetDefaultChunkSize();
-    }
-    if (overlap <= 0) {
-      overlap = job->engine->inference->GetDefaultNumOverlap();
+    if (should_cancel()) {
+      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+      return;
     }
 
     set_progress(0.15, AMS_STAGE_INFER);
+    std::unique_lock<std::mutex> model_lock(job->engine->model->run_mutex);
     const auto inference_begin = std::chrono::steady_clock::now();
-    const auto stems = job->engine->inference->Process(
-        input_audio,
-        chunk_size,
-        overlap,
-        [&](float p) { set_progress(0.15 + 0.75 * p, AMS_STAGE_INFER); },
-        should_cancel);
+    std::vector<std::vector<float>> stems;
+    int32_t replicas = 1;
+    double silence_skipped_seconds = 0.0;
+    if (job->config.execution_mode == AMS_EXECUTION_SEGMENTED) {
+      std::string segment_error;
+      if (!EngineManager::Instance().EnsureReplicas(*job->engine, replica_count, &segment_error)) {
+        fail_with(segment_error, "failed to load model replica");
+        return;
+      }
+      std::vector<Inference*> instances{job->engine->model->inference.get()};
+      for (const auto& replica : job->engine->model->replicas) {
+        if (instances.size() == replica_count) {
+          break;
+        }
+        instances.push_back(replica.get());
+      }
+
+      SegmentedConfig segmented_config;
+      segmented_config.chunk_size = chunk_size;
+      segmented_config.overlap = overlap;
+      SegmentedResult segmented_result;
+      if (!RunSegmentedSeparation(
+              input_audio,
+              instances,
+              segmented_config,
+              should_cancel,
+              [&](double p) { set_progress(0.15 + 0.75 * p, AMS_STAGE_INFER); },
+              &segmented_result,
+              &segment_error)) {
+        fail_with(segment_error, "segmented inference failed");
+        return;
+      }
+      stems = std::move(segmented_result.stems);
+      replicas = static_cast<int32_t>(segmented_result.segments);
+    } else if (silence_rms_threshold > 0.0f) {
+      PipelineConfig windowed_config;
+      windowed_config.sample_rate = sample_rate;
+      windowed_config.chunk_size = chunk_size;
+      windowed_config.overlap = overlap;
+      windowed_config.silence_rms_threshold = silence_rms_threshold;
+      PipelineResult windowed_result;
+      std::string windowed_error;
+      if (!RunWindowedSeparation(
+              input_audio,
+              job->engine->model->inference.get(),
+              windowed_config,
+              should_cancel,
+              [&](double p) { set_progress(0.15 + 0.75 * p, AMS_STAGE_INFER); },
+              &stems,
+              &windowed_result,
+              &windowed_error)) {
+        fail_with(windowed_error, "inference failed");
+        return;
+      }
+      silence_skipped_seconds = windowed_result.silence_skipped_seconds;
+    } else {
+      stems = job->engine->model->inference->Process(
+          input_audio,
+          chunk_size,
+          overlap,
+          [&](float p) { set_progress(0.15 + 0.75 * p, AMS_STAGE_INFER); },
+          should_cancel);
+    }
     const auto inference_end = std::chrono::steady_clock::now();
+    model_lock.unlock();
     const int64_t inference_elapsed_ms =
         std::chrono::duration_cast<std::chrono::milliseconds>(inference_end - inference_begin)
             .count();
@@ -169,65 +673,87 @@ void JobManager::RunJob(const std::shared_ptr<JobContext>& job) {
       return;
     }
 
-    set_progress(0.90, AMS_STAGE_ENCODE);
-    const std::string prefix = job->config.output_prefix.empty() ? "separated" : job->config.output_prefix;
-    const char* extension = OutputFormatExtension(job->config.output_format);
+    store_result(stems);
+    encode_and_finish(std::move(stems), inference_elapsed_ms, replicas, silence_skipped_seconds);
+  } catch (const std::exception& e) {
+    if (should_cancel() || IsCancelledMessage(e.what())) {
+      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    } else {
+      finish_with_error(AMS_JOB_FAILED, std::string("job exception: ") + e.what());
+    }
+  }
+}
 
-    std::vector<std::string> output_files;
-    output_files.reserve(stems.size());
+void JobManager::RunAutotune(const std::shared_ptr<JobContext>& job,
+                             const AutotuneConfig& config) {
+  job->started_at_ms.store(SteadyNowMs(), std::memory_order_release);
+  job->state.store(AMS_JOB_RUNNING, std::memory_order_release);
+  job->stage.store(AMS_STAGE_INFER, std::memory_order_release);
+  NotifyJobEvent(job.get());
 
-    for (size_t i = 0; i < stems.size(); ++i) {
-      if (should_cancel()) {
-        finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
-        return;
-      }
+  auto should_cancel = [&]() -> bool {
+    return job->cancel_requested.load(std::memory_order_acquire);
+  };
 
-      std::ostringstream filename;
-      filename << prefix << "_stem_" << i << "." << extension;
-      const std::string output_path = JoinPath(job->config.output_dir, filename.str());
+  auto finish_with_error = [&](int32_t state, const std::string& message) {
+    {
+      std::lock_guard<std::mutex> lock(job->data_mutex);
+      job->error_message = message;
+    }
+    job->state.store(state, std::memory_order_release);
+    NotifyJobEvent(job.get());
+  };
 
-      std::string encode_error;
-      const double segment_begin = 0.90 + (0.10 * static_cast<double>(i) / stems.size());
-      const double segment_size = 0.10 / stems.size();
-
-      const bool encoded = EncodeFromStereoF32(
-          output_path,
-          stems[i],
-          sample_rate,
-          job->config.output_format,
-          should_cancel,
-          [&](double p) { set_progress(segment_begin + segment_size * p, AMS_STAGE_ENCODE); },
-          &encode_error);
+  auto fail_with = [&](const std::string& error, const char* fallback) {
+    if (should_cancel() || IsCancelledMessage(error)) {
+      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    } else {
+      finish_with_error(AMS_JOB_FAILED, error.empty() ? fallback : error);
+    }
+  };
 
-      if (!encoded) {
-        if (should_cancel() || IsCancelledMessage(encode_error)) {
-          finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
-        } else {
-          finish_with_error(AMS_JOB_FAILED, encode_error.empty() ? "encode failed" : encode_error);
-        }
-        return;
-      }
+  try {
+    AutotuneResult result;
+    std::string error;
+    const bool tuned = RunAutotuneTrials(
+        job->engine->model.get(),
+        config,
+        should_cancel,
+        [&](double p) {
+          job->progress.store(0.99 * std::max(0.0, std::min(1.0, p)), std::memory_order_release);
+          NotifyJobEvent(job.get());
+        },
+        &result,
+        &error);
+    if (!tuned) {
+      fail_with(error, "autotune failed");
+      return;
+    }
 
-      output_files.push_back(output_path);
+    std::string key;
+    if (!ComputeTuningKey(job->engine->model_path, job->engine->model->requested_backend, &key)) {
+      finish_with_error(AMS_JOB_FAILED, "failed to identify model file for tuning profile");
+      return;
+    }
+    if (!StoreTuningEntry(config.profile_path, key, result.best, &error)) {
+      finish_with_error(AMS_JOB_FAILED, error.empty() ? "failed to store tuning profile" : error);
+      return;
     }
 
     {
       std::lock_guard<std::mutex> lock(job->data_mutex);
-      const std::string canonical_input_file = job->config.prepared_input_path.empty()
-                                                   ? std::string()
-                                                   : job->config.prepared_input_path;
-      job->result_json = BuildJobResultJson(
-          output_files, model_input_path, canonical_input_file, inference_elapsed_ms);
+      job->result_json = BuildAutotuneResultJson(config.profile_path, result);
       job->error_message.clear();
     }
-
-    set_progress(1.0, AMS_STAGE_DONE);
+    job->stage.store(AMS_STAGE_DONE, std::memory_order_release);
+    job->progress.store(1.0, std::memory_order_release);
     job->state.store(AMS_JOB_SUCCEEDED, std::memory_order_release);
+    NotifyJobEvent(job.get());
   } catch (const std::exception& e) {
     if (should_cancel() || IsCancelledMessage(e.what())) {
       finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
     } else {
-      finish_with_error(AMS_JOB_FAILED, std::string("job exception: ") + e.what());
+      finish_with_error(AMS_JOB_FAILED, std::string("autotune exception: ") + e.what());
     }
   }
 }
@@ -257,6 +783,39 @@ ams_code_t JobManager::Poll(ams_job_t job,
   return AMS_OK;
 }
 
+ams_code_t JobManager::PollMany(const ams_job_t* jobs,
+                             int32_t count,
+                             ams_task_snapshot_t* out_snapshots) {
+  if (count < 0 || (count > 0 && (jobs == nullptr || out_snapshots == nullptr))) {
+    SetLastError("invalid argument: poll many");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  const size_t size = static_cast<size_t>(count);
+  std::vector<std::shared_ptr<JobContext>> contexts(size);
+  std::vector<std::shared_ptr<ScheduledTask>> scheduled(size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < size; ++i) {
+      contexts[i] = FindLocked(jobs[i]);
+      if (contexts[i] != nullptr) {
+        scheduled[i] = contexts[i]->scheduled;
+      }
+    }
+  }
+  std::vector<int32_t> positions(size, -1);
+  TaskScheduler::Instance().QueuePositions(scheduled, positions.data());
+
+  const int64_t now_ms = SteadyNowMs();
+  for (size_t i = 0; i < size; ++i) {
+    out_snapshots[i] = ams_task_snapshot_t{};
+    if (contexts[i] != nullptr) {
+      FillTaskSnapshot(*contexts[i], positions[i], now_ms, &out_snapshots[i]);
+    }
+  }
+  return AMS_OK;
+}
+
 ams_code_t JobManager::Cancel(ams_job_t job) {
   std::shared_ptr<JobContext> ctx;
   {
@@ -269,6 +828,35 @@ ams_code_t JobManager::Cancel(ams_job_t job) {
   }
 
   ctx->cancel_requested.store(true, std::memory_order_release);
+  // A queued task never runs, so nothing else would finish it.
+  if (TaskScheduler::Instance().Withdraw(ctx->scheduled)) {
+    {
+      std::lock_guard<std::mutex> lock(ctx->data_mutex);
+      ctx->error_message = kCancelledMessage;
+    }
+    ctx->state.store(AMS_JOB_CANCELLED, std::memory_order_release);
+    NotifyJobEvent(ctx.get());
+  }
+  return AMS_OK;
+}
+
+ams_code_t JobManager::GetQueuePosition(ams_job_t job, int32_t* out_position) {
+  if (out_position == nullptr) {
+    SetLastError("invalid argument: queue position output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<JobContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(job);
+  }
+  if (ctx == nullptr) {
+    SetLastError("job not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+
+  *out_position = TaskScheduler::Instance().QueuePosition(ctx->scheduled);
   return AMS_OK;
 }
 
@@ -308,6 +896,103 @@ ams_code_t JobManager::GetResultJson(ams_job_t job, std::string* out_json) {
   return AMS_ERR_RUNTIME;
 }
 
+ams_code_t JobManager::GetStemCount(ams_job_t job, int32_t* out_count) {
+  if (out_count == nullptr) {
+    SetLastError("invalid argument: stem count output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<JobContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(job);
+  }
+  if (ctx == nullptr) {
+    SetLastError("job not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+  if (ctx->state.load(std::memory_order_acquire) != AMS_JOB_SUCCEEDED) {
+    SetLastError("job is not completed yet");
+    return AMS_ERR_RUNTIME;
+  }
+
+  std::lock_guard<std::mutex> lock(ctx->data_mutex);
+  *out_count = static_cast<int32_t>(ctx->memory_stems.size());
+  return AMS_OK;
+}
+
+ams_code_t JobManager::FindStem(ams_job_t job,
+                                int32_t index,
+                                std::shared_ptr<const std::vector<float>>* out_stem) {
+  std::shared_ptr<JobContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(job);
+  }
+  if (ctx == nullptr) {
+    SetLastError("job not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+  if (ctx->state.load(std::memory_order_acquire) != AMS_JOB_SUCCEEDED) {
+    SetLastError("job is not completed yet");
+    return AMS_ERR_RUNTIME;
+  }
+
+  std::lock_guard<std::mutex> lock(ctx->data_mutex);
+  if (index < 0 || static_cast<size_t>(index) >= ctx->memory_stems.size()) {
+    SetLastError(ctx->memory_stems.empty() ? "job did not keep its stems in memory"
+                                           : "stem index out of range");
+    return AMS_ERR_INVALID_ARG;
+  }
+  *out_stem = ctx->memory_stems[static_cast<size_t>(index)];
+  return AMS_OK;
+}
+
+ams_code_t JobManager::GetStem(ams_job_t job,
+                               int32_t index,
+                               const float** out_interleaved,
+                               int64_t* out_frames) {
+  if (out_interleaved == nullptr || out_frames == nullptr) {
+    SetLastError("invalid argument: stem output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<const std::vector<float>> stem;
+  const ams_code_t code = FindStem(job, index, &stem);
+  if (code != AMS_OK) {
+    return code;
+  }
+  // The job keeps its own reference until it is destroyed.
+  *out_interleaved = stem->data();
+  *out_frames = static_cast<int64_t>(stem->size() / 2);
+  return AMS_OK;
+}
+
+ams_code_t JobManager::RetainStem(ams_job_t job,
+                                  int32_t index,
+                                  const float** out_interleaved,
+                                  int64_t* out_frames,
+                                  void** out_token) {
+  if (out_interleaved == nullptr || out_frames == nullptr || out_token == nullptr) {
+    SetLastError("invalid argument: stem output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<const std::vector<float>> stem;
+  const ams_code_t code = FindStem(job, index, &stem);
+  if (code != AMS_OK) {
+    return code;
+  }
+  *out_interleaved = stem->data();
+  *out_frames = static_cast<int64_t>(stem->size() / 2);
+  *out_token = new std::shared_ptr<const std::vector<float>>(std::move(stem));
+  return AMS_OK;
+}
+
+void JobManager::ReleaseStem(void* token) {
+  delete static_cast<std::shared_ptr<const std::vector<float>>*>(token);
+}
+
 ams_code_t JobManager::Destroy(ams_job_t job) {
   std::shared_ptr<JobContext> ctx;
   {
@@ -322,9 +1007,8 @@ ams_code_t JobManager::Destroy(ams_job_t job) {
   }
 
   ctx->cancel_requested.store(true, std::memory_order_release);
-  if (ctx->worker.joinable()) {
-    ctx->worker.join();
-  }
+  TaskScheduler::Instance().Withdraw(ctx->scheduled);
+  TaskScheduler::Instance().Wait(ctx->scheduled);
   return AMS_OK;
 }
 
@@ -1,15 +1,18 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "ams_ffi.h"
+#include "autotune.h"
 #include "engine_manager.h"
+#include "task_events.h"
+#include "task_scheduler.h"
 
 namespace ams {
 
@@ -21,6 +24,23 @@ struct JobConfig {
   int32_t output_format = AMS_OUTPUT_WAV;
   int32_t chunk_size = -1;
   int32_t overlap = -1;
+  int32_t execution_mode = AMS_EXECUTION_SEQUENTIAL;
+  // Empty disables the result cache; 0 max bytes selects the default cap.
+  std::string result_cache_dir;
+  int64_t result_cache_max_bytes = 0;
+  int32_t priority = 0;
+  // Tuning profile consulted for chunk size and overlap left at their
+  // defaults; empty skips it.
+  std::string tuning_profile_path;
+  // Negative dBFS level below which pipelined inference windows are skipped;
+  // 0 disables.
+  double silence_threshold_db = 0.0;
+  int32_t replicas = 0;
+
+  // Decoded input shared from a prepare task. Used instead of decoding
+  // `prepared_input_path` when its sample rate matches the model.
+  std::shared_ptr<const std::vector<float>> input_audio;
+  int32_t input_audio_sample_rate = 0;
 };
 
 struct JobContext {
@@ -32,12 +52,19 @@ struct JobContext {
   std::atomic<int32_t> stage{AMS_STAGE_IDLE};
   std::atomic<double> progress{0.0};
   std::atomic<bool> cancel_requested{false};
+  // Steady clock milliseconds at which the task started running; 0 before.
+  std::atomic<int64_t> started_at_ms{0};
+  TaskEventGate events;
 
   std::mutex data_mutex;
   std::string result_json;
   std::string error_message;
+  // Stems of a succeeded AMS_OUTPUT_MEMORY job. Never modified once the job
+  // has succeeded, so borrowed pointers stay valid; a retained stem also
+  // outlives the job until its token is released.
+  std::vector<std::shared_ptr<const std::vector<float>>> memory_stems;
 
-  std::thread worker;
+  std::shared_ptr<ScheduledTask> scheduled;
 };
 
 class JobManager {
@@ -48,19 +75,56 @@ class JobManager {
                    const JobConfig& config,
                    ams_job_t* out_job);
 
+  // Runs autotune trials on the engine's model as a job and stores the best
+  // settings in the tuning profile. Polled, cancelled and destroyed like a
+  // separation job; the result JSON lists every trial.
+  ams_code_t StartAutotune(std::shared_ptr<EngineContext> engine,
+                           const AutotuneConfig& config,
+                           ams_job_t* out_job);
+
   ams_code_t Poll(ams_job_t job,
                   int32_t* out_state,
                   double* out_progress_0_1,
                   int32_t* out_stage);
 
+  // Looks every handle up under one lock. Unknown handles get a snapshot
+  // with `found` = 0 rather than failing the call.
+  ams_code_t PollMany(const ams_job_t* jobs, int32_t count, ams_task_snapshot_t* out_snapshots);
+
+  // Tasks stay AMS_JOB_PENDING while queued; position 0 starts next and -1
+  // means the task has left the queue.
+  ams_code_t GetQueuePosition(ams_job_t job, int32_t* out_position);
+
   ams_code_t Cancel(ams_job_t job);
   ams_code_t GetResultJson(ams_job_t job, std::string* out_json);
+  ams_code_t GetStemCount(ams_job_t job, int32_t* out_count);
+  ams_code_t GetStem(ams_job_t job,
+                     int32_t index,
+                     const float** out_interleaved,
+                     int64_t* out_frames);
+  // GetStem that also hands out a reference to the stem buffer as
+  // `out_token`, released with ReleaseStem.
+  ams_code_t RetainStem(ams_job_t job,
+                        int32_t index,
+                        const float** out_interleaved,
+                        int64_t* out_frames,
+                        void** out_token);
+  static void ReleaseStem(void* token);
   ams_code_t Destroy(ams_job_t job);
 
  private:
   JobManager() = default;
 
+  ams_code_t FindStem(ams_job_t job,
+                      int32_t index,
+                      std::shared_ptr<const std::vector<float>>* out_stem);
+
+  ams_code_t Schedule(const std::shared_ptr<JobContext>& job,
+                      std::function<void()> task,
+                      ams_job_t* out_job);
+
   static void RunJob(const std::shared_ptr<JobContext>& job);
+  static void RunAutotune(const std::shared_ptr<JobContext>& job, const AutotuneConfig& config);
   static std::string JoinPath(const std::string& dir, const std::string& file_name);
 
   std::shared_ptr<JobContext> FindLocked(ams_job_t job);
@@ -43,7 +43,10 @@ namespace ams {
 std::string BuildJobResultJson(const std::vector<std::string>& output_files,
                                const std::string& model_input_file,
                                const std::string& canonical_input_file,
-                               int64_t inference_elapsed_ms) {
+                               int64_t inference_elapsed_ms,
+                               const std::string& requested_backend,
+                               int32_t replicas,
+                               double silence_skipped_seconds) {
   std::ostringstream oss;
   oss << '{';
   AppendJsonStringField(oss, "model_input_file", model_input_file);
@@ -59,7 +62,11 @@ std::string BuildJobResultJson(const std::vector<std::string>& output_files,
     }
     oss << '"' << EscapeJson(output_files[i]) << '"';
   }
-  oss << "],\"inference_elapsed_ms\":" << inference_elapsed_ms << '}';
+  oss << "],\"inference_elapsed_ms\":" << inference_elapsed_ms << ',';
+  AppendJsonStringField(oss, "requested_backend", requested_backend);
+  oss << ",\"replicas\":" << replicas;
+  oss << ",\"silence_skipped_seconds\":" << silence_skipped_seconds;
+  oss << '}';
   return oss.str();
 }
 
@@ -77,4 +84,46 @@ std::string BuildPrepareResultJson(const std::string& canonical_input_file,
   return oss.str();
 }
 
+std::string BuildModelProbeJson(const std::string& model_path, const ModelInfo& info) {
+  std::ostringstream oss;
+  oss << '{';
+  AppendJsonStringField(oss, "model_path", model_path);
+  oss << ",\"gguf_version\":" << info.gguf_version;
+  oss << ',';
+  AppendJsonStringField(oss, "architecture", info.architecture);
+  oss << ",\"sample_rate\":" << info.sample_rate;
+  oss << ",\"chunk_size\":" << info.chunk_size;
+  oss << ",\"num_overlap\":" << info.num_overlap;
+  oss << ",\"stem_count\":" << info.stem_count;
+  oss << ",\"tensor_count\":" << info.tensor_count;
+  oss << ",\"parameter_count\":" << info.parameter_count;
+  oss << ',';
+  AppendJsonStringField(oss, "weight_dtype", info.weight_dtype);
+  oss << '}';
+  return oss.str();
+}
+
+std::string BuildAutotuneResultJson(const std::string& profile_path,
+                                    const AutotuneResult& result) {
+  std::ostringstream oss;
+  oss << '{';
+  AppendJsonStringField(oss, "profile_path", profile_path);
+  oss << ",\"chunk_size\":" << result.best.chunk_size;
+  oss << ",\"overlap\":" << result.best.overlap;
+  oss << ",\"real_time_factor\":" << result.best.real_time_factor;
+  oss << ",\"peak_memory_bytes\":" << result.best.peak_memory_bytes;
+  oss << ",\"trials\":[";
+  for (size_t i = 0; i < result.trials.size(); ++i) {
+    const AutotuneTrial& trial = result.trials[i];
+    if (i > 0) {
+      oss << ',';
+    }
+    oss << "{\"chunk_size\":" << trial.chunk_size;
+    oss << ",\"real_time_factor\":" << trial.real_time_factor;
+    oss << ",\"peak_memory_bytes\":" << trial.peak_memory_bytes << '}';
+  }
+  oss << "]}";
+  return oss.str();
+}
+
 }  // namespace ams
@@ -4,16 +4,27 @@
 #include <string>
 #include <vector>
 
+#include "autotune.h"
+#include "model_probe.h"
+
 namespace ams {
 
 std::string BuildJobResultJson(const std::vector<std::string>& output_files,
                                const std::string& model_input_file,
                                const std::string& canonical_input_file,
-                               int64_t inference_elapsed_ms);
+                               int64_t inference_elapsed_ms,
+                               const std::string& requested_backend,
+                               int32_t replicas,
+                               double silence_skipped_seconds);
 
 std::string BuildPrepareResultJson(const std::string& canonical_input_file,
                                    int32_t sample_rate,
                                    int32_t channels,
                                    int64_t duration_ms);
 
+std::string BuildModelProbeJson(const std::string& model_path, const ModelInfo& info);
+
+std::string BuildAutotuneResultJson(const std::string& profile_path,
+                                    const AutotuneResult& result);
+
 }  // namespace ams
@@ -0,0 +1,168 @@
+#include "model_file_mapping.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::mutex g_registry_mutex;
+std::map<std::string, std::weak_ptr<ams::ModelFileMapping>> g_registry;
+
+}  // namespace
+
+namespace ams {
+
+ModelFileMapping::~ModelFileMapping() {
+#ifdef _WIN32
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(mapping_handle_));
+  }
+  if (file_handle_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_handle_));
+  }
+#else
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+#endif
+}
+
+std::shared_ptr<ModelFileMapping> ModelFileMapping::Acquire(const std::string& path,
+                                                            std::string* error_message) {
+  auto fail = [&](const char* why) -> std::shared_ptr<ModelFileMapping> {
+    if (error_message != nullptr) {
+      *error_message = std::string(why) + ": " + path;
+    }
+    return nullptr;
+  };
+
+  std::lock_guard<std::mutex> lock(g_registry_mutex);
+  auto it = g_registry.find(path);
+  if (it != g_registry.end()) {
+    if (auto existing = it->second.lock()) {
+      return existing;
+    }
+    g_registry.erase(it);
+  }
+
+  std::shared_ptr<ModelFileMapping> mapping(new ModelFileMapping());
+#ifdef _WIN32
+  const int wide_len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  if (wide_len <= 0) {
+    return fail("model path conversion failed");
+  }
+  std::wstring wide_path(static_cast<size_t>(wide_len), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wide_path.data(), wide_len);
+
+  HANDLE file = CreateFileW(wide_path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return fail("failed to open model file");
+  }
+  mapping->file_handle_ = file;
+
+  LARGE_INTEGER file_size{};
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+    return fail("empty or unreadable model file");
+  }
+  HANDLE file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (file_mapping == nullptr) {
+    return fail("failed to map model file");
+  }
+  mapping->mapping_handle_ = file_mapping;
+  mapping->data_ = static_cast<const uint8_t*>(MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mapping->data_ == nullptr) {
+    return fail("failed to map model file");
+  }
+  mapping->size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return fail("failed to open model file");
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return fail("empty or unreadable model file");
+  }
+  void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return fail("failed to map model file");
+  }
+  mapping->data_ = static_cast<const uint8_t*>(mapped);
+  mapping->size_ = static_cast<size_t>(st.st_size);
+#endif
+
+  g_registry[path] = mapping;
+  return mapping;
+}
+
+void ModelFileMapping::Prefetch() const {
+  if (data_ == nullptr || size_ == 0) {
+    return;
+  }
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+  WIN32_MEMORY_RANGE_ENTRY range{const_cast<uint8_t*>(data_), size_};
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+  // Advisory only; a kernel that ignores it just leaves reads on demand.
+  madvise(const_cast<uint8_t*>(data_), size_, MADV_WILLNEED);
+#endif
+}
+
+double ModelFileMapping::ResidentFraction() const {
+  if (data_ == nullptr || size_ == 0) {
+    return -1.0;
+  }
+#ifdef _WIN32
+  // The working set only covers pages this process touched, not the file
+  // cache, so there is nothing meaningful to report.
+  return -1.0;
+#else
+  const long page_size = sysconf(_SC_PAGESIZE);
+  if (page_size <= 0) {
+    return -1.0;
+  }
+  const size_t page = static_cast<size_t>(page_size);
+  const size_t pages = (size_ + page - 1) / page;
+#if defined(__APPLE__)
+  std::vector<char> residency(pages);
+#else
+  std::vector<unsigned char> residency(pages);
+#endif
+  if (mincore(const_cast<uint8_t*>(data_), size_, residency.data()) != 0) {
+    return -1.0;
+  }
+  size_t resident = 0;
+  for (const auto page : residency) {
+    resident += (page & 1) != 0 ? 1 : 0;
+  }
+  return static_cast<double>(resident) / static_cast<double>(pages);
+#endif
+}
+
+}  // namespace ams
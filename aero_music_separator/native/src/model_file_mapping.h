@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ams {
+
+// Read-only mapping of a model file, used to prefetch it into the page cache
+// before the loader reads it and to watch how much of it is cached. Acquire()
+// hands out one mapping per path, so engines loading the same file at once
+// prefetch it only once.
+class ModelFileMapping {
+ public:
+  ~ModelFileMapping();
+
+  ModelFileMapping(const ModelFileMapping&) = delete;
+  ModelFileMapping& operator=(const ModelFileMapping&) = delete;
+
+  // Returns nullptr with `error_message` set when the file cannot be mapped.
+  static std::shared_ptr<ModelFileMapping> Acquire(const std::string& path,
+                                                   std::string* error_message);
+
+  // Asks the OS to start reading the whole file in the background, so the
+  // loader's reads that follow hit the page cache instead of the disk.
+  void Prefetch() const;
+
+  // Share of the file's pages currently in memory, from 0 to 1; negative
+  // where the platform cannot tell.
+  double ResidentFraction() const;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  ModelFileMapping() = default;
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* file_handle_ = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
+}  // namespace ams
@@ -0,0 +1,367 @@
+#include "model_probe.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <utility>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char kMagic[4] = {'G', 'G', 'U', 'F'};
+// Bounds that no real model comes near; they keep a corrupt header from
+// turning into a huge allocation or an endless scan.
+constexpr uint64_t kMaxKvCount = uint64_t{1} << 20;
+constexpr uint64_t kMaxTensorCount = uint64_t{1} << 20;
+constexpr uint64_t kMaxStringBytes = uint64_t{1} << 24;
+constexpr uint32_t kMaxDims = 8;
+
+enum GgufType : uint32_t {
+  kUint8 = 0,
+  kInt8 = 1,
+  kUint16 = 2,
+  kInt16 = 3,
+  kUint32 = 4,
+  kInt32 = 5,
+  kFloat32 = 6,
+  kBool = 7,
+  kString = 8,
+  kArray = 9,
+  kUint64 = 10,
+  kInt64 = 11,
+  kFloat64 = 12,
+};
+
+class GgufReader {
+ public:
+  explicit GgufReader(const std::string& path)
+      : in_(fs::u8path(path), std::ios::binary) {}
+
+  bool ok() const { return static_cast<bool>(in_); }
+
+  template <typename T>
+  bool Read(T* value) {
+    return static_cast<bool>(in_.read(reinterpret_cast<char*>(value), sizeof(T)));
+  }
+
+  bool ReadString(std::string* out) {
+    uint64_t length = 0;
+    if (!Read(&length) || length > kMaxStringBytes) {
+      return false;
+    }
+    out->resize(static_cast<size_t>(length));
+    return length == 0 ||
+           static_cast<bool>(in_.read(out->data(), static_cast<std::streamsize>(length)));
+  }
+
+  bool Skip(uint64_t bytes) {
+    return static_cast<bool>(in_.seekg(static_cast<std::streamoff>(bytes), std::ios::cur));
+  }
+
+ private:
+  std::ifstream in_;
+};
+
+size_t ScalarSize(uint32_t type) {
+  switch (type) {
+    case kUint8:
+    case kInt8:
+    case kBool:
+      return 1;
+    case kUint16:
+    case kInt16:
+      return 2;
+    case kUint32:
+    case kInt32:
+    case kFloat32:
+      return 4;
+    case kUint64:
+    case kInt64:
+    case kFloat64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+// Reads a numeric scalar of any GGUF type; floats count only when integral.
+bool ReadInteger(GgufReader* reader, uint32_t type, int64_t* out, bool* is_integer) {
+  *is_integer = true;
+  switch (type) {
+    case kUint8: {
+      uint8_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kInt8: {
+      int8_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kUint16: {
+      uint16_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kInt16: {
+      int16_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kUint32: {
+      uint32_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kInt32: {
+      int32_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kUint64: {
+      uint64_t v = 0;
+      return reader->Read(&v) && ((*out = static_cast<int64_t>(v)), true);
+    }
+    case kInt64: {
+      int64_t v = 0;
+      return reader->Read(&v) && ((*out = v), true);
+    }
+    case kFloat32: {
+      float v = 0;
+      if (!reader->Read(&v)) {
+        return false;
+      }
+      *is_integer = v == static_cast<float>(static_cast<int64_t>(v));
+      *out = static_cast<int64_t>(v);
+      return true;
+    }
+    case kFloat64: {
+      double v = 0;
+      if (!reader->Read(&v)) {
+        return false;
+      }
+      *is_integer = v == static_cast<double>(static_cast<int64_t>(v));
+      *out = static_cast<int64_t>(v);
+      return true;
+    }
+    default:
+      *is_integer = false;
+      return false;
+  }
+}
+
+bool SkipValue(GgufReader* reader, uint32_t type) {
+  if (type == kString) {
+    uint64_t length = 0;
+    return reader->Read(&length) && reader->Skip(length);
+  }
+  const size_t size = ScalarSize(type);
+  return size != 0 && reader->Skip(size);
+}
+
+// The converter copies these fields from the model's training config
+// (audio.sample_rate, audio.chunk_size, inference.num_overlap,
+// model.num_stems, training.instruments) under a section or architecture
+// prefix, so keys match on their final segment with the config's exact
+// field name. No other spelling is accepted: a value read under a lookalike
+// key would be shown as a default the loader does not use.
+std::string KeyLeaf(const std::string& key) {
+  const size_t dot = key.rfind('.');
+  return dot == std::string::npos ? key : key.substr(dot + 1);
+}
+
+int32_t* IntegerFieldFor(const std::string& leaf, ams::ModelInfo* info) {
+  if (leaf == "sample_rate") {
+    return &info->sample_rate;
+  }
+  if (leaf == "chunk_size") {
+    return &info->chunk_size;
+  }
+  if (leaf == "num_overlap") {
+    return &info->num_overlap;
+  }
+  if (leaf == "num_stems") {
+    return &info->stem_count;
+  }
+  return nullptr;
+}
+
+bool IsStemList(const std::string& leaf) {
+  return leaf == "instruments";
+}
+
+const char* GgmlTypeName(uint32_t type) {
+  switch (type) {
+    case 0: return "F32";
+    case 1: return "F16";
+    case 2: return "Q4_0";
+    case 3: return "Q4_1";
+    case 6: return "Q5_0";
+    case 7: return "Q5_1";
+    case 8: return "Q8_0";
+    case 9: return "Q8_1";
+    case 10: return "Q2_K";
+    case 11: return "Q3_K";
+    case 12: return "Q4_K";
+    case 13: return "Q5_K";
+    case 14: return "Q6_K";
+    case 15: return "Q8_K";
+    case 16: return "IQ2_XXS";
+    case 17: return "IQ2_XS";
+    case 18: return "IQ3_XXS";
+    case 19: return "IQ1_S";
+    case 20: return "IQ4_NL";
+    case 21: return "IQ3_S";
+    case 22: return "IQ2_S";
+    case 23: return "IQ4_XS";
+    case 24: return "I8";
+    case 25: return "I16";
+    case 26: return "I32";
+    case 27: return "I64";
+    case 28: return "F64";
+    case 29: return "IQ1_M";
+    case 30: return "BF16";
+    case 34: return "TQ1_0";
+    case 35: return "TQ2_0";
+    default: return "unknown";
+  }
+}
+
+}  // namespace
+
+namespace ams {
+
+bool ProbeGgufModel(const std::string& path, ModelInfo* out_info, std::string* error_message) {
+  auto fail = [&](const std::string& message) {
+    if (error_message != nullptr) {
+      *error_message = message;
+    }
+    return false;
+  };
+
+  if (out_info == nullptr) {
+    return fail("model info output is null");
+  }
+
+  GgufReader reader(path);
+  if (!reader.ok()) {
+    return fail("failed to open model file: " + path);
+  }
+
+  char magic[4] = {};
+  ModelInfo info;
+  uint64_t tensor_count = 0;
+  uint64_t kv_count = 0;
+  if (!reader.Read(&magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    return fail("model file is not GGUF: " + path);
+  }
+  if (!reader.Read(&info.gguf_version) || (info.gguf_version != 2 && info.gguf_version != 3)) {
+    return fail("unsupported GGUF version in model file: " + path);
+  }
+  if (!reader.Read(&tensor_count) || !reader.Read(&kv_count) ||
+      tensor_count > kMaxTensorCount || kv_count > kMaxKvCount) {
+    return fail("corrupt GGUF header in model file: " + path);
+  }
+  info.tensor_count = static_cast<int64_t>(tensor_count);
+
+  const std::string corrupt_metadata = "corrupt GGUF metadata in model file: " + path;
+  std::string key;
+  for (uint64_t i = 0; i < kv_count; ++i) {
+    uint32_t type = 0;
+    if (!reader.ReadString(&key) || !reader.Read(&type)) {
+      return fail(corrupt_metadata);
+    }
+    const std::string leaf = KeyLeaf(key);
+
+    if (type == kArray) {
+      uint32_t element_type = 0;
+      uint64_t count = 0;
+      if (!reader.Read(&element_type) || !reader.Read(&count)) {
+        return fail(corrupt_metadata);
+      }
+      if (IsStemList(leaf) && info.stem_count == 0 && count <= INT32_MAX) {
+        info.stem_count = static_cast<int32_t>(count);
+      }
+      if (element_type == kString) {
+        for (uint64_t j = 0; j < count; ++j) {
+          if (!SkipValue(&reader, kString)) {
+            return fail(corrupt_metadata);
+          }
+        }
+      } else {
+        const size_t size = ScalarSize(element_type);
+        if (size == 0 || count > UINT64_MAX / size || !reader.Skip(count * size)) {
+          return fail(corrupt_metadata);
+        }
+      }
+      continue;
+    }
+
+    if (type == kString) {
+      std::string value;
+      if (!reader.ReadString(&value)) {
+        return fail(corrupt_metadata);
+      }
+      if (key == "general.architecture") {
+        info.architecture = value;
+      }
+      continue;
+    }
+
+    int32_t* field = IntegerFieldFor(leaf, &info);
+    if (field == nullptr) {
+      if (!SkipValue(&reader, type)) {
+        return fail(corrupt_metadata);
+      }
+      continue;
+    }
+    int64_t value = 0;
+    bool is_integer = false;
+    if (!ReadInteger(&reader, type, &value, &is_integer)) {
+      return fail(corrupt_metadata);
+    }
+    if (is_integer && value > 0 && value <= INT32_MAX) {
+      *field = static_cast<int32_t>(value);
+    }
+  }
+
+  // Weight dtype is judged on matrices only: norms and biases stay F32 even in
+  // quantized models and would otherwise skew small ones.
+  std::map<uint32_t, uint64_t> matrix_elements;
+  std::map<uint32_t, uint64_t> all_elements;
+  std::string name;
+  for (uint64_t i = 0; i < tensor_count; ++i) {
+    uint32_t n_dims = 0;
+    if (!reader.ReadString(&name) || !reader.Read(&n_dims) || n_dims > kMaxDims) {
+      return fail("corrupt GGUF tensor table in model file: " + path);
+    }
+    uint64_t elements = 1;
+    for (uint32_t d = 0; d < n_dims; ++d) {
+      uint64_t dim = 0;
+      if (!reader.Read(&dim)) {
+        return fail("corrupt GGUF tensor table in model file: " + path);
+      }
+      elements = dim != 0 && elements > UINT64_MAX / dim ? UINT64_MAX : elements * dim;
+    }
+    uint32_t type = 0;
+    uint64_t offset = 0;
+    if (!reader.Read(&type) || !reader.Read(&offset)) {
+      return fail("corrupt GGUF tensor table in model file: " + path);
+    }
+    info.parameter_count += static_cast<int64_t>(std::min<uint64_t>(elements, INT64_MAX));
+    all_elements[type] += elements;
+    if (n_dims >= 2) {
+      matrix_elements[type] += elements;
+    }
+  }
+
+  const auto& tally = matrix_elements.empty() ? all_elements : matrix_elements;
+  if (!tally.empty()) {
+    const auto dominant = std::max_element(
+        tally.begin(), tally.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+    info.weight_dtype = GgmlTypeName(dominant->first);
+  }
+
+  *out_info = std::move(info);
+  return true;
+}
+
+}  // namespace ams
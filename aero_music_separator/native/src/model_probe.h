@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ams {
+
+// What can be learned about a model from its GGUF header and key-value
+// metadata alone. Integer fields are 0 when the metadata does not carry
+// them.
+struct ModelInfo {
+  uint32_t gguf_version = 0;
+  std::string architecture;
+  int32_t sample_rate = 0;
+  int32_t chunk_size = 0;
+  int32_t num_overlap = 0;
+  int32_t stem_count = 0;
+  int64_t tensor_count = 0;
+  int64_t parameter_count = 0;
+  // ggml type name holding most weight-matrix elements, e.g. "Q8_0".
+  std::string weight_dtype;
+};
+
+// Reads the header, metadata and tensor table of a GGUF file; tensor data is
+// never touched, so this costs a few small reads regardless of model size.
+bool ProbeGgufModel(const std::string& path, ModelInfo* out_info, std::string* error_message);
+
+}  // namespace ams
@@ -0,0 +1,201 @@
+#include "overlap_add.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+namespace {
+
+constexpr int kChannels = 2;
+
+int StepFor(int chunk_size, int overlap) {
+  return std::max(1, chunk_size / std::max(1, overlap));
+}
+
+bool IsBelowRms(const float* samples, size_t count, float rms_threshold) {
+  if (count == 0) {
+    return true;
+  }
+  double sum = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    sum += static_cast<double>(samples[i]) * samples[i];
+  }
+  return std::sqrt(sum / static_cast<double>(count)) < rms_threshold;
+}
+
+}  // namespace
+
+namespace ams {
+
+OverlapAddSeparator::OverlapAddSeparator(int chunk_size, int overlap, ForwardFn forward, EmitFn emit)
+    : chunk_size_(std::max(1, chunk_size)),
+      step_(StepFor(chunk_size_, overlap)),
+      fade_(chunk_size_ / 10),
+      forward_(std::move(forward)),
+      emit_(std::move(emit)) {
+  // Linear ramp without zero endpoints so every covered frame keeps a
+  // non-zero weight even when windows do not overlap.
+  fade_ramp_.resize(static_cast<size_t>(fade_));
+  for (int i = 0; i < fade_; ++i) {
+    fade_ramp_[static_cast<size_t>(i)] =
+        static_cast<float>(i + 1) / static_cast<float>(fade_ + 1);
+  }
+  window_.resize(static_cast<size_t>(chunk_size_) * kChannels);
+}
+
+int64_t OverlapAddSeparator::EstimateWindows(int64_t total_frames, int chunk_size, int overlap) {
+  if (total_frames <= 0) {
+    return 0;
+  }
+  const int64_t step = StepFor(std::max(1, chunk_size), overlap);
+  return (total_frames + step - 1) / step;
+}
+
+void OverlapAddSeparator::SetSilenceSkip(float rms_threshold) {
+  silence_rms_ = std::max(0.0f, rms_threshold);
+}
+
+bool OverlapAddSeparator::Push(const float* interleaved, int64_t frames, std::string* error_message) {
+  if (frames <= 0) {
+    return true;
+  }
+  input_.insert(input_.end(), interleaved, interleaved + frames * kChannels);
+  frames_pushed_ += frames;
+
+  // A window is known not to be the last one once input extends past its end.
+  while (frames_pushed_ - next_window_ > chunk_size_) {
+    if (!ProcessWindow(false, error_message)) {
+      return false;
+    }
+    if (!EmitUpTo(next_window_, error_message)) {
+      return false;
+    }
+    DropConsumedInput();
+  }
+  return true;
+}
+
+bool OverlapAddSeparator::Finish(std::string* error_message) {
+  while (next_window_ < frames_pushed_) {
+    const bool is_last = next_window_ + step_ >= frames_pushed_;
+    if (!ProcessWindow(is_last, error_message)) {
+      return false;
+    }
+    if (!EmitUpTo(std::min(next_window_, frames_pushed_), error_message)) {
+      return false;
+    }
+    DropConsumedInput();
+  }
+  return EmitUpTo(frames_pushed_, error_message);
+}
+
+bool OverlapAddSeparator::ProcessWindow(bool is_last, std::string* error_message) {
+  const int64_t valid = std::min<int64_t>(chunk_size_, frames_pushed_ - next_window_);
+  const size_t input_offset = static_cast<size_t>(next_window_ - input_origin_) * kChannels;
+  const size_t valid_samples = static_cast<size_t>(valid) * kChannels;
+
+  std::copy_n(input_.begin() + static_cast<std::ptrdiff_t>(input_offset), valid_samples, window_.begin());
+  std::fill(window_.begin() + static_cast<std::ptrdiff_t>(valid_samples), window_.end(), 0.0f);
+
+  window_out_.clear();
+  // acc_ is sized by the first real forward pass; until then the stem count
+  // is unknown and no window can be skipped.
+  if (silence_rms_ > 0.0f && !acc_.empty() &&
+      IsBelowRms(window_.data(), valid_samples, silence_rms_)) {
+    window_out_.assign(acc_.size(), std::vector<float>(valid_samples, 0.0f));
+    ++windows_skipped_;
+  } else if (!forward_(window_, &window_out_, error_message)) {
+    return false;
+  }
+  if (window_out_.empty()) {
+    if (error_message != nullptr) {
+      *error_message = "inference produced no stems";
+    }
+    return false;
+  }
+  if (acc_.empty()) {
+    acc_.resize(window_out_.size());
+  } else if (acc_.size() != window_out_.size()) {
+    if (error_message != nullptr) {
+      *error_message = "inference stem count changed between chunks";
+    }
+    return false;
+  }
+
+  const size_t base = static_cast<size_t>(next_window_ - acc_origin_);
+  const size_t needed_frames = base + static_cast<size_t>(valid);
+  if (weight_.size() < needed_frames) {
+    weight_.resize(needed_frames, 0.0f);
+    for (auto& stem : acc_) {
+      stem.resize(needed_frames * kChannels, 0.0f);
+    }
+  }
+
+  const bool is_first = next_window_ == 0;
+  window_weight_.assign(static_cast<size_t>(valid), 1.0f);
+  for (int64_t f = 0; f < valid; ++f) {
+    float& w = window_weight_[static_cast<size_t>(f)];
+    if (!is_first && f < fade_) {
+      w = fade_ramp_[static_cast<size_t>(f)];
+    }
+    if (!is_last && f >= chunk_size_ - fade_) {
+      w = std::min(w, fade_ramp_[static_cast<size_t>(chunk_size_ - 1 - f)]);
+    }
+    weight_[base + static_cast<size_t>(f)] += w;
+  }
+
+  for (size_t s = 0; s < acc_.size(); ++s) {
+    const std::vector<float>& out = window_out_[s];
+    float* acc = acc_[s].data() + base * kChannels;
+    const size_t out_frames = std::min(out.size() / kChannels, static_cast<size_t>(valid));
+    for (size_t f = 0; f < out_frames; ++f) {
+      const float w = window_weight_[f];
+      acc[f * kChannels] += out[f * kChannels] * w;
+      acc[f * kChannels + 1] += out[f * kChannels + 1] * w;
+    }
+  }
+
+  next_window_ += step_;
+  ++windows_processed_;
+  return true;
+}
+
+bool OverlapAddSeparator::EmitUpTo(int64_t frame, std::string* error_message) {
+  const int64_t available = static_cast<int64_t>(weight_.size());
+  const int64_t frames = std::min(frame - acc_origin_, available);
+  if (frames <= 0 || acc_.empty()) {
+    return true;
+  }
+
+  const size_t frame_count = static_cast<size_t>(frames);
+  StemBlocks region(acc_.size());
+  for (size_t s = 0; s < acc_.size(); ++s) {
+    std::vector<float>& acc = acc_[s];
+    std::vector<float>& out = region[s];
+    out.resize(frame_count * kChannels);
+    for (size_t f = 0; f < frame_count; ++f) {
+      const float w = weight_[f];
+      const float inv = w > 0.0f ? 1.0f / w : 0.0f;
+      out[f * kChannels] = acc[f * kChannels] * inv;
+      out[f * kChannels + 1] = acc[f * kChannels + 1] * inv;
+    }
+    acc.erase(acc.begin(), acc.begin() + static_cast<std::ptrdiff_t>(frame_count * kChannels));
+  }
+  weight_.erase(weight_.begin(), weight_.begin() + static_cast<std::ptrdiff_t>(frame_count));
+  acc_origin_ += frames;
+
+  return emit_(std::move(region), frames, error_message);
+}
+
+void OverlapAddSeparator::DropConsumedInput() {
+  const int64_t consumed = std::min(next_window_, frames_pushed_) - input_origin_;
+  if (consumed <= 0) {
+    return;
+  }
+  input_.erase(input_.begin(),
+               input_.begin() + static_cast<std::ptrdiff_t>(consumed * kChannels));
+  input_origin_ += consumed;
+}
+
+}  // namespace ams
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ams {
+
+// One interleaved stereo buffer per stem, all of the same length.
+using StemBlocks = std::vector<std::vector<float>>;
+
+// Streaming chunked separation with windowed overlap-add. Input is consumed
+// in windows of `chunk_size` frames advancing by `chunk_size / overlap`; every
+// output region that no later window can touch is normalized and handed to
+// `emit` right away, so memory is bounded by the window size rather than by
+// track length.
+class OverlapAddSeparator {
+ public:
+  using ForwardFn = std::function<bool(const std::vector<float>& window,
+                                       StemBlocks* out_stems,
+                                       std::string* error_message)>;
+  using EmitFn =
+      std::function<bool(StemBlocks&& stems, int64_t frames, std::string* error_message)>;
+
+  OverlapAddSeparator(int chunk_size, int overlap, ForwardFn forward, EmitFn emit);
+
+  // Windows whose RMS over their real (unpadded) input is below
+  // `rms_threshold` skip the forward pass and contribute silence, cross-faded
+  // into their neighbours like any other window. Skipping starts once a real
+  // forward pass has reported the stem count, so the first window always
+  // runs.
+  void SetSilenceSkip(float rms_threshold);
+
+  bool Push(const float* interleaved, int64_t frames, std::string* error_message);
+
+  // Runs the trailing windows and emits everything that is left.
+  bool Finish(std::string* error_message);
+
+  int64_t WindowsProcessed() const { return windows_processed_; }
+  int64_t FramesEmitted() const { return acc_origin_; }
+  int64_t WindowsSkipped() const { return windows_skipped_; }
+  int Step() const { return step_; }
+
+  static int64_t EstimateWindows(int64_t total_frames, int chunk_size, int overlap);
+
+ private:
+  bool ProcessWindow(bool is_last, std::string* error_message);
+  bool EmitUpTo(int64_t frame, std::string* error_message);
+  void DropConsumedInput();
+
+  const int chunk_size_;
+  const int step_;
+  const int fade_;
+  ForwardFn forward_;
+  EmitFn emit_;
+  std::vector<float> fade_ramp_;
+
+  std::vector<float> input_;
+  int64_t input_origin_ = 0;
+  int64_t frames_pushed_ = 0;
+
+  StemBlocks acc_;
+  std::vector<float> weight_;
+  int64_t acc_origin_ = 0;
+
+  int64_t next_window_ = 0;
+  int64_t windows_processed_ = 0;
+
+  float silence_rms_ = 0.0f;
+  int64_t windows_skipped_ = 0;
+
+  std::vector<float> window_;
+  std::vector<float> window_weight_;
+  StemBlocks window_out_;
+};
+
+}  // namespace ams
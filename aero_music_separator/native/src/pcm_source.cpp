@@ -0,0 +1,38 @@
+#include "pcm_source.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ams {
+
+MemoryPcmSource::MemoryPcmSource(std::shared_ptr<const std::vector<float>> interleaved)
+    : audio_(std::move(interleaved)),
+      total_frames_(audio_ != nullptr ? static_cast<int64_t>(audio_->size() / 2) : 0) {}
+
+int64_t MemoryPcmSource::ReadFrames(float* out_interleaved,
+                                    int64_t max_frames,
+                                    std::string* error_message) {
+  if (out_interleaved == nullptr || max_frames < 0) {
+    if (error_message != nullptr) {
+      *error_message = "invalid read arguments";
+    }
+    return -1;
+  }
+  const int64_t frames = std::min(max_frames, total_frames_ - position_);
+  if (frames <= 0) {
+    return 0;
+  }
+  std::copy_n(audio_->data() + position_ * 2, frames * 2, out_interleaved);
+  position_ += frames;
+  return frames;
+}
+
+double MemoryPcmSource::Progress() const {
+  return total_frames_ > 0 ? static_cast<double>(position_) / static_cast<double>(total_frames_) : 1.0;
+}
+
+int64_t MemoryPcmSource::EstimatedTotalFrames() const {
+  return total_frames_;
+}
+
+}  // namespace ams
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ams {
+
+// Sequential source of interleaved stereo f32 frames at the model sample rate.
+class PcmSource {
+ public:
+  virtual ~PcmSource() = default;
+
+  // Returns the number of frames written, 0 at end, or -1 on failure.
+  virtual int64_t ReadFrames(float* out_interleaved, int64_t max_frames, std::string* error_message) = 0;
+
+  // Fraction of the source consumed so far (0..1).
+  virtual double Progress() const = 0;
+
+  // Total length in frames, or -1 when unknown.
+  virtual int64_t EstimatedTotalFrames() const = 0;
+};
+
+// Serves an already decoded buffer; the buffer is shared, never copied.
+class MemoryPcmSource : public PcmSource {
+ public:
+  explicit MemoryPcmSource(std::shared_ptr<const std::vector<float>> interleaved);
+
+  int64_t ReadFrames(float* out_interleaved, int64_t max_frames, std::string* error_message) override;
+  double Progress() const override;
+  int64_t EstimatedTotalFrames() const override;
+
+ private:
+  std::shared_ptr<const std::vector<float>> audio_;
+  int64_t total_frames_ = 0;
+  int64_t position_ = 0;
+};
+
+}  // namespace ams
@@ -0,0 +1,122 @@
+#include "prepare_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "canonical_wav_reader.h"
+#include "file_cache.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Bump when the canonical format or key derivation changes.
+constexpr const char* kKeyVersion = "canonical-v1";
+constexpr std::streamsize kSampleBytes = 64 * 1024;
+constexpr const char* kEntryExtension = ".wav";
+
+bool HashSample(std::ifstream* in, uint64_t offset, ams::ContentHasher* hasher) {
+  std::vector<char> buffer(static_cast<size_t>(kSampleBytes));
+  in->clear();
+  in->seekg(static_cast<std::streamoff>(offset));
+  in->read(buffer.data(), kSampleBytes);
+  const std::streamsize got = in->gcount();
+  if (got <= 0 && !in->eof()) {
+    return false;
+  }
+  hasher->Update(buffer.data(), static_cast<size_t>(std::max<std::streamsize>(got, 0)));
+  return true;
+}
+
+}  // namespace
+
+namespace ams {
+
+PrepareCache::PrepareCache(std::string dir, int64_t max_bytes)
+    : dir_(std::move(dir)), max_bytes_(max_bytes > 0 ? max_bytes : kDefaultMaxBytes) {}
+
+bool PrepareCache::ComputeKey(const std::string& input_path, std::string* out_key) const {
+  if (out_key == nullptr) {
+    return false;
+  }
+
+  std::error_code ec;
+  const fs::path path = fs::absolute(fs::u8path(input_path), ec);
+  if (ec) {
+    return false;
+  }
+  const uint64_t size = fs::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+  const auto mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+  if (ec) {
+    return false;
+  }
+
+  ContentHasher hasher;
+  hasher.UpdateString(kKeyVersion);
+  hasher.UpdateString(path.u8string());
+  hasher.UpdateValue(size);
+  hasher.UpdateValue(mtime);
+
+  // Head, middle and tail samples catch in-place rewrites that keep the size
+  // and mtime, without reading the whole file.
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  const uint64_t sample = static_cast<uint64_t>(kSampleBytes);
+  if (!HashSample(&in, 0, &hasher)) {
+    return false;
+  }
+  if (size > sample) {
+    if (!HashSample(&in, (size - sample) / 2, &hasher) ||
+        !HashSample(&in, size - sample, &hasher)) {
+      return false;
+    }
+  }
+
+  *out_key = hasher.HexDigest();
+  return true;
+}
+
+std::string PrepareCache::EntryPath(const std::string& key) const {
+  return (fs::u8path(dir_) / fs::u8path(key + kEntryExtension)).u8string();
+}
+
+std::string PrepareCache::TempPath(const std::string& key, uint64_t token) const {
+  return (fs::u8path(dir_) /
+          fs::u8path(key + "." + std::to_string(token) + kEntryExtension + kCacheTempExtension))
+      .u8string();
+}
+
+bool PrepareCache::Lookup(const std::string& key, int sample_rate, int64_t* out_frames) const {
+  const std::string path = EntryPath(key);
+  CanonicalWavReader reader;
+  if (!reader.Open(path, sample_rate, nullptr)) {
+    return false;
+  }
+  if (out_frames != nullptr) {
+    *out_frames = reader.TotalFrames();
+  }
+
+  TouchCacheFile(path);
+  return true;
+}
+
+bool PrepareCache::Commit(const std::string& temp_path,
+                          const std::string& key,
+                          std::string* error_message) {
+  return CommitCacheFile(temp_path, EntryPath(key), error_message);
+}
+
+void PrepareCache::Evict(const std::string& keep_key) const {
+  EvictCacheFiles(dir_, kEntryExtension, max_bytes_, keep_key + kEntryExtension);
+}
+
+}  // namespace ams
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ams {
+
+// Persistent cache of canonical input WAVs, one `<key>.wav` per source file.
+// Keys combine the source path, size, mtime and a hash of sampled content, so
+// an edited or replaced file never hits a stale entry. Entries are touched
+// on every hit and the least recently used ones are removed once the
+// directory exceeds its byte cap.
+class PrepareCache {
+ public:
+  static constexpr int64_t kDefaultMaxBytes = int64_t{2} << 30;
+
+  PrepareCache(std::string dir, int64_t max_bytes);
+
+  bool ComputeKey(const std::string& input_path, std::string* out_key) const;
+
+  std::string EntryPath(const std::string& key) const;
+
+  // Private to one writer so concurrent prepares of the same file do not
+  // clobber each other; Commit() publishes it under the entry path.
+  std::string TempPath(const std::string& key, uint64_t token) const;
+
+  // Returns true when a valid entry exists for `key`; `out_frames` receives
+  // its length. Marks the entry as most recently used.
+  bool Lookup(const std::string& key, int sample_rate, int64_t* out_frames) const;
+
+  bool Commit(const std::string& temp_path, const std::string& key, std::string* error_message);
+
+  // Removes least recently used entries until the cache fits its cap.
+  // `keep_key` is never removed.
+  void Evict(const std::string& keep_key) const;
+
+ private:
+  std::string dir_;
+  int64_t max_bytes_ = kDefaultMaxBytes;
+};
+
+}  // namespace ams
@@ -1,26 +1,161 @@
 #include "prepare_manager.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
+#include <memory>
+#include <system_error>
 #include <utility>
 #include <vector>
 
 #include "error_store.h"
 #include "ffmpeg_decode_resample.h"
 #include "ffmpeg_encode.h"
+#include "file_cache.h"
 #include "json_result.h"
+#include "prepare_cache.h"
+#include "task_snapshot.h"
 
 namespace {
 
 constexpr const char* kCancelledMessage = "cancelled";
 constexpr int kCanonicalSampleRate = 44100;
 constexpr int kCanonicalChannels = 2;
+constexpr int64_t kPrepareBlockFrames = 1 << 15;
+constexpr const char* kCacheDirName = "canonical_cache";
 
 bool IsCancelledMessage(const std::string& message) {
   return message == kCancelledMessage;
 }
 
+void NotifyPrepareEvent(ams::PrepareContext* task) {
+  task->events.Emit(AMS_EVENT_PREPARE,
+                    task->handle,
+                    task->state.load(std::memory_order_acquire),
+                    task->stage.load(std::memory_order_acquire),
+                    task->progress.load(std::memory_order_acquire));
+}
+
+// Where a task writes its canonical WAV and the path it hands out once done;
+// with a cache the two differ and the entry is linked to the handed-out path.
+struct CanonicalTarget {
+  std::shared_ptr<ams::PrepareCache> cache;
+  std::string cache_key;
+  std::string write_path;
+  std::string canonical_path;
+};
+
+void SetPrepareProgress(ams::PrepareContext* task, double value, int32_t stage) {
+  const double clamped = std::max(0.0, std::min(1.0, value));
+  task->stage.store(stage, std::memory_order_release);
+  task->progress.store(clamped, std::memory_order_release);
+  NotifyPrepareEvent(task);
+}
+
+void FinishPrepareWithError(ams::PrepareContext* task, int32_t state, const std::string& message) {
+  {
+    std::lock_guard<std::mutex> lock(task->data_mutex);
+    task->error_message = message;
+  }
+  task->state.store(state, std::memory_order_release);
+  NotifyPrepareEvent(task);
+}
+
+void FailPrepare(ams::PrepareContext* task, const std::string& error, const char* fallback) {
+  {
+    std::lock_guard<std::mutex> lock(task->data_mutex);
+    task->decoded_audio.reset();
+  }
+  if (task->cancel_requested.load(std::memory_order_acquire) || IsCancelledMessage(error)) {
+    FinishPrepareWithError(task, AMS_JOB_CANCELLED, kCancelledMessage);
+  } else {
+    FinishPrepareWithError(task, AMS_JOB_FAILED, error.empty() ? fallback : error);
+  }
+}
+
+void SucceedPrepare(ams::PrepareContext* task, const std::string& canonical_path, int64_t frames) {
+  const int64_t duration_ms = frames * 1000 / kCanonicalSampleRate;
+  {
+    std::lock_guard<std::mutex> lock(task->data_mutex);
+    task->result_json = ams::BuildPrepareResultJson(
+        canonical_path, kCanonicalSampleRate, kCanonicalChannels, duration_ms);
+    task->error_message.clear();
+  }
+  SetPrepareProgress(task, 1.0, AMS_PREPARE_STAGE_DONE);
+  task->state.store(AMS_JOB_SUCCEEDED, std::memory_order_release);
+  NotifyPrepareEvent(task);
+}
+
+// Commits a finished write to the cache and only then reports the canonical
+// path, so nobody is handed a file that does not exist yet.
+void FinishCanonical(ams::PrepareContext* task,
+                     const CanonicalTarget& target,
+                     bool written,
+                     const std::string& error,
+                     const char* fallback,
+                     int64_t frames) {
+  if (!written) {
+    if (target.cache != nullptr) {
+      std::error_code ec;
+      std::filesystem::remove(std::filesystem::u8path(target.write_path), ec);
+    }
+    FailPrepare(task, error, fallback);
+    return;
+  }
+
+  if (target.cache != nullptr) {
+    std::string commit_error;
+    if (!target.cache->Commit(target.write_path, target.cache_key, &commit_error) ||
+        !ams::PublishCacheFile(target.cache->EntryPath(target.cache_key),
+                               target.canonical_path,
+                               task->handle,
+                               &commit_error)) {
+      FailPrepare(task, commit_error, "prepare write failed");
+      return;
+    }
+    target.cache->Evict(target.cache_key);
+  }
+  SucceedPrepare(task, target.canonical_path, frames);
+}
+
+// Writes a retained buffer to the canonical WAV on the canonical write lane
+// and finishes the task once the file is in place.
+void WriteCanonical(const std::shared_ptr<ams::PrepareContext>& task,
+                    const std::shared_ptr<const std::vector<float>>& audio,
+                    const CanonicalTarget& target) {
+  try {
+    std::string error;
+    int64_t frames = 0;
+    const bool written = [&]() -> bool {
+      ams::StreamingEncoder writer;
+      if (!writer.OpenCanonicalWavPcm16(target.write_path, kCanonicalSampleRate, &error)) {
+        return false;
+      }
+      const int64_t total_frames = static_cast<int64_t>(audio->size() / kCanonicalChannels);
+      while (frames < total_frames) {
+        if (task->cancel_requested.load(std::memory_order_acquire)) {
+          error = kCancelledMessage;
+          return false;
+        }
+        const int64_t count = std::min(kPrepareBlockFrames, total_frames - frames);
+        if (!writer.Write(audio->data() + frames * kCanonicalChannels, count, &error)) {
+          return false;
+        }
+        frames += count;
+        SetPrepareProgress(
+            task.get(),
+            0.60 + 0.38 * static_cast<double>(frames) / static_cast<double>(total_frames),
+            AMS_PREPARE_STAGE_WRITE_CANONICAL);
+      }
+      return writer.Finish(&error);
+    }();
+    FinishCanonical(task.get(), target, written, error, "prepare write failed", frames);
+  } catch (const std::exception& e) {
+    FailPrepare(task.get(), std::string("prepare exception: ") + e.what(), "prepare failed");
+  }
+}
+
 }  // namespace
 
 namespace ams {
@@ -56,23 +191,19 @@ ams_code_t PrepareManager::Start(std::shared_ptr<EngineContext> engine,
   task->engine = std::move(engine);
   task->config = config;
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    task->handle = next_handle_++;
-    tasks_[task->handle] = task;
-  }
-
+  std::lock_guard<std::mutex> lock(mutex_);
+  task->handle = next_handle_++;
+  tasks_[task->handle] = task;
   try {
-    task->worker = std::thread([task]() { RunPrepare(task); });
+    task->scheduled = TaskScheduler::Instance().Submit(
+        TaskLane::kPrepare, 0, [task]() { RunPrepare(task); });
   } catch (const std::exception& e) {
-    std::lock_guard<std::mutex> lock(mutex_);
     tasks_.erase(task->handle);
-    SetLastError(std::string("failed to start prepare worker thread: ") + e.what());
+    SetLastError(std::string("failed to schedule prepare: ") + e.what());
     return AMS_ERR_RUNTIME;
   } catch (...) {
-    std::lock_guard<std::mutex> lock(mutex_);
     tasks_.erase(task->handle);
-    SetLastError("failed to start prepare worker thread: unknown exception");
+    SetLastError("failed to schedule prepare: unknown exception");
     return AMS_ERR_RUNTIME;
   }
 
@@ -81,110 +212,147 @@ ams_code_t PrepareManager::Start(std::shared_ptr<EngineContext> engine,
 }
 
 void PrepareManager::RunPrepare(const std::shared_ptr<PrepareContext>& task) {
+  task->started_at_ms.store(SteadyNowMs(), std::memory_order_release);
   task->state.store(AMS_JOB_RUNNING, std::memory_order_release);
+  NotifyPrepareEvent(task.get());
 
   auto should_cancel = [&]() -> bool {
     return task->cancel_requested.load(std::memory_order_acquire);
   };
 
   auto set_progress = [&](double value, int32_t stage) {
-    const double clamped = std::max(0.0, std::min(1.0, value));
-    task->stage.store(stage, std::memory_order_release);
-    task->progress.store(clamped, std::memory_order_release);
-  };
-
-  auto finish_with_error = [&](int32_t state, const std::string& message) {
-    {
-      std::lock_guard<std::mutex> lock(task->data_mutex);
-      task->error_message = message;
-    }
-    task->state.store(state, std::memory_order_release);
+    SetPrepareProgress(task.get(), value, stage);
   };
 
   try {
     std::filesystem::create_directories(task->config.work_dir);
 
-    std::vector<float> decoded_audio;
-    std::string decode_error;
-
-    set_progress(0.0, AMS_PREPARE_STAGE_DECODE);
-    const bool decoded = DecodeToStereoF32(
-        task->config.input_path,
-        kCanonicalSampleRate,
-        &decoded_audio,
-        should_cancel,
-        [&](double p) { set_progress(0.75 * p, AMS_PREPARE_STAGE_DECODE); },
-        &decode_error);
-
-    if (!decoded) {
-      if (should_cancel() || IsCancelledMessage(decode_error)) {
-        finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
-      } else {
-        finish_with_error(AMS_JOB_FAILED, decode_error.empty() ? "prepare decode failed" : decode_error);
+    std::shared_ptr<PrepareCache> cache;
+    std::string cache_key;
+    if (task->config.cache_max_bytes >= 0) {
+      const std::string cache_dir = JoinPath(task->config.work_dir, kCacheDirName);
+      cache = std::make_shared<PrepareCache>(cache_dir, task->config.cache_max_bytes);
+      std::error_code ec;
+      std::filesystem::create_directories(std::filesystem::u8path(cache_dir), ec);
+      if (ec || !cache->ComputeKey(task->config.input_path, &cache_key)) {
+        cache.reset();
       }
-      return;
-    }
-
-    if (should_cancel()) {
-      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
-      return;
     }
 
-    set_progress(0.75, AMS_PREPARE_STAGE_RESAMPLE);
-
+    // Cache entries can be evicted by any later prepare, so the path handed
+    // to jobs and the preview is always a file of this task's own under
+    // work_dir: the written WAV, or a link to the cache entry.
+    CanonicalTarget target;
+    target.cache = cache;
+    target.cache_key = cache_key;
     std::string output_prefix = task->config.output_prefix;
     if (output_prefix.empty()) {
       output_prefix = "canonical_input";
     } else {
       output_prefix += "_canonical_input";
     }
-    const std::string canonical_path = JoinPath(task->config.work_dir, output_prefix + ".wav");
-
-    std::string encode_error;
-    set_progress(0.76, AMS_PREPARE_STAGE_WRITE_CANONICAL);
-    const bool written = WriteCanonicalInputWavPcm16(
-        canonical_path,
-        decoded_audio,
-        kCanonicalSampleRate,
-        should_cancel,
-        [&](double p) { set_progress(0.76 + 0.24 * p, AMS_PREPARE_STAGE_WRITE_CANONICAL); },
-        &encode_error);
-
-    if (!written) {
-      if (should_cancel() || IsCancelledMessage(encode_error)) {
-        finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
-      } else {
-        finish_with_error(AMS_JOB_FAILED, encode_error.empty() ? "prepare write failed" : encode_error);
+    target.canonical_path = JoinPath(task->config.work_dir, output_prefix + ".wav");
+    target.write_path =
+        cache != nullptr ? cache->TempPath(cache_key, task->handle) : target.canonical_path;
+
+    set_progress(0.0, AMS_PREPARE_STAGE_DECODE);
+    std::string decode_error;
+
+    int64_t cached_frames = 0;
+    if (cache != nullptr && cache->Lookup(cache_key, kCanonicalSampleRate, &cached_frames)) {
+      const std::string cached_path = cache->EntryPath(cache_key);
+      if (task->config.retain_decoded_audio) {
+        // The cached WAV is canonical, so this is a straight mapped read.
+        StreamingDecoder cached;
+        auto audio = std::make_shared<std::vector<float>>();
+        if (!cached.Open(cached_path, kCanonicalSampleRate, should_cancel, &decode_error) ||
+            !cached.ReadAll(
+                audio.get(),
+                [&](double p) { set_progress(0.98 * p, AMS_PREPARE_STAGE_DECODE); },
+                &decode_error)) {
+          FailPrepare(task.get(), decode_error, "prepare decode failed");
+          return;
+        }
+        std::lock_guard<std::mutex> lock(task->data_mutex);
+        task->decoded_audio = audio;
+      }
+      std::string publish_error;
+      if (!PublishCacheFile(cached_path, target.canonical_path, task->handle, &publish_error)) {
+        FailPrepare(task.get(), publish_error, "prepare write failed");
+        return;
       }
+      SucceedPrepare(task.get(), target.canonical_path, cached_frames);
       return;
     }
 
-    if (should_cancel()) {
-      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
+    StreamingDecoder decoder;
+    if (!decoder.Open(task->config.input_path, kCanonicalSampleRate, should_cancel, &decode_error)) {
+      FailPrepare(task.get(), decode_error, "prepare decode failed");
       return;
     }
 
-    const int64_t frames = static_cast<int64_t>(decoded_audio.size() / kCanonicalChannels);
-    const int64_t duration_ms = frames * 1000 / kCanonicalSampleRate;
+    if (task->config.retain_decoded_audio) {
+      // Decode the whole input once and publish it so a job can start from
+      // the buffer right away. The WAV is only needed for preview, so it is
+      // written on its own lane and this prepare slot is freed now.
+      auto audio = std::make_shared<std::vector<float>>();
+      if (!decoder.ReadAll(
+              audio.get(),
+              [&](double p) { set_progress(0.60 * p, AMS_PREPARE_STAGE_DECODE); },
+              &decode_error)) {
+        FailPrepare(task.get(), decode_error, "prepare decode failed");
+        return;
+      }
+      set_progress(0.60, AMS_PREPARE_STAGE_WRITE_CANONICAL);
 
-    {
       std::lock_guard<std::mutex> lock(task->data_mutex);
-      task->result_json = BuildPrepareResultJson(
-          canonical_path,
-          kCanonicalSampleRate,
-          kCanonicalChannels,
-          duration_ms);
-      task->error_message.clear();
+      task->decoded_audio = audio;
+      task->write_scheduled = TaskScheduler::Instance().Submit(
+          TaskLane::kCanonicalWrite, 0, [task, audio, target]() {
+            WriteCanonical(task, audio, target);
+          });
+      return;
     }
 
-    set_progress(1.0, AMS_PREPARE_STAGE_DONE);
-    task->state.store(AMS_JOB_SUCCEEDED, std::memory_order_release);
+    // Decode, resample and write block by block so memory stays flat for
+    // any input length. Runs with the writer in scope so it is closed before
+    // a partial cache file is removed.
+    std::string error;
+    const char* fallback = "prepare write failed";
+    int64_t frames = 0;
+    const bool written = [&]() -> bool {
+      StreamingEncoder writer;
+      if (!writer.OpenCanonicalWavPcm16(target.write_path, kCanonicalSampleRate, &error)) {
+        return false;
+      }
+      std::vector<float> block(static_cast<size_t>(kPrepareBlockFrames) * kCanonicalChannels);
+      while (true) {
+        const int64_t read = decoder.ReadFrames(block.data(), kPrepareBlockFrames, &error);
+        if (read < 0) {
+          fallback = "prepare decode failed";
+          return false;
+        }
+        if (read == 0) {
+          break;
+        }
+        if (!writer.Write(block.data(), read, &error)) {
+          return false;
+        }
+        frames += read;
+        set_progress(0.98 * decoder.Progress(), AMS_PREPARE_STAGE_DECODE);
+      }
+
+      if (should_cancel()) {
+        error = kCancelledMessage;
+        return false;
+      }
+
+      set_progress(0.98, AMS_PREPARE_STAGE_WRITE_CANONICAL);
+      return writer.Finish(&error);
+    }();
+    FinishCanonical(task.get(), target, written, error, fallback, frames);
   } catch (const std::exception& e) {
-    if (should_cancel() || IsCancelledMessage(e.what())) {
-      finish_with_error(AMS_JOB_CANCELLED, kCancelledMessage);
-    } else {
-      finish_with_error(AMS_JOB_FAILED, std::string("prepare exception: ") + e.what());
-    }
+    FailPrepare(task.get(), std::string("prepare exception: ") + e.what(), "prepare failed");
   }
 }
 
@@ -213,6 +381,39 @@ ams_code_t PrepareManager::Poll(ams_prepare_t task,
   return AMS_OK;
 }
 
+ams_code_t PrepareManager::PollMany(const ams_prepare_t* tasks,
+                                 int32_t count,
+                                 ams_task_snapshot_t* out_snapshots) {
+  if (count < 0 || (count > 0 && (tasks == nullptr || out_snapshots == nullptr))) {
+    SetLastError("invalid argument: poll many");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  const size_t size = static_cast<size_t>(count);
+  std::vector<std::shared_ptr<PrepareContext>> contexts(size);
+  std::vector<std::shared_ptr<ScheduledTask>> scheduled(size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < size; ++i) {
+      contexts[i] = FindLocked(tasks[i]);
+      if (contexts[i] != nullptr) {
+        scheduled[i] = contexts[i]->scheduled;
+      }
+    }
+  }
+  std::vector<int32_t> positions(size, -1);
+  TaskScheduler::Instance().QueuePositions(scheduled, positions.data());
+
+  const int64_t now_ms = SteadyNowMs();
+  for (size_t i = 0; i < size; ++i) {
+    out_snapshots[i] = ams_task_snapshot_t{};
+    if (contexts[i] != nullptr) {
+      FillTaskSnapshot(*contexts[i], positions[i], now_ms, &out_snapshots[i]);
+    }
+  }
+  return AMS_OK;
+}
+
 ams_code_t PrepareManager::Cancel(ams_prepare_t task) {
   std::shared_ptr<PrepareContext> ctx;
   {
@@ -225,6 +426,41 @@ ams_code_t PrepareManager::Cancel(ams_prepare_t task) {
   }
 
   ctx->cancel_requested.store(true, std::memory_order_release);
+  std::shared_ptr<ScheduledTask> write_scheduled;
+  {
+    std::lock_guard<std::mutex> lock(ctx->data_mutex);
+    write_scheduled = ctx->write_scheduled;
+  }
+  // A queued task never runs, so nothing else would finish it.
+  if (TaskScheduler::Instance().Withdraw(ctx->scheduled) ||
+      TaskScheduler::Instance().Withdraw(write_scheduled)) {
+    {
+      std::lock_guard<std::mutex> lock(ctx->data_mutex);
+      ctx->error_message = kCancelledMessage;
+    }
+    ctx->state.store(AMS_JOB_CANCELLED, std::memory_order_release);
+    NotifyPrepareEvent(ctx.get());
+  }
+  return AMS_OK;
+}
+
+ams_code_t PrepareManager::GetQueuePosition(ams_prepare_t task, int32_t* out_position) {
+  if (out_position == nullptr) {
+    SetLastError("invalid argument: queue position output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<PrepareContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(task);
+  }
+  if (ctx == nullptr) {
+    SetLastError("prepare task not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+
+  *out_position = TaskScheduler::Instance().QueuePosition(ctx->scheduled);
   return AMS_OK;
 }
 
@@ -264,6 +500,36 @@ ams_code_t PrepareManager::GetResultJson(ams_prepare_t task, std::string* out_js
   return AMS_ERR_RUNTIME;
 }
 
+ams_code_t PrepareManager::GetDecodedAudio(ams_prepare_t task,
+                                           std::shared_ptr<const std::vector<float>>* out_audio,
+                                           int32_t* out_sample_rate) {
+  if (out_audio == nullptr || out_sample_rate == nullptr) {
+    SetLastError("invalid argument: prepare decoded audio output");
+    return AMS_ERR_INVALID_ARG;
+  }
+
+  std::shared_ptr<PrepareContext> ctx;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx = FindLocked(task);
+  }
+  if (ctx == nullptr) {
+    SetLastError("prepare task not found");
+    return AMS_ERR_NOT_FOUND;
+  }
+
+  std::lock_guard<std::mutex> lock(ctx->data_mutex);
+  if (ctx->decoded_audio == nullptr) {
+    SetLastError(ctx->config.retain_decoded_audio ? "prepare decoded audio is not ready"
+                                                  : "prepare task does not retain decoded audio");
+    return AMS_ERR_RUNTIME;
+  }
+
+  *out_audio = ctx->decoded_audio;
+  *out_sample_rate = kCanonicalSampleRate;
+  return AMS_OK;
+}
+
 ams_code_t PrepareManager::Destroy(ams_prepare_t task) {
   std::shared_ptr<PrepareContext> ctx;
   {
@@ -278,9 +544,16 @@ ams_code_t PrepareManager::Destroy(ams_prepare_t task) {
   }
 
   ctx->cancel_requested.store(true, std::memory_order_release);
-  if (ctx->worker.joinable()) {
-    ctx->worker.join();
+  TaskScheduler::Instance().Withdraw(ctx->scheduled);
+  TaskScheduler::Instance().Wait(ctx->scheduled);
+  // Only the finished prepare task queues the write, so it is final here.
+  std::shared_ptr<ScheduledTask> write_scheduled;
+  {
+    std::lock_guard<std::mutex> lock(ctx->data_mutex);
+    write_scheduled = ctx->write_scheduled;
   }
+  TaskScheduler::Instance().Withdraw(write_scheduled);
+  TaskScheduler::Instance().Wait(write_scheduled);
   return AMS_OK;
 }
 
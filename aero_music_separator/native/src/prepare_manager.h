@@ -4,12 +4,13 @@
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "ams_ffi.h"
 #include "engine_manager.h"
+#include "task_events.h"
+#include "task_scheduler.h"
 
 namespace ams {
 
@@ -17,6 +18,9 @@ struct PrepareConfig {
   std::string input_path;
   std::string work_dir;
   std::string output_prefix;
+  bool retain_decoded_audio = false;
+  // 0 selects PrepareCache::kDefaultMaxBytes; negative disables the cache.
+  int64_t cache_max_bytes = 0;
 };
 
 struct PrepareContext {
@@ -28,12 +32,20 @@ struct PrepareContext {
   std::atomic<int32_t> stage{AMS_PREPARE_STAGE_IDLE};
   std::atomic<double> progress{0.0};
   std::atomic<bool> cancel_requested{false};
+  // Steady clock milliseconds at which the task started running; 0 before.
+  std::atomic<int64_t> started_at_ms{0};
+  TaskEventGate events;
 
   std::mutex data_mutex;
   std::string result_json;
   std::string error_message;
+  // Published as soon as decoding finishes when retain_decoded_audio is set,
+  // before the canonical WAV has been written.
+  std::shared_ptr<const std::vector<float>> decoded_audio;
+  // Canonical WAV write of a retained buffer, queued once decoding is done.
+  std::shared_ptr<ScheduledTask> write_scheduled;
 
-  std::thread worker;
+  std::shared_ptr<ScheduledTask> scheduled;
 };
 
 class PrepareManager {
@@ -49,10 +61,24 @@ class PrepareManager {
                   double* out_progress_0_1,
                   int32_t* out_stage);
 
+  // Looks every handle up under one lock. Unknown handles get a snapshot
+  // with `found` = 0 rather than failing the call.
+  ams_code_t PollMany(const ams_prepare_t* tasks, int32_t count, ams_task_snapshot_t* out_snapshots);
+
+  // Tasks stay AMS_JOB_PENDING while queued; position 0 starts next and -1
+  // means the task has left the queue.
+  ams_code_t GetQueuePosition(ams_prepare_t task, int32_t* out_position);
+
   ams_code_t Cancel(ams_prepare_t task);
   ams_code_t GetResultJson(ams_prepare_t task, std::string* out_json);
   ams_code_t Destroy(ams_prepare_t task);
 
+  // Shares the retained decoded buffer of a prepare task along with its
+  // sample rate. The canonical WAV may still be being written.
+  ams_code_t GetDecodedAudio(ams_prepare_t task,
+                             std::shared_ptr<const std::vector<float>>* out_audio,
+                             int32_t* out_sample_rate);
+
  private:
   PrepareManager() = default;
 
@@ -0,0 +1,330 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "file_cache.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Bump when the entry layout or key derivation changes.
+constexpr const char* kKeyVersion = "stems-v4";
+constexpr const char* kEntryExtension = ".stems";
+constexpr char kMagic[8] = {'A', 'M', 'S', 'S', 'T', 'E', 'M', '2'};
+// Written in host order; a reader with the other byte order sees a mismatch.
+constexpr uint32_t kByteOrderMark = 0x01020304u;
+constexpr uint32_t kMaxStems = 64;
+// Samples hashed at the head, middle and tail of the input (64 KiB each).
+constexpr size_t kSampleSpan = 16 * 1024;
+// Single samples hashed on an even grid across the whole input, so an edit
+// outside the three spans still changes the key.
+constexpr size_t kGridSamples = 4096;
+constexpr float kS16Scale = 32767.0f;
+// Samples converted per write or read, bounding the int16 scratch buffer.
+constexpr size_t kConvertSamples = 64 * 1024;
+
+void HashSampledAudio(const std::vector<float>& audio, ams::ContentHasher* hasher) {
+  const size_t size = audio.size();
+  hasher->UpdateValue(static_cast<uint64_t>(size));
+  auto hash_span = [&](size_t offset) {
+    const size_t count = std::min(kSampleSpan, size - offset);
+    hasher->Update(audio.data() + offset, count * sizeof(float));
+  };
+  hash_span(0);
+  if (size > kSampleSpan) {
+    hash_span((size - kSampleSpan) / 2);
+    hash_span(size - kSampleSpan);
+  }
+  const size_t stride = std::max<size_t>(1, size / kGridSamples);
+  for (size_t i = 0; i < size; i += stride) {
+    hasher->UpdateValue(audio[i]);
+  }
+}
+
+void ToS16(const float* in, size_t count, int16_t* out) {
+  for (size_t i = 0; i < count; ++i) {
+    const float clamped = std::max(-1.0f, std::min(1.0f, in[i]));
+    out[i] = static_cast<int16_t>(std::lrint(clamped * kS16Scale));
+  }
+}
+
+// Writes `count` f32 samples as PCM16 through a bounded scratch buffer.
+void WriteS16(std::ostream* out, const float* samples, size_t count) {
+  std::vector<int16_t> scratch(std::min(count, kConvertSamples));
+  for (size_t offset = 0; offset < count; offset += scratch.size()) {
+    const size_t block = std::min(scratch.size(), count - offset);
+    ToS16(samples + offset, block, scratch.data());
+    out->write(reinterpret_cast<const char*>(scratch.data()),
+               static_cast<std::streamsize>(block * sizeof(int16_t)));
+  }
+}
+
+struct EntryHeader {
+  char magic[8];
+  uint32_t stem_count;
+  uint32_t byte_order;
+};
+
+void InitHeader(size_t stem_count, EntryHeader* header) {
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->stem_count = static_cast<uint32_t>(stem_count);
+  header->byte_order = kByteOrderMark;
+}
+
+// Lays the entry out up front with every stem at its final offset, then
+// fills regions in place, so the file is identical to what Store() writes.
+class EntryWriter : public ams::StemSink {
+ public:
+  EntryWriter(std::string temp_path, std::string entry_path, int64_t frames)
+      : temp_path_(std::move(temp_path)), entry_path_(std::move(entry_path)), frames_(frames) {}
+
+  ~EntryWriter() override {
+    if (!committed_) {
+      out_.close();
+      std::error_code ec;
+      fs::remove(fs::u8path(temp_path_), ec);
+    }
+  }
+
+  bool Open(size_t stem_count, std::string* /*error_message*/) override {
+    if (frames_ <= 0 || stem_count == 0 || stem_count > kMaxStems) {
+      broken_ = true;
+      return true;
+    }
+    stem_count_ = stem_count;
+    const uint64_t samples = static_cast<uint64_t>(frames_) * 2;
+    data_offset_ = sizeof(EntryHeader) + stem_count * sizeof(uint64_t);
+    {
+      std::ofstream out(fs::u8path(temp_path_), std::ios::binary | std::ios::trunc);
+      EntryHeader header{};
+      InitHeader(stem_count, &header);
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      const std::vector<uint64_t> sizes(stem_count, samples);
+      out.write(reinterpret_cast<const char*>(sizes.data()),
+                static_cast<std::streamsize>(sizes.size() * sizeof(uint64_t)));
+      out.close();
+      broken_ = !out;
+    }
+    std::error_code ec;
+    if (!broken_) {
+      fs::resize_file(
+          fs::u8path(temp_path_), data_offset_ + stem_count * samples * sizeof(int16_t), ec);
+      broken_ = static_cast<bool>(ec);
+    }
+    if (!broken_) {
+      out_.open(fs::u8path(temp_path_), std::ios::binary | std::ios::in | std::ios::out);
+      broken_ = !out_;
+    }
+    return true;
+  }
+
+  bool Write(const ams::StemBlocks& stems, int64_t frames, std::string* /*error_message*/) override {
+    if (broken_) {
+      return true;
+    }
+    if (stems.size() != stem_count_ || frames < 0 || written_ + frames > frames_) {
+      broken_ = true;
+      return true;
+    }
+    for (size_t i = 0; i < stems.size(); ++i) {
+      const uint64_t offset =
+          data_offset_ + (static_cast<uint64_t>(i) * frames_ + written_) * 2 * sizeof(int16_t);
+      out_.seekp(static_cast<std::streamoff>(offset));
+      WriteS16(&out_, stems[i].data(), static_cast<size_t>(frames) * 2);
+    }
+    written_ += frames;
+    broken_ = !out_;
+    return true;
+  }
+
+  bool Finish(std::string* /*error_message*/) override {
+    if (broken_ || written_ != frames_) {
+      return true;
+    }
+    out_.close();
+    if (!out_) {
+      return true;
+    }
+    std::string commit_error;
+    committed_ = ams::CommitCacheFile(temp_path_, entry_path_, &commit_error);
+    return true;
+  }
+
+ private:
+  const std::string temp_path_;
+  const std::string entry_path_;
+  const int64_t frames_;
+  std::fstream out_;
+  size_t stem_count_ = 0;
+  uint64_t data_offset_ = 0;
+  int64_t written_ = 0;
+  bool broken_ = false;
+  bool committed_ = false;
+};
+
+}  // namespace
+
+namespace ams {
+
+ResultCache::ResultCache(std::string dir, int64_t max_bytes)
+    : dir_(std::move(dir)), max_bytes_(max_bytes > 0 ? max_bytes : kDefaultMaxBytes) {}
+
+std::string ResultCache::EntryPath(const std::string& key) const {
+  return (fs::u8path(dir_) / fs::u8path(key + kEntryExtension)).u8string();
+}
+
+std::string ResultCache::TempPath(const std::string& key, uint64_t token) const {
+  return (fs::u8path(dir_) /
+          fs::u8path(key + "." + std::to_string(token) + kEntryExtension + kCacheTempExtension))
+      .u8string();
+}
+
+bool ResultCache::ComputeKey(const std::vector<float>& audio,
+                             const std::string& model_path,
+                             int sample_rate,
+                             int chunk_size,
+                             int overlap,
+                             float silence_rms_threshold,
+                             int32_t execution_mode,
+                             int32_t segments,
+                             std::string* out_key) const {
+  if (out_key == nullptr || audio.empty()) {
+    return false;
+  }
+
+  ContentHasher hasher;
+  hasher.UpdateString(kKeyVersion);
+  if (!AddFileIdentity(model_path, &hasher)) {
+    return false;
+  }
+  hasher.UpdateValue(static_cast<int32_t>(sample_rate));
+  hasher.UpdateValue(static_cast<int32_t>(chunk_size));
+  hasher.UpdateValue(static_cast<int32_t>(overlap));
+  hasher.UpdateValue(silence_rms_threshold);
+  hasher.UpdateValue(execution_mode);
+  hasher.UpdateValue(segments);
+  HashSampledAudio(audio, &hasher);
+
+  *out_key = hasher.HexDigest();
+  return true;
+}
+
+bool ResultCache::Load(const std::string& key, std::vector<std::vector<float>>* out_stems) const {
+  if (out_stems == nullptr) {
+    return false;
+  }
+
+  const std::string path = EntryPath(key);
+  std::error_code ec;
+  const uint64_t file_size = fs::file_size(fs::u8path(path), ec);
+  if (ec) {
+    return false;
+  }
+
+  std::ifstream in(fs::u8path(path), std::ios::binary);
+  EntryHeader header{};
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.byte_order != kByteOrderMark || header.stem_count == 0 ||
+      header.stem_count > kMaxStems) {
+    return false;
+  }
+
+  std::vector<uint64_t> sizes(header.stem_count);
+  if (!in.read(reinterpret_cast<char*>(sizes.data()),
+               static_cast<std::streamsize>(sizes.size() * sizeof(uint64_t)))) {
+    return false;
+  }
+  uint64_t expected = sizeof(header) + sizes.size() * sizeof(uint64_t);
+  for (uint64_t size : sizes) {
+    if (size > file_size / sizeof(int16_t)) {
+      return false;
+    }
+    expected += size * sizeof(int16_t);
+  }
+  if (expected != file_size) {
+    return false;
+  }
+
+  std::vector<std::vector<float>> stems(sizes.size());
+  std::vector<int16_t> scratch(kConvertSamples);
+  for (size_t i = 0; i < stems.size(); ++i) {
+    const size_t count = static_cast<size_t>(sizes[i]);
+    stems[i].resize(count);
+    for (size_t offset = 0; offset < count; offset += scratch.size()) {
+      const size_t block = std::min(scratch.size(), count - offset);
+      if (!in.read(reinterpret_cast<char*>(scratch.data()),
+                   static_cast<std::streamsize>(block * sizeof(int16_t)))) {
+        return false;
+      }
+      for (size_t j = 0; j < block; ++j) {
+        stems[i][offset + j] = static_cast<float>(scratch[j]) / kS16Scale;
+      }
+    }
+  }
+
+  TouchCacheFile(path);
+  *out_stems = std::move(stems);
+  return true;
+}
+
+bool ResultCache::Store(const std::string& key,
+                        const std::vector<std::vector<float>>& stems,
+                        uint64_t token,
+                        std::string* error_message) const {
+  auto fail = [&](const char* message) {
+    if (error_message != nullptr) {
+      *error_message = message;
+    }
+    return false;
+  };
+
+  if (stems.empty() || stems.size() > kMaxStems) {
+    return fail("invalid stems for result cache");
+  }
+
+  const std::string temp_path = TempPath(key, token);
+  bool written = false;
+  {
+    std::ofstream out(fs::u8path(temp_path), std::ios::binary | std::ios::trunc);
+    EntryHeader header{};
+    InitHeader(stems.size(), &header);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& stem : stems) {
+      const uint64_t size = stem.size();
+      out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    }
+    for (const auto& stem : stems) {
+      WriteS16(&out, stem.data(), stem.size());
+    }
+    out.close();
+    written = static_cast<bool>(out);
+  }
+
+  if (!written) {
+    std::error_code ec;
+    fs::remove(fs::u8path(temp_path), ec);
+    return fail("failed to write result cache entry");
+  }
+  return CommitCacheFile(temp_path, EntryPath(key), error_message);
+}
+
+std::unique_ptr<StemSink> ResultCache::NewEntryWriter(const std::string& key,
+                                                      int64_t frames,
+                                                      uint64_t token) const {
+  return std::make_unique<EntryWriter>(TempPath(key, token), EntryPath(key), frames);
+}
+
+void ResultCache::Evict(const std::string& keep_key) const {
+  EvictCacheFiles(dir_, kEntryExtension, max_bytes_, keep_key + kEntryExtension);
+}
+
+}  // namespace ams
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stem_sink.h"
+
+namespace ams {
+
+// Persistent cache of separated stems, one `<key>.stems` file per entry.
+// Keys hash the decoded input PCM together with the model file identity,
+// sample rate, chunk size, overlap, silence skip threshold, execution mode
+// and segment count, so the same song in another container still hits while
+// any change that affects the separation misses. The PCM is hashed by its
+// length plus sampled spans, like the prepare cache, so a key costs the same
+// for any track length.
+//
+// Stems are stored as PCM16 after a small header: half the size of f32 and
+// still a plain copy to load. A hit therefore carries 16-bit precision, a
+// noise floor near -96 dBFS, so an f32 WAV written from it is not
+// bit-identical to one from a fresh separation; FLAC would be smaller still
+// but costs an encode on every miss.
+class ResultCache {
+ public:
+  static constexpr int64_t kDefaultMaxBytes = int64_t{4} << 30;
+
+  ResultCache(std::string dir, int64_t max_bytes);
+
+  bool ComputeKey(const std::vector<float>& audio,
+                  const std::string& model_path,
+                  int sample_rate,
+                  int chunk_size,
+                  int overlap,
+                  float silence_rms_threshold,
+                  int32_t execution_mode,
+                  int32_t segments,
+                  std::string* out_key) const;
+
+  // Returns false on a miss or a damaged entry. Marks a hit as most recently
+  // used.
+  bool Load(const std::string& key, std::vector<std::vector<float>>* out_stems) const;
+
+  // Writes to a temp file private to `token` and renames it into place, so
+  // readers never see a partial entry.
+  bool Store(const std::string& key,
+             const std::vector<std::vector<float>>& stems,
+             uint64_t token,
+             std::string* error_message) const;
+
+  // Streams an entry to disk region by region, for callers that never hold
+  // the full stems. Every stem must come to exactly `frames` frames. The entry
+  // appears on Finish(); a write failure or a length mismatch only drops it,
+  // it never fails the caller's run.
+  std::unique_ptr<StemSink> NewEntryWriter(const std::string& key,
+                                           int64_t frames,
+                                           uint64_t token) const;
+
+  // Removes least recently used entries until the cache fits its cap.
+  // `keep_key` is never removed.
+  void Evict(const std::string& keep_key) const;
+
+ private:
+  std::string EntryPath(const std::string& key) const;
+  std::string TempPath(const std::string& key, uint64_t token) const;
+
+  std::string dir_;
+  int64_t max_bytes_ = kDefaultMaxBytes;
+};
+
+}  // namespace ams
@@ -0,0 +1,121 @@
+#include "runtime_env.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+
+namespace {
+
+// Guards the environment and the override state below. It is never held
+// across a model load.
+std::mutex g_env_mutex;
+std::condition_variable g_env_cv;
+// Settings of the active overrides, how many share them, and what they
+// replaced.
+std::vector<ams::EnvSetting> g_active_settings;
+int32_t g_active_overrides = 0;
+std::vector<ams::EnvSetting> g_saved_settings;
+// Writes made while an override was active, applied in order once the last
+// override has restored the environment.
+std::vector<ams::EnvSetting> g_pending_writes;
+
+void SetEnvLocked(const char* key, const char* value) {
+#ifdef _WIN32
+  _putenv_s(key, value);
+#else
+  setenv(key, value, 1);
+#endif
+}
+
+void UnsetEnvLocked(const char* key) {
+#ifdef _WIN32
+  _putenv_s(key, "");
+#else
+  unsetenv(key);
+#endif
+}
+
+void ApplyLocked(const ams::EnvSetting& setting) {
+  if (setting.value.has_value()) {
+    SetEnvLocked(setting.key.c_str(), setting.value->c_str());
+  } else {
+    UnsetEnvLocked(setting.key.c_str());
+  }
+}
+
+bool MatchesLocked(const ams::EnvSetting& setting) {
+  const char* current = std::getenv(setting.key.c_str());
+  if (!setting.value.has_value()) {
+    return current == nullptr;
+  }
+  return current != nullptr && *setting.value == current;
+}
+
+void WriteEnv(ams::EnvSetting setting) {
+  std::lock_guard<std::mutex> lock(g_env_mutex);
+  if (g_active_overrides > 0) {
+    g_pending_writes.push_back(std::move(setting));
+    return;
+  }
+  ApplyLocked(setting);
+}
+
+}  // namespace
+
+namespace ams {
+
+void SetEnvValue(const char* key, const char* value) {
+  WriteEnv(EnvSetting{key, std::string(value)});
+}
+
+void UnsetEnvValue(const char* key) {
+  WriteEnv(EnvSetting{key, std::nullopt});
+}
+
+ScopedEnvOverride::ScopedEnvOverride(std::vector<EnvSetting> settings) {
+  std::unique_lock<std::mutex> lock(g_env_mutex);
+  g_env_cv.wait(lock, [&]() {
+    return g_active_overrides == 0 || g_active_settings == settings;
+  });
+  if (g_active_overrides == 0) {
+    g_saved_settings.clear();
+    for (const auto& setting : settings) {
+      if (MatchesLocked(setting)) {
+        continue;
+      }
+      const bool already_saved =
+          std::any_of(g_saved_settings.begin(), g_saved_settings.end(),
+                      [&](const EnvSetting& saved) { return saved.key == setting.key; });
+      if (!already_saved) {
+        const char* previous = std::getenv(setting.key.c_str());
+        g_saved_settings.push_back(EnvSetting{
+            setting.key,
+            previous != nullptr ? std::optional<std::string>(previous) : std::nullopt});
+      }
+      ApplyLocked(setting);
+    }
+    g_active_settings = std::move(settings);
+  }
+  g_active_overrides += 1;
+}
+
+ScopedEnvOverride::~ScopedEnvOverride() {
+  std::lock_guard<std::mutex> lock(g_env_mutex);
+  g_active_overrides -= 1;
+  if (g_active_overrides > 0) {
+    return;
+  }
+  for (auto it = g_saved_settings.rbegin(); it != g_saved_settings.rend(); ++it) {
+    ApplyLocked(*it);
+  }
+  for (const auto& write : g_pending_writes) {
+    ApplyLocked(write);
+  }
+  g_saved_settings.clear();
+  g_pending_writes.clear();
+  g_active_settings.clear();
+  g_env_cv.notify_all();
+}
+
+}  // namespace ams
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ams {
+
+// Process environment writes made by this library. While a
+// ScopedEnvOverride is active the write is queued and applied once the last
+// override ends, so ams_runtime_set_env never waits for an engine load and
+// never changes the environment under a loader that is reading it.
+//
+// These writes are only ordered against each other. setenv is not safe
+// against getenv on other threads, and ggml, OpenMP and FFmpeg read the
+// environment without this lock, so a write while they run is a race this
+// library cannot close.
+void SetEnvValue(const char* key, const char* value);
+void UnsetEnvValue(const char* key);
+
+// One variable for ScopedEnvOverride; no value unsets it.
+struct EnvSetting {
+  std::string key;
+  std::optional<std::string> value;
+
+  bool operator==(const EnvSetting& other) const {
+    return key == other.key && value == other.value;
+  }
+};
+
+// Applies `settings` for its own lifetime and then restores the previous
+// values. Variables that already hold the wanted value are not written, so
+// repeated opens with one preference leave the environment untouched.
+// Overrides with identical settings share one application and run
+// concurrently; an override with different settings waits until the others
+// end, so loads with different preferences are serialized. The environment
+// lock itself is only held while settings are applied or restored.
+class ScopedEnvOverride {
+ public:
+  explicit ScopedEnvOverride(std::vector<EnvSetting> settings);
+  ~ScopedEnvOverride();
+
+  ScopedEnvOverride(const ScopedEnvOverride&) = delete;
+  ScopedEnvOverride& operator=(const ScopedEnvOverride&) = delete;
+};
+
+}  // namespace ams
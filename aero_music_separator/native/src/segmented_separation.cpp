@@ -0,0 +1,237 @@
+#include "segmented_separation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+
+namespace {
+
+constexpr const char* kCancelledMessage = "cancelled";
+constexpr size_t kChannels = 2;
+// A segment spans at least this many margins, so its own edge effects stay
+// well clear of the part of it that is kept.
+constexpr int64_t kMinSegmentMargins = 4;
+
+struct Segment {
+  int64_t begin = 0;  // Input range separated by the replica.
+  int64_t end = 0;
+  int64_t keep_begin = 0;  // Boundary to the previous segment.
+  int64_t keep_end = 0;    // Boundary to the next segment.
+};
+
+std::vector<Segment> PlanSegments(int64_t total_frames,
+                                  size_t replicas,
+                                  int64_t step,
+                                  int64_t margin) {
+  const int64_t max_segments =
+      std::max<int64_t>(1, total_frames / (kMinSegmentMargins * margin));
+  const int64_t count = std::min<int64_t>(static_cast<int64_t>(replicas), max_segments);
+
+  std::vector<int64_t> bounds(static_cast<size_t>(count) + 1);
+  bounds.front() = 0;
+  bounds.back() = total_frames;
+  for (int64_t i = 1; i < count; ++i) {
+    // On the window grid, so a segment's windows line up with the ones a
+    // single pass over the whole track would use.
+    bounds[static_cast<size_t>(i)] = total_frames * i / count / step * step;
+  }
+
+  std::vector<Segment> segments(static_cast<size_t>(count));
+  for (size_t i = 0; i < segments.size(); ++i) {
+    segments[i].keep_begin = bounds[i];
+    segments[i].keep_end = bounds[i + 1];
+    segments[i].begin = std::max<int64_t>(0, bounds[i] - margin);
+    segments[i].end = std::min(total_frames, bounds[i + 1] + margin);
+  }
+  return segments;
+}
+
+// Weight of the segment after `boundary` at `frame`, over a crossfade of
+// `half` frames on either side.
+float IncomingWeight(int64_t frame, int64_t boundary, int64_t half) {
+  const double position = static_cast<double>(frame - (boundary - half)) + 0.5;
+  return static_cast<float>(std::clamp(position / static_cast<double>(2 * half), 0.0, 1.0));
+}
+
+}  // namespace
+
+namespace ams {
+
+bool RunSegmentedSeparation(const std::vector<float>& input,
+                            const std::vector<Inference*>& replicas,
+                            const SegmentedConfig& config,
+                            const std::function<bool()>& cancel_requested,
+                            const std::function<void(double)>& progress,
+                            SegmentedResult* result,
+                            std::string* error_message) {
+  auto fail = [&](const std::string& message) {
+    if (error_message != nullptr) {
+      *error_message = message;
+    }
+    return false;
+  };
+
+  if (result == nullptr || input.empty() || input.size() % kChannels != 0 || replicas.empty() ||
+      config.chunk_size <= 0 || config.overlap <= 0 ||
+      std::find(replicas.begin(), replicas.end(), nullptr) != replicas.end()) {
+    return fail("invalid segmented separation arguments");
+  }
+
+  const int64_t total_frames = static_cast<int64_t>(input.size() / kChannels);
+  const int64_t step = std::max(1, config.chunk_size / config.overlap);
+  const int64_t margin = (config.chunk_size + step - 1) / step * step;
+  const int64_t half = std::max<int64_t>(1, margin / 2);
+  const std::vector<Segment> segments = PlanSegments(total_frames, replicas.size(), step, margin);
+
+  std::mutex mutex;
+  StemBlocks output;
+  std::vector<double> segment_progress(segments.size(), 0.0);
+  // Incoming side of each boundary crossfade, already weighted; added to the
+  // outgoing side once every segment is done.
+  std::vector<StemBlocks> incoming_edges(segments.size());
+  std::string first_error;
+  // Stops the other segments early once one has failed.
+  std::atomic<bool> failed{false};
+  auto should_stop = [&]() { return failed.load(std::memory_order_acquire) || cancel_requested(); };
+
+  auto report = [&](size_t index, double value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    segment_progress[index] = value;
+    if (progress) {
+      double sum = 0.0;
+      for (double p : segment_progress) {
+        sum += p;
+      }
+      progress(sum / static_cast<double>(segment_progress.size()));
+    }
+  };
+
+  auto run_segment = [&](size_t index) {
+    const Segment& segment = segments[index];
+    try {
+      const std::vector<float> slice(
+          input.begin() + static_cast<std::ptrdiff_t>(segment.begin * kChannels),
+          input.begin() + static_cast<std::ptrdiff_t>(segment.end * kChannels));
+      StemBlocks stems = replicas[index]->Process(
+          slice,
+          config.chunk_size,
+          config.overlap,
+          [&](float p) { report(index, p); },
+          should_stop);
+      if (should_stop()) {
+        throw std::runtime_error(kCancelledMessage);
+      }
+
+      const size_t slice_samples = slice.size();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!first_error.empty()) {
+          return;
+        }
+        if (stems.empty()) {
+          throw std::runtime_error("inference produced no stems");
+        }
+        for (const auto& stem : stems) {
+          if (stem.size() < slice_samples) {
+            throw std::runtime_error("segment stems are shorter than the segment");
+          }
+        }
+        if (output.empty()) {
+          output.assign(stems.size(), std::vector<float>(input.size(), 0.0f));
+        } else if (output.size() != stems.size()) {
+          throw std::runtime_error("segments produced different stem counts");
+        }
+      }
+
+      // Owned frames are written outright: the range up to the next boundary
+      // crossfade, and the outgoing side of that crossfade weighted. The
+      // incoming side of the previous boundary is kept aside, since the
+      // previous segment writes there.
+      const bool has_prev = index > 0;
+      const bool has_next = index + 1 < segments.size();
+      const int64_t own_begin = has_prev ? segment.keep_begin + half : 0;
+      const int64_t own_end = has_next ? segment.keep_end + half : total_frames;
+      StemBlocks edge;
+      for (size_t s = 0; s < stems.size(); ++s) {
+        // Output frame `frame` is frame `frame - segment.begin` of the stem.
+        const float* source = stems[s].data();
+        const size_t source_offset = static_cast<size_t>(segment.begin) * kChannels;
+        float* target = output[s].data();
+        for (int64_t frame = own_begin; frame < own_end; ++frame) {
+          const float weight =
+              has_next ? 1.0f - IncomingWeight(frame, segment.keep_end, half) : 1.0f;
+          for (size_t c = 0; c < kChannels; ++c) {
+            const size_t i = static_cast<size_t>(frame) * kChannels + c;
+            target[i] = weight * source[i - source_offset];
+          }
+        }
+        if (has_prev) {
+          const int64_t edge_begin = segment.keep_begin - half;
+          std::vector<float> weighted(static_cast<size_t>(2 * half) * kChannels);
+          for (int64_t frame = edge_begin; frame < own_begin; ++frame) {
+            const float weight = IncomingWeight(frame, segment.keep_begin, half);
+            for (size_t c = 0; c < kChannels; ++c) {
+              weighted[static_cast<size_t>(frame - edge_begin) * kChannels + c] =
+                  weight * source[static_cast<size_t>(frame) * kChannels + c - source_offset];
+            }
+          }
+          edge.push_back(std::move(weighted));
+        }
+        // Release each stem as soon as it is copied out.
+        std::vector<float>().swap(stems[s]);
+      }
+      incoming_edges[index] = std::move(edge);
+      report(index, 1.0);
+    } catch (const std::exception& e) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (first_error.empty()) {
+        first_error = cancel_requested() ? kCancelledMessage : e.what();
+      }
+      failed.store(true, std::memory_order_release);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(segments.size() - 1);
+  try {
+    for (size_t i = 1; i < segments.size(); ++i) {
+      workers.emplace_back(run_segment, i);
+    }
+  } catch (const std::exception& e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    first_error = std::string("failed to start segment worker: ") + e.what();
+    failed.store(true, std::memory_order_release);
+  }
+  if (first_error.empty()) {
+    run_segment(0);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  if (!first_error.empty()) {
+    return fail(first_error);
+  }
+
+  for (size_t index = 1; index < segments.size(); ++index) {
+    const int64_t edge_begin = segments[index].keep_begin - half;
+    for (size_t s = 0; s < output.size() && s < incoming_edges[index].size(); ++s) {
+      const std::vector<float>& edge = incoming_edges[index][s];
+      float* target = output[s].data() + edge_begin * kChannels;
+      for (size_t i = 0; i < edge.size(); ++i) {
+        target[i] += edge[i];
+      }
+    }
+  }
+
+  result->stems = std::move(output);
+  result->segments = segments.size();
+  return true;
+}
+
+}  // namespace ams
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bs_roformer/inference.h"
+#include "overlap_add.h"
+
+namespace ams {
+
+struct SegmentedConfig {
+  int chunk_size = 0;
+  int overlap = 0;
+};
+
+struct SegmentedResult {
+  StemBlocks stems;
+  size_t segments = 0;
+};
+
+// Splits `input` into one segment per replica and separates the segments
+// concurrently, each with the replica's own chunked overlap-add. Segments
+// start on the window grid and reach one chunk past their neighbours, and
+// the halves of that overlap nearest the boundary are crossfaded linearly,
+// so no output frame comes from a window cut off by a segment edge. Tracks
+// too short for that use fewer segments. Every replica must be a distinct
+// Inference of the same model, used by nothing else for the call.
+//
+// Inference does not expose ggml's thread count, so every replica computes
+// with the backend's default and the replicas compete for the same cores.
+// Whether K replicas beat one depends on how well a single instance already
+// uses the machine; ams_replica_bench measures it.
+bool RunSegmentedSeparation(const std::vector<float>& input,
+                            const std::vector<Inference*>& replicas,
+                            const SegmentedConfig& config,
+                            const std::function<bool()>& cancel_requested,
+                            const std::function<void(double)>& progress,
+                            SegmentedResult* result,
+                            std::string* error_message);
+
+}  // namespace ams
@@ -0,0 +1,381 @@
+#include "separation_pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "bounded_queue.h"
+#include "overlap_add.h"
+
+namespace {
+
+constexpr const char* kCancelledMessage = "cancelled";
+constexpr int64_t kPipelineBlockFrames = 1 << 15;
+constexpr size_t kDecodedQueueDepth = 8;
+constexpr size_t kEncodeQueueDepth = 4;
+
+// Share of the overall progress bar attributed to each stage.
+constexpr double kDecodeWeight = 0.05;
+constexpr double kInferWeight = 0.85;
+constexpr double kEncodeWeight = 0.10;
+
+struct EncodeRegion {
+  ams::StemBlocks stems;
+  int64_t frames = 0;
+};
+
+// First failure wins; every stage stops once it is set.
+class PipelineStatus {
+ public:
+  void Fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) {
+      error_ = message.empty() ? "pipeline failed" : message;
+    }
+    failed_.store(true, std::memory_order_release);
+  }
+
+  bool Failed() const { return failed_.load(std::memory_order_acquire); }
+
+  std::string Error() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::string error_;
+  std::atomic<bool> failed_{false};
+};
+
+class PipelineProgress {
+ public:
+  PipelineProgress(int64_t estimated_total_frames, std::function<void(double, int32_t)> sink)
+      : estimated_total_frames_(estimated_total_frames), sink_(std::move(sink)) {}
+
+  void SetDecoded(int64_t frames, double ratio) {
+    decoded_frames_.store(frames, std::memory_order_release);
+    decode_ratio_.store(ratio, std::memory_order_release);
+    Report();
+  }
+
+  void SetInferred(int64_t frames) {
+    inferred_frames_.store(frames, std::memory_order_release);
+    Report();
+  }
+
+  void SetEncoded(int64_t frames) {
+    encoded_frames_.store(frames, std::memory_order_release);
+    Report();
+  }
+
+  void MarkInferenceDone() {
+    inference_done_.store(true, std::memory_order_release);
+    Report();
+  }
+
+ private:
+  void Report() {
+    if (!sink_) {
+      return;
+    }
+    const int64_t decoded = decoded_frames_.load(std::memory_order_acquire);
+    const int64_t inferred = inferred_frames_.load(std::memory_order_acquire);
+    const int64_t encoded = encoded_frames_.load(std::memory_order_acquire);
+    const double total = static_cast<double>(std::max<int64_t>(
+        std::max<int64_t>(estimated_total_frames_, decoded), 1));
+
+    const double value = kDecodeWeight * decode_ratio_.load(std::memory_order_acquire) +
+        kInferWeight * std::min(1.0, static_cast<double>(inferred) / total) +
+        kEncodeWeight * std::min(1.0, static_cast<double>(encoded) / total);
+
+    int32_t stage = AMS_STAGE_DECODE;
+    if (inference_done_.load(std::memory_order_acquire)) {
+      stage = AMS_STAGE_ENCODE;
+    } else if (inferred > 0) {
+      stage = AMS_STAGE_INFER;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Stages report from different threads; keep the bar monotonic.
+    reported_ = std::max(reported_, std::min(value, 0.99));
+    sink_(reported_, stage);
+  }
+
+  const int64_t estimated_total_frames_;
+  std::function<void(double, int32_t)> sink_;
+  std::atomic<int64_t> decoded_frames_{0};
+  std::atomic<double> decode_ratio_{0.0};
+  std::atomic<int64_t> inferred_frames_{0};
+  std::atomic<int64_t> encoded_frames_{0};
+  std::atomic<bool> inference_done_{false};
+  std::mutex mutex_;
+  double reported_ = 0.0;
+};
+
+}  // namespace
+
+namespace ams {
+
+bool RunPipelinedSeparation(PcmSource* source,
+                            Inference* inference,
+                            const PipelineConfig& config,
+                            const std::function<bool()>& cancel_requested,
+                            const std::function<void(double, int32_t)>& progress,
+                            PipelineResult* result,
+                            std::string* error_message) {
+  if (source == nullptr || inference == nullptr || result == nullptr ||
+      config.sample_rate <= 0 || config.chunk_size <= 0 || config.overlap <= 0 ||
+      config.sinks.empty()) {
+    if (error_message != nullptr) {
+      *error_message = "invalid pipeline arguments";
+    }
+    return false;
+  }
+
+  PipelineStatus status;
+  PipelineProgress tracker(source->EstimatedTotalFrames(), progress);
+  BoundedQueue<std::vector<float>> decoded_queue(kDecodedQueueDepth);
+  BoundedQueue<EncodeRegion> encode_queue(kEncodeQueueDepth);
+
+  auto fail = [&](const std::string& message) {
+    status.Fail(message);
+    decoded_queue.Abort();
+    encode_queue.Abort();
+  };
+
+  std::thread decode_thread([&]() {
+    try {
+      int64_t decoded = 0;
+      while (!status.Failed()) {
+        std::vector<float> block(static_cast<size_t>(kPipelineBlockFrames) * 2);
+        std::string decode_error;
+        const int64_t frames = source->ReadFrames(block.data(), kPipelineBlockFrames, &decode_error);
+        if (frames < 0) {
+          fail(decode_error.empty() ? "decode failed" : decode_error);
+          return;
+        }
+        if (frames == 0) {
+          break;
+        }
+        block.resize(static_cast<size_t>(frames) * 2);
+        decoded += frames;
+        tracker.SetDecoded(decoded, source->Progress());
+        if (!decoded_queue.Push(std::move(block))) {
+          return;
+        }
+      }
+      tracker.SetDecoded(decoded, 1.0);
+      decoded_queue.Close();
+    } catch (const std::exception& e) {
+      fail(std::string("decode exception: ") + e.what());
+    }
+  });
+
+  std::thread encode_thread([&]() {
+    try {
+      int64_t encoded = 0;
+      EncodeRegion region;
+      while (encode_queue.Pop(&region)) {
+        if (cancel_requested()) {
+          fail(kCancelledMessage);
+          return;
+        }
+
+        std::string encode_error;
+        if (result->stem_count == 0) {
+          result->stem_count = region.stems.size();
+          for (StemSink* sink : config.sinks) {
+            if (!sink->Open(region.stems.size(), &encode_error)) {
+              fail(encode_error.empty() ? "encode failed" : encode_error);
+              return;
+            }
+          }
+        }
+
+        for (StemSink* sink : config.sinks) {
+          if (!sink->Write(region.stems, region.frames, &encode_error)) {
+            fail(encode_error.empty() ? "encode failed" : encode_error);
+            return;
+          }
+        }
+        encoded += region.frames;
+        tracker.SetEncoded(encoded);
+      }
+
+      if (status.Failed() || result->stem_count == 0) {
+        return;
+      }
+      for (StemSink* sink : config.sinks) {
+        std::string encode_error;
+        if (!sink->Finish(&encode_error)) {
+          fail(encode_error.empty() ? "encode failed" : encode_error);
+          return;
+        }
+      }
+    } catch (const std::exception& e) {
+      fail(std::string("encode exception: ") + e.what());
+    }
+  });
+
+  std::chrono::steady_clock::duration inference_elapsed{};
+  try {
+    // Process() with num_overlap=1 on exactly one chunk runs a single forward
+    // pass; windowing and overlap-add across chunks happen here instead.
+    OverlapAddSeparator separator(
+        config.chunk_size,
+        config.overlap,
+        [&](const std::vector<float>& window, StemBlocks* out_stems, std::string* forward_error) {
+          const auto begin = std::chrono::steady_clock::now();
+          *out_stems = inference->Process(window, config.chunk_size, 1, nullptr, cancel_requested);
+          inference_elapsed += std::chrono::steady_clock::now() - begin;
+          if (cancel_requested()) {
+            *forward_error = kCancelledMessage;
+            return false;
+          }
+          return true;
+        },
+        [&](StemBlocks&& stems, int64_t frames, std::string* emit_error) {
+          if (!encode_queue.Push(EncodeRegion{std::move(stems), frames})) {
+            *emit_error = status.Error();
+            return false;
+          }
+          return true;
+        });
+    separator.SetSilenceSkip(config.silence_rms_threshold);
+
+    std::vector<float> block;
+    while (decoded_queue.Pop(&block)) {
+      if (cancel_requested()) {
+        fail(kCancelledMessage);
+        break;
+      }
+      std::string separate_error;
+      if (!separator.Push(block.data(), static_cast<int64_t>(block.size() / 2), &separate_error)) {
+        fail(separate_error);
+        break;
+      }
+      tracker.SetInferred(separator.FramesEmitted());
+    }
+
+    if (!status.Failed()) {
+      std::string separate_error;
+      if (!separator.Finish(&separate_error)) {
+        fail(separate_error);
+      } else {
+        tracker.SetInferred(separator.FramesEmitted());
+        tracker.MarkInferenceDone();
+        encode_queue.Close();
+      }
+    }
+    // Each window advances the input by one step, so a skipped window stands
+    // for one step of audio that was never inferred.
+    const int64_t skipped_frames = std::min(
+        separator.WindowsSkipped() * separator.Step(), separator.FramesEmitted());
+    result->silence_skipped_seconds =
+        static_cast<double>(skipped_frames) / static_cast<double>(config.sample_rate);
+  } catch (const std::exception& e) {
+    fail(e.what());
+  }
+
+  decode_thread.join();
+  encode_thread.join();
+
+  result->inference_elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(inference_elapsed).count();
+
+  if (status.Failed()) {
+    if (error_message != nullptr) {
+      *error_message = status.Error();
+    }
+    return false;
+  }
+  if (result->stem_count == 0) {
+    if (error_message != nullptr) {
+      *error_message = "inference produced no stems";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool RunWindowedSeparation(const std::vector<float>& input,
+                           Inference* inference,
+                           const PipelineConfig& config,
+                           const std::function<bool()>& cancel_requested,
+                           const std::function<void(double)>& progress,
+                           StemBlocks* out_stems,
+                           PipelineResult* result,
+                           std::string* error_message) {
+  auto fail = [&](const std::string& message) {
+    if (error_message != nullptr) {
+      *error_message = message;
+    }
+    return false;
+  };
+  if (inference == nullptr || out_stems == nullptr || result == nullptr ||
+      config.sample_rate <= 0 || config.chunk_size <= 0 || config.overlap <= 0 ||
+      input.size() % 2 != 0) {
+    return fail("invalid windowed separation arguments");
+  }
+
+  const int64_t total_frames = static_cast<int64_t>(input.size() / 2);
+  MemoryStemSink sink(total_frames);
+  std::chrono::steady_clock::duration inference_elapsed{};
+  OverlapAddSeparator separator(
+      config.chunk_size,
+      config.overlap,
+      [&](const std::vector<float>& window, StemBlocks* stems, std::string* forward_error) {
+        const auto begin = std::chrono::steady_clock::now();
+        *stems = inference->Process(window, config.chunk_size, 1, nullptr, cancel_requested);
+        inference_elapsed += std::chrono::steady_clock::now() - begin;
+        if (cancel_requested()) {
+          *forward_error = kCancelledMessage;
+          return false;
+        }
+        return true;
+      },
+      [&](StemBlocks&& stems, int64_t frames, std::string* emit_error) {
+        if (result->stem_count == 0) {
+          result->stem_count = stems.size();
+          if (!sink.Open(stems.size(), emit_error)) {
+            return false;
+          }
+        }
+        return sink.Write(stems, frames, emit_error);
+      });
+  separator.SetSilenceSkip(config.silence_rms_threshold);
+
+  std::string separate_error;
+  for (int64_t offset = 0; offset < total_frames; offset += kPipelineBlockFrames) {
+    if (cancel_requested()) {
+      return fail(kCancelledMessage);
+    }
+    const int64_t frames = std::min(kPipelineBlockFrames, total_frames - offset);
+    if (!separator.Push(input.data() + offset * 2, frames, &separate_error)) {
+      return fail(separate_error);
+    }
+    if (progress) {
+      progress(static_cast<double>(separator.FramesEmitted()) /
+               static_cast<double>(total_frames));
+    }
+  }
+  if (!separator.Finish(&separate_error) || !sink.Finish(&separate_error)) {
+    return fail(separate_error);
+  }
+
+  const int64_t skipped_frames =
+      std::min(separator.WindowsSkipped() * separator.Step(), separator.FramesEmitted());
+  result->silence_skipped_seconds =
+      static_cast<double>(skipped_frames) / static_cast<double>(config.sample_rate);
+  result->inference_elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(inference_elapsed).count();
+  *out_stems = sink.TakeStems();
+  return true;
+}
+
+}  // namespace ams
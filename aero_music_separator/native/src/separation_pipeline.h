@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ams_ffi.h"
+#include "bs_roformer/inference.h"
+#include "pcm_source.h"
+#include "stem_sink.h"
+
+namespace ams {
+
+struct PipelineConfig {
+  int sample_rate = 0;
+  int chunk_size = 0;
+  int overlap = 0;
+  // Every finished region goes to each sink in order and is released
+  // afterwards, so the pipeline itself never holds a full-length stem.
+  std::vector<StemSink*> sinks;
+  // Windows quieter than this RMS (linear, full scale 1.0) skip inference and
+  // output silence once the model has run once; 0 disables.
+  float silence_rms_threshold = 0.0f;
+};
+
+struct PipelineResult {
+  size_t stem_count = 0;
+  int64_t inference_elapsed_ms = 0;
+  // Input duration whose windows skipped inference as silent.
+  double silence_skipped_seconds = 0.0;
+};
+
+// Runs decode, inference and stem encoding as three concurrent stages linked
+// by bounded queues: decoded blocks feed the overlap-add separator as they
+// arrive and finished output regions reach the sinks while later chunks are
+// still being inferred. Memory is bounded by the queue depths and the window
+// size, not by track length. `progress` receives (value, ams_job_stage_t).
+bool RunPipelinedSeparation(PcmSource* source,
+                            Inference* inference,
+                            const PipelineConfig& config,
+                            const std::function<bool()>& cancel_requested,
+                            const std::function<void(double, int32_t)>& progress,
+                            PipelineResult* result,
+                            std::string* error_message);
+
+// Separates audio already in memory with the same windowed overlap-add as
+// the pipelined path, on the calling thread, and returns full-length stems
+// like Inference::Process. Sequential jobs use it when silence skipping is
+// on, since Process runs every window. `config.sinks` is ignored; `progress`
+// receives the share of frames separated.
+bool RunWindowedSeparation(const std::vector<float>& input,
+                           Inference* inference,
+                           const PipelineConfig& config,
+                           const std::function<bool()>& cancel_requested,
+                           const std::function<void(double)>& progress,
+                           StemBlocks* out_stems,
+                           PipelineResult* result,
+                           std::string* error_message);
+
+}  // namespace ams
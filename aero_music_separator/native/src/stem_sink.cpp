@@ -0,0 +1,77 @@
+#include "stem_sink.h"
+
+#include <utility>
+
+#include "ffmpeg_encode.h"
+
+namespace ams {
+
+EncoderStemSink::EncoderStemSink(std::function<std::string(size_t)> output_path,
+                                 int sample_rate,
+                                 int32_t output_format)
+    : output_path_(std::move(output_path)),
+      sample_rate_(sample_rate),
+      output_format_(output_format) {}
+
+EncoderStemSink::~EncoderStemSink() = default;
+
+bool EncoderStemSink::Open(size_t stem_count, std::string* error_message) {
+  encoders_.clear();
+  output_files_.clear();
+  for (size_t i = 0; i < stem_count; ++i) {
+    const std::string path = output_path_(i);
+    auto encoder = std::make_unique<StreamingEncoder>();
+    if (!encoder->Open(path, sample_rate_, output_format_, error_message)) {
+      return false;
+    }
+    encoders_.push_back(std::move(encoder));
+    output_files_.push_back(path);
+  }
+  return true;
+}
+
+bool EncoderStemSink::Write(const StemBlocks& stems, int64_t frames, std::string* error_message) {
+  for (size_t i = 0; i < encoders_.size() && i < stems.size(); ++i) {
+    if (!encoders_[i]->Write(stems[i].data(), frames, error_message)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EncoderStemSink::Finish(std::string* error_message) {
+  for (auto& encoder : encoders_) {
+    if (!encoder->Finish(error_message)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+MemoryStemSink::MemoryStemSink(int64_t expected_frames) : expected_frames_(expected_frames) {}
+
+bool MemoryStemSink::Open(size_t stem_count, std::string* /*error_message*/) {
+  stems_.assign(stem_count, std::vector<float>());
+  if (expected_frames_ > 0) {
+    for (auto& stem : stems_) {
+      stem.reserve(static_cast<size_t>(expected_frames_) * 2);
+    }
+  }
+  return true;
+}
+
+bool MemoryStemSink::Write(const StemBlocks& stems,
+                           int64_t frames,
+                           std::string* /*error_message*/) {
+  const size_t samples = static_cast<size_t>(frames) * 2;
+  for (size_t i = 0; i < stems_.size() && i < stems.size(); ++i) {
+    stems_[i].insert(stems_[i].end(), stems[i].begin(), stems[i].begin() + samples);
+  }
+  return true;
+}
+
+bool MemoryStemSink::Finish(std::string* /*error_message*/) {
+  return true;
+}
+
+}  // namespace ams
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "overlap_add.h"
+
+namespace ams {
+
+class StreamingEncoder;
+
+// Consumer of separated audio, fed region by region as the overlap-add
+// accumulator releases it. Regions are not kept after Write() returns, so a
+// sink decides alone how much of the output it holds.
+class StemSink {
+ public:
+  virtual ~StemSink() = default;
+
+  // Called once, before the first region.
+  virtual bool Open(size_t stem_count, std::string* error_message) = 0;
+
+  // `stems` holds one interleaved stereo buffer of at least `frames` frames
+  // per stem.
+  virtual bool Write(const StemBlocks& stems, int64_t frames, std::string* error_message) = 0;
+
+  // Called once after the last region; not called when the run fails.
+  virtual bool Finish(std::string* error_message) = 0;
+};
+
+// Encodes every stem to its own file as regions arrive.
+class EncoderStemSink : public StemSink {
+ public:
+  EncoderStemSink(std::function<std::string(size_t)> output_path,
+                  int sample_rate,
+                  int32_t output_format);
+  ~EncoderStemSink() override;
+
+  bool Open(size_t stem_count, std::string* error_message) override;
+  bool Write(const StemBlocks& stems, int64_t frames, std::string* error_message) override;
+  bool Finish(std::string* error_message) override;
+
+  const std::vector<std::string>& OutputFiles() const { return output_files_; }
+
+ private:
+  std::function<std::string(size_t)> output_path_;
+  const int sample_rate_;
+  const int32_t output_format_;
+  std::vector<std::unique_ptr<StreamingEncoder>> encoders_;
+  std::vector<std::string> output_files_;
+};
+
+// Appends every stem to its own buffer in memory, for callers that want the
+// stems rather than files.
+class MemoryStemSink : public StemSink {
+ public:
+  // Reserves room for `expected_frames` per stem up front; <= 0 grows as
+  // regions arrive.
+  explicit MemoryStemSink(int64_t expected_frames);
+
+  bool Open(size_t stem_count, std::string* error_message) override;
+  bool Write(const StemBlocks& stems, int64_t frames, std::string* error_message) override;
+  bool Finish(std::string* error_message) override;
+
+  StemBlocks TakeStems() { return std::move(stems_); }
+
+ private:
+  const int64_t expected_frames_;
+  StemBlocks stems_;
+};
+
+}  // namespace ams
@@ -0,0 +1,64 @@
+#include "task_events.h"
+
+#include <atomic>
+#include <cmath>
+#include <shared_mutex>
+
+namespace {
+
+constexpr double kDefaultProgressStep = 0.01;
+
+struct Registration {
+  std::shared_mutex mutex;
+  ams_event_callback_t callback = nullptr;
+  void* user_data = nullptr;
+  double progress_step = kDefaultProgressStep;
+  // Lets Emit() skip the lock while nothing is registered.
+  std::atomic<bool> active{false};
+};
+
+Registration& GetRegistration() {
+  static Registration registration;
+  return registration;
+}
+
+}  // namespace
+
+namespace ams {
+
+void SetEventCallback(ams_event_callback_t callback, void* user_data, double progress_step) {
+  Registration& registration = GetRegistration();
+  std::unique_lock<std::shared_mutex> lock(registration.mutex);
+  registration.callback = callback;
+  registration.user_data = user_data;
+  registration.progress_step = progress_step > 0.0 ? progress_step : kDefaultProgressStep;
+  registration.active.store(callback != nullptr, std::memory_order_release);
+}
+
+void TaskEventGate::Emit(int32_t kind,
+                         uint64_t handle,
+                         int32_t state,
+                         int32_t stage,
+                         double progress) {
+  Registration& registration = GetRegistration();
+  if (!registration.active.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  // Held through the call so events for one task arrive in order.
+  std::lock_guard<std::mutex> gate_lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(registration.mutex);
+  if (registration.callback == nullptr) {
+    return;
+  }
+  if (state == state_ && stage == stage_ &&
+      std::fabs(progress - progress_) < registration.progress_step) {
+    return;
+  }
+  state_ = state;
+  stage_ = stage;
+  progress_ = progress;
+  registration.callback(kind, handle, state, stage, progress, registration.user_data);
+}
+
+}  // namespace ams
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "ams_ffi.h"
+
+namespace ams {
+
+// Registered ams_event_callback_t. Setting a new callback waits for calls to
+// the previous one to return, so its user data can be released afterwards.
+void SetEventCallback(ams_event_callback_t callback, void* user_data, double progress_step);
+
+// Last event sent for one task. Events go out on state and stage changes and
+// when progress has moved by at least the registered step since the last one.
+class TaskEventGate {
+ public:
+  void Emit(int32_t kind, uint64_t handle, int32_t state, int32_t stage, double progress);
+
+ private:
+  std::mutex mutex_;
+  int32_t state_ = -1;
+  int32_t stage_ = -1;
+  double progress_ = -1.0;
+};
+
+}  // namespace ams
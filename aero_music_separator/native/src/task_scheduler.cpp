@@ -0,0 +1,228 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <utility>
+
+namespace ams {
+
+struct ScheduledTask {
+  enum class State {
+    kQueued,
+    kRunning,
+    kDone,
+  };
+
+  TaskLane lane = TaskLane::kJob;
+  int32_t priority = 0;
+  uint64_t sequence = 0;
+  std::function<void()> run;
+  State state = State::kQueued;
+};
+
+namespace {
+
+bool RunsBefore(const ScheduledTask& a, const ScheduledTask& b) {
+  if (a.priority != b.priority) {
+    return a.priority > b.priority;
+  }
+  return a.sequence < b.sequence;
+}
+
+}  // namespace
+
+TaskScheduler& TaskScheduler::Instance() {
+  static TaskScheduler scheduler;
+  return scheduler;
+}
+
+TaskScheduler::TaskScheduler() {
+  LaneFor(TaskLane::kJob).max_running = kDefaultMaxRunningJobs;
+  LaneFor(TaskLane::kPrepare).max_running = kDefaultMaxRunningPrepares;
+  LaneFor(TaskLane::kEngineLoad).max_running = kMaxRunningEngineLoads;
+  LaneFor(TaskLane::kCanonicalWrite).max_running = kMaxRunningCanonicalWrites;
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+std::shared_ptr<ScheduledTask> TaskScheduler::Submit(TaskLane lane,
+                                                     int32_t priority,
+                                                     std::function<void()> run) {
+  auto task = std::make_shared<ScheduledTask>();
+  task->lane = lane;
+  task->priority = priority;
+  task->run = std::move(run);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EnsureWorkersLocked();
+    task->sequence = next_sequence_++;
+    LaneFor(lane).queue.push_back(task);
+  }
+  work_cv_.notify_all();
+  return task;
+}
+
+int32_t TaskScheduler::QueuePosition(const std::shared_ptr<ScheduledTask>& task) {
+  if (task == nullptr) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return QueuePositionLocked(*task);
+}
+
+void TaskScheduler::QueuePositions(const std::vector<std::shared_ptr<ScheduledTask>>& tasks,
+                                   int32_t* out_positions) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    out_positions[i] = tasks[i] != nullptr ? QueuePositionLocked(*tasks[i]) : -1;
+  }
+}
+
+int32_t TaskScheduler::QueuePositionLocked(const ScheduledTask& task) {
+  if (task.state != ScheduledTask::State::kQueued) {
+    return -1;
+  }
+  int32_t position = 0;
+  for (const auto& other : LaneFor(task.lane).queue) {
+    if (other.get() != &task && RunsBefore(*other, task)) {
+      ++position;
+    }
+  }
+  return position;
+}
+
+bool TaskScheduler::Withdraw(const std::shared_ptr<ScheduledTask>& task) {
+  if (task == nullptr) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (task->state != ScheduledTask::State::kQueued) {
+      return false;
+    }
+    auto& queue = LaneFor(task->lane).queue;
+    queue.erase(std::remove(queue.begin(), queue.end(), task), queue.end());
+    task->state = ScheduledTask::State::kDone;
+    task->run = nullptr;
+  }
+  done_cv_.notify_all();
+  return true;
+}
+
+void TaskScheduler::Wait(const std::shared_ptr<ScheduledTask>& task) {
+  if (task == nullptr) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [&]() { return task->state == ScheduledTask::State::kDone; });
+}
+
+void TaskScheduler::Configure(int32_t max_running_jobs, int32_t max_running_prepares) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_running_jobs > 0) {
+      LaneFor(TaskLane::kJob).max_running = max_running_jobs;
+    }
+    if (max_running_prepares > 0) {
+      LaneFor(TaskLane::kPrepare).max_running = max_running_prepares;
+    }
+    if (!workers_.empty()) {
+      EnsureWorkersLocked();
+    }
+  }
+  work_cv_.notify_all();
+}
+
+void TaskScheduler::EnsureWorkersLocked() {
+  size_t wanted = 0;
+  for (const Lane& lane : lanes_) {
+    wanted += static_cast<size_t>(lane.max_running);
+  }
+  // Lowered limits leave surplus workers idle rather than stopping them.
+  while (workers_.size() < wanted) {
+    try {
+      workers_.emplace_back([this]() { WorkerLoop(); });
+    } catch (const std::system_error&) {
+      // Fewer workers only means less concurrency, but there must be one.
+      if (workers_.empty()) {
+        throw;
+      }
+      break;
+    }
+  }
+}
+
+std::shared_ptr<ScheduledTask> TaskScheduler::PopRunnableLocked() {
+  Lane* best_lane = nullptr;
+  std::vector<std::shared_ptr<ScheduledTask>>::iterator best;
+  for (Lane& lane : lanes_) {
+    if (lane.running >= lane.max_running || lane.queue.empty()) {
+      continue;
+    }
+    auto candidate = std::min_element(
+        lane.queue.begin(), lane.queue.end(), [](const auto& a, const auto& b) {
+          return RunsBefore(*a, *b);
+        });
+    if (best_lane == nullptr || RunsBefore(**candidate, **best)) {
+      best_lane = &lane;
+      best = candidate;
+    }
+  }
+  if (best_lane == nullptr) {
+    return nullptr;
+  }
+
+  std::shared_ptr<ScheduledTask> task = *best;
+  best_lane->queue.erase(best);
+  best_lane->running += 1;
+  task->state = ScheduledTask::State::kRunning;
+  return task;
+}
+
+void TaskScheduler::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    std::shared_ptr<ScheduledTask> task;
+    work_cv_.wait(lock, [&]() {
+      if (stopping_) {
+        return true;
+      }
+      task = PopRunnableLocked();
+      return task != nullptr;
+    });
+    if (task == nullptr) {
+      return;
+    }
+
+    std::function<void()> run = std::move(task->run);
+    lock.unlock();
+    try {
+      run();
+    } catch (...) {
+      // Tasks report their own failures; never let one take the worker down.
+    }
+    run = nullptr;
+    lock.lock();
+
+    LaneFor(task->lane).running -= 1;
+    task->state = ScheduledTask::State::kDone;
+    done_cv_.notify_all();
+    // The freed slot may unblock a task another worker skipped.
+    work_cv_.notify_all();
+  }
+}
+
+}  // namespace ams
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ams {
+
+// Tasks of each lane run on their own concurrency budget, so a queue of
+// long separations never holds up a prepare or a model preload.
+enum class TaskLane : int32_t {
+  kJob = 0,
+  kPrepare = 1,
+  kEngineLoad = 2,
+  // Canonical WAVs written after a prepare task has handed its decoded
+  // buffer over, so the write does not hold a prepare slot.
+  kCanonicalWrite = 3,
+};
+
+struct ScheduledTask;
+
+// Process-wide worker pool shared by the job and prepare managers. Each lane
+// keeps a priority queue (higher priority first, FIFO among equals) and runs
+// at most its configured number of tasks at once.
+class TaskScheduler {
+ public:
+  static constexpr int32_t kDefaultMaxRunningJobs = 1;
+  static constexpr int32_t kDefaultMaxRunningPrepares = 2;
+  static constexpr int32_t kMaxRunningEngineLoads = 1;
+  static constexpr int32_t kMaxRunningCanonicalWrites = 1;
+
+  static TaskScheduler& Instance();
+
+  ~TaskScheduler();
+
+  // Throws std::system_error when no worker thread can be started.
+  std::shared_ptr<ScheduledTask> Submit(TaskLane lane, int32_t priority, std::function<void()> run);
+
+  // Number of queued tasks of the same lane that will start before `task`;
+  // -1 once it has started or was withdrawn.
+  int32_t QueuePosition(const std::shared_ptr<ScheduledTask>& task);
+
+  // QueuePosition() for every task under one lock; null tasks get -1.
+  void QueuePositions(const std::vector<std::shared_ptr<ScheduledTask>>& tasks,
+                      int32_t* out_positions);
+
+  // Removes a task that has not started yet. Returns false when it is
+  // already running or finished.
+  bool Withdraw(const std::shared_ptr<ScheduledTask>& task);
+
+  // Blocks until `task` has finished running or was withdrawn.
+  void Wait(const std::shared_ptr<ScheduledTask>& task);
+
+  // Values <= 0 keep the current limit.
+  void Configure(int32_t max_running_jobs, int32_t max_running_prepares);
+
+ private:
+  struct Lane {
+    std::vector<std::shared_ptr<ScheduledTask>> queue;
+    int32_t max_running = 0;
+    int32_t running = 0;
+  };
+
+  TaskScheduler();
+
+  void WorkerLoop();
+  void EnsureWorkersLocked();
+  std::shared_ptr<ScheduledTask> PopRunnableLocked();
+  int32_t QueuePositionLocked(const ScheduledTask& task);
+  Lane& LaneFor(TaskLane lane) { return lanes_[static_cast<size_t>(lane)]; }
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  Lane lanes_[4];
+  uint64_t next_sequence_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace ams
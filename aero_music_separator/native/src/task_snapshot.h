@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "ams_ffi.h"
+
+namespace ams {
+
+// Below this progress the elapsed time says too little about the rest.
+constexpr double kMinEtaProgress = 0.02;
+
+inline int64_t SteadyNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Fills `out` from a job or prepare context. The time left is extrapolated
+// from the time spent running so far and the progress made in it.
+template <typename Context>
+void FillTaskSnapshot(const Context& ctx,
+                      int32_t queue_position,
+                      int64_t now_ms,
+                      ams_task_snapshot_t* out) {
+  out->found = 1;
+  out->state = ctx.state.load(std::memory_order_acquire);
+  out->stage = ctx.stage.load(std::memory_order_acquire);
+  out->progress_0_1 = ctx.progress.load(std::memory_order_acquire);
+  out->queue_position = queue_position;
+  out->eta_ms = -1;
+  if (out->state == AMS_JOB_SUCCEEDED || out->state == AMS_JOB_FAILED ||
+      out->state == AMS_JOB_CANCELLED) {
+    out->eta_ms = 0;
+  } else if (out->state == AMS_JOB_RUNNING && out->progress_0_1 >= kMinEtaProgress) {
+    const int64_t started_ms = ctx.started_at_ms.load(std::memory_order_acquire);
+    if (started_ms > 0 && now_ms >= started_ms) {
+      const double elapsed_ms = static_cast<double>(now_ms - started_ms);
+      out->eta_ms =
+          static_cast<int64_t>(elapsed_ms * (1.0 - out->progress_0_1) / out->progress_0_1);
+    }
+  }
+}
+
+}  // namespace ams
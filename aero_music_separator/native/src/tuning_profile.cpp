@@ -0,0 +1,170 @@
+#include "tuning_profile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "file_cache.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Bump when the line layout or key derivation changes; older profiles are
+// then ignored and rewritten from scratch.
+constexpr const char* kProfileHeader = "ams-tuning-v2";
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+constexpr const char* kHostArch = "arm64";
+#elif defined(__arm__) || defined(_M_ARM)
+constexpr const char* kHostArch = "arm";
+#elif defined(__x86_64__) || defined(_M_X64)
+constexpr const char* kHostArch = "x86_64";
+#elif defined(__i386__) || defined(_M_IX86)
+constexpr const char* kHostArch = "x86";
+#else
+constexpr const char* kHostArch = "unknown";
+#endif
+
+// Stores rewrite the whole file; serialize them within the process.
+std::mutex& ProfileMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+bool ParseEntryLine(const std::string& line, std::string* out_key, ams::TuningEntry* out_entry) {
+  std::istringstream in(line);
+  ams::TuningEntry entry;
+  std::string key;
+  if (!(in >> key >> entry.chunk_size >> entry.overlap >>
+        entry.real_time_factor >> entry.peak_memory_bytes)) {
+    return false;
+  }
+  if (entry.chunk_size <= 0 || entry.overlap <= 0) {
+    return false;
+  }
+  *out_key = std::move(key);
+  *out_entry = entry;
+  return true;
+}
+
+std::vector<std::pair<std::string, ams::TuningEntry>> ReadEntries(const std::string& profile_path) {
+  std::vector<std::pair<std::string, ams::TuningEntry>> entries;
+  std::ifstream in(fs::u8path(profile_path));
+  std::string line;
+  if (!in || !std::getline(in, line) || line != kProfileHeader) {
+    return entries;
+  }
+  while (std::getline(in, line)) {
+    std::string key;
+    ams::TuningEntry entry;
+    if (ParseEntryLine(line, &key, &entry)) {
+      entries.emplace_back(std::move(key), entry);
+    }
+  }
+  return entries;
+}
+
+}  // namespace
+
+namespace ams {
+
+bool ComputeTuningKey(const std::string& model_path,
+                      const std::string& backend,
+                      std::string* out_key) {
+  if (out_key == nullptr) {
+    return false;
+  }
+
+  ContentHasher hasher;
+  hasher.UpdateString(kProfileHeader);
+  if (!AddFileIdentity(model_path, &hasher)) {
+    return false;
+  }
+  hasher.UpdateString(backend);
+  hasher.UpdateString(kHostArch);
+  hasher.UpdateValue(static_cast<uint32_t>(std::thread::hardware_concurrency()));
+  *out_key = hasher.HexDigest();
+  return true;
+}
+
+bool LoadTuningEntry(const std::string& profile_path,
+                     const std::string& key,
+                     TuningEntry* out_entry) {
+  if (profile_path.empty() || key.empty() || out_entry == nullptr) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(ProfileMutex());
+  for (const auto& [entry_key, entry] : ReadEntries(profile_path)) {
+    if (entry_key == key) {
+      *out_entry = entry;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StoreTuningEntry(const std::string& profile_path,
+                      const std::string& key,
+                      const TuningEntry& entry,
+                      std::string* error_message) {
+  if (profile_path.empty() || key.empty()) {
+    if (error_message != nullptr) {
+      *error_message = "invalid tuning profile path or key";
+    }
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(ProfileMutex());
+  auto entries = ReadEntries(profile_path);
+  bool replaced = false;
+  for (auto& [entry_key, existing] : entries) {
+    if (entry_key == key) {
+      existing = entry;
+      replaced = true;
+    }
+  }
+  if (!replaced) {
+    entries.emplace_back(key, entry);
+  }
+
+  std::error_code ec;
+  const fs::path path = fs::u8path(profile_path);
+  if (path.has_parent_path()) {
+    fs::create_directories(path.parent_path(), ec);
+  }
+
+  const std::string temp_path = profile_path + kCacheTempExtension;
+  {
+    std::ofstream out(fs::u8path(temp_path), std::ios::binary | std::ios::trunc);
+    if (!out) {
+      if (error_message != nullptr) {
+        *error_message = "failed to write tuning profile: " + profile_path;
+      }
+      return false;
+    }
+    out << kProfileHeader << '\n';
+    for (const auto& [entry_key, value] : entries) {
+      out << entry_key << ' ' << value.chunk_size << ' ' << value.overlap << ' '
+          << value.real_time_factor << ' ' << value.peak_memory_bytes << '\n';
+    }
+    out.flush();
+    if (!out) {
+      out.close();
+      fs::remove(fs::u8path(temp_path), ec);
+      if (error_message != nullptr) {
+        *error_message = "failed to write tuning profile: " + profile_path;
+      }
+      return false;
+    }
+  }
+  return CommitCacheFile(temp_path, profile_path, error_message);
+}
+
+}  // namespace ams
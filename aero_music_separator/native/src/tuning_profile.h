@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ams {
+
+// Settings that separated fastest for one model on one device, as measured
+// by autotune.
+struct TuningEntry {
+  int32_t chunk_size = 0;
+  int32_t overlap = 0;
+  // Inference time divided by audio duration; below 1 is faster than real time.
+  double real_time_factor = 0.0;
+  // Resident memory above the level before the trial started.
+  int64_t peak_memory_bytes = 0;
+};
+
+// A tuning profile is one text file with an entry per model and device. Keys
+// hash the model file identity with the backend and the host CPU, so a profile
+// copied to another machine or an updated model file simply misses.
+bool ComputeTuningKey(const std::string& model_path,
+                      const std::string& backend,
+                      std::string* out_key);
+
+// Returns false when the profile is missing, damaged or has no entry for `key`.
+bool LoadTuningEntry(const std::string& profile_path,
+                     const std::string& key,
+                     TuningEntry* out_entry);
+
+// Replaces the entry for `key` and keeps all others. The file is rewritten
+// through a temp file, so readers never see a partial profile.
+bool StoreTuningEntry(const std::string& profile_path,
+                      const std::string& key,
+                      const TuningEntry& entry,
+                      std::string* error_message);
+
+}  // namespace ams
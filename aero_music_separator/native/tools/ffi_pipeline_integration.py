@@ -36,12 +36,38 @@ BACKEND_PREF = {
     "metal": 4,
 }
 
+EXECUTION_MODE = {
+    "sequential": 0,
+    "pipelined": 1,
+    "segmented": 2,
+}
+
 
 class AmsPrepareConfig(ctypes.Structure):
     _fields_ = [
         ("input_path", ctypes.c_char_p),
         ("work_dir", ctypes.c_char_p),
         ("output_prefix", ctypes.c_char_p),
+        ("retain_decoded_audio", ctypes.c_int32),
+        ("cache_max_bytes", ctypes.c_int64),
+    ]
+
+
+class AmsEngineOpenOptions(ctypes.Structure):
+    _fields_ = [
+        ("backend_preference", ctypes.c_int32),
+        ("prefetch_model_file", ctypes.c_int32),
+    ]
+
+
+class AmsEnginePoolStats(ctypes.Structure):
+    _fields_ = [
+        ("hits", ctypes.c_uint64),
+        ("misses", ctypes.c_uint64),
+        ("evictions", ctypes.c_uint64),
+        ("resident_models", ctypes.c_int32),
+        ("idle_models", ctypes.c_int32),
+        ("resident_bytes", ctypes.c_int64),
     ]
 
 
@@ -54,6 +80,13 @@ class AmsRunConfig(ctypes.Structure):
         ("output_format", ctypes.c_int32),
         ("chunk_size", ctypes.c_int32),
         ("overlap", ctypes.c_int32),
+        ("execution_mode", ctypes.c_int32),
+        ("result_cache_dir", ctypes.c_char_p),
+        ("result_cache_max_bytes", ctypes.c_int64),
+        ("priority", ctypes.c_int32),
+        ("tuning_profile_path", ctypes.c_char_p),
+        ("silence_threshold_db", ctypes.c_double),
+        ("replicas", ctypes.c_int32),
     ]
 
 
@@ -98,6 +131,12 @@ def parse_args() -> argparse.Namespace:
         default=-1,
         help="Overlap for separation job; <=0 uses model defaults (default: -1)",
     )
+    parser.add_argument(
+        "--execution-mode",
+        choices=sorted(EXECUTION_MODE),
+        default="sequential",
+        help="Job execution mode (default: sequential)",
+    )
     return parser.parse_args()
 
 
@@ -174,9 +213,22 @@ def configure_ffi(lib: ctypes.CDLL) -> None:
     lib.ams_engine_open.argtypes = [ctypes.c_char_p, ctypes.c_int32, ctypes.POINTER(ctypes.c_uint64)]
     lib.ams_engine_open.restype = ctypes.c_int32
 
+    lib.ams_engine_open_ex.argtypes = [
+        ctypes.c_char_p,
+        ctypes.POINTER(AmsEngineOpenOptions),
+        ctypes.POINTER(ctypes.c_uint64),
+    ]
+    lib.ams_engine_open_ex.restype = ctypes.c_int32
+
     lib.ams_engine_close.argtypes = [ctypes.c_uint64]
     lib.ams_engine_close.restype = ctypes.c_int32
 
+    lib.ams_model_probe.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p)]
+    lib.ams_model_probe.restype = ctypes.c_int32
+
+    lib.ams_engine_pool_get_stats.argtypes = [ctypes.POINTER(AmsEnginePoolStats)]
+    lib.ams_engine_pool_get_stats.restype = ctypes.c_int32
+
     lib.ams_prepare_start.argtypes = [
         ctypes.c_uint64,
         ctypes.POINTER(AmsPrepareConfig),
@@ -304,10 +356,12 @@ def run_job(
     backend_pref: int,
     chunk_size: int,
     overlap: int,
+    execution_mode: int,
     timeout_sec: float,
 ) -> dict[str, Any]:
     engine = ctypes.c_uint64(0)
-    code = lib.ams_engine_open(str(model_path).encode("utf-8"), backend_pref, ctypes.byref(engine))
+    open_options = AmsEngineOpenOptions(backend_preference=backend_pref, prefetch_model_file=1)
+    code = lib.ams_engine_open_ex(str(model_path).encode("utf-8"), ctypes.byref(open_options), ctypes.byref(engine))
     if code != AMS_OK:
         if code == AMS_ERR_UNSUPPORTED:
             raise RuntimeError(f"engine open unsupported for backend_pref={backend_pref}: {last_error(lib)}")
@@ -324,6 +378,7 @@ def run_job(
             output_format=0,  # WAV
             chunk_size=chunk_size,
             overlap=overlap,
+            execution_mode=execution_mode,
         )
 
         ensure_ok(lib, lib.ams_job_start(engine.value, ctypes.byref(run_config), ctypes.byref(job_handle)), "job start")
@@ -426,6 +481,7 @@ def run_backend_once(
     tolerance_ms: int,
     chunk_size: int,
     overlap: int,
+    execution_mode: int,
     timeout_sec: float,
 ) -> dict[str, Any]:
     output_dir = run_root / f"job_{backend}"
@@ -439,6 +495,7 @@ def run_backend_once(
         backend_pref=BACKEND_PREF[backend],
         chunk_size=chunk_size,
         overlap=overlap,
+        execution_mode=execution_mode,
         timeout_sec=timeout_sec,
     )
     files = result.get("files")
@@ -478,6 +535,8 @@ def main() -> int:
         "timeout_sec": args.timeout_sec,
         "chunk_size": args.chunk_size,
         "overlap": args.overlap,
+        "execution_mode": args.execution_mode,
+        "model_probe": None,
         "prepare": None,
         "runs": [],
         "warnings": [],
@@ -508,6 +567,10 @@ def main() -> int:
     prepare_root.mkdir(parents=True, exist_ok=True)
 
     try:
+        out_probe = ctypes.c_void_p()
+        ensure_ok(lib, lib.ams_model_probe(str(model).encode("utf-8"), ctypes.byref(out_probe)), "ams_model_probe")
+        report["model_probe"] = read_json_string(lib, out_probe.value)
+
         prepare = run_prepare(lib, input_audio, prepare_root, args.timeout_sec)
         report["prepare"] = prepare
         expected_duration_ms = int(prepare.get("duration_ms", 0))
@@ -530,6 +593,7 @@ def main() -> int:
                         args.duration_tolerance_ms,
                         args.chunk_size,
                         args.overlap,
+                        EXECUTION_MODE[args.execution_mode],
                         args.timeout_sec,
                     )
                     report["runs"].append(run)
@@ -550,6 +614,7 @@ def main() -> int:
                             args.duration_tolerance_ms,
                             args.chunk_size,
                             args.overlap,
+                            EXECUTION_MODE[args.execution_mode],
                             args.timeout_sec,
                         )
                         fallback_run["status"] = "degraded_cpu_fallback"
@@ -572,6 +637,7 @@ def main() -> int:
                         args.duration_tolerance_ms,
                         args.chunk_size,
                         args.overlap,
+                        EXECUTION_MODE[args.execution_mode],
                         args.timeout_sec,
                     )
                     report["runs"].append(run)
@@ -581,6 +647,10 @@ def main() -> int:
     except Exception as exc:
         report["errors"].append(str(exc))
 
+    pool_stats = AmsEnginePoolStats()
+    if lib.ams_engine_pool_get_stats(ctypes.byref(pool_stats)) == AMS_OK:
+        report["engine_pool"] = {name: getattr(pool_stats, name) for name, _ in AmsEnginePoolStats._fields_}
+
     report["success"] = len(report["errors"]) == 0
     write_report(report_path, report)
 
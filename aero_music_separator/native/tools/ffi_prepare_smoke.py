@@ -25,6 +25,8 @@ class AmsPrepareConfig(ctypes.Structure):
         ("input_path", ctypes.c_char_p),
         ("work_dir", ctypes.c_char_p),
         ("output_prefix", ctypes.c_char_p),
+        ("retain_decoded_audio", ctypes.c_int32),
+        ("cache_max_bytes", ctypes.c_int64),
     ]
 
 
@@ -37,6 +39,13 @@ class AmsRunConfig(ctypes.Structure):
         ("output_format", ctypes.c_int32),
         ("chunk_size", ctypes.c_int32),
         ("overlap", ctypes.c_int32),
+        ("execution_mode", ctypes.c_int32),
+        ("result_cache_dir", ctypes.c_char_p),
+        ("result_cache_max_bytes", ctypes.c_int64),
+        ("priority", ctypes.c_int32),
+        ("tuning_profile_path", ctypes.c_char_p),
+        ("silence_threshold_db", ctypes.c_double),
+        ("replicas", ctypes.c_int32),
     ]
 
 
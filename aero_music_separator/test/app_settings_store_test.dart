@@ -12,16 +12,19 @@ void main() {
 
     expect(await store.readLastModelPath(), isNull);
     expect(await store.readForceCpuEnabled(), isFalse);
+    expect(await store.readSkipSilenceEnabled(), isFalse);
     expect(await store.readOpenMpPreset(), OpenMpPreset.auto);
     expect(await store.readLocaleOverride(), isNull);
 
     await store.writeLastModelPath('/tmp/model.gguf');
     await store.writeForceCpuEnabled(true);
+    await store.writeSkipSilenceEnabled(true);
     await store.writeOpenMpPreset(OpenMpPreset.performance);
     await store.writeLocaleOverride('zh');
 
     expect(await store.readLastModelPath(), '/tmp/model.gguf');
     expect(await store.readForceCpuEnabled(), isTrue);
+    expect(await store.readSkipSilenceEnabled(), isTrue);
     expect(await store.readOpenMpPreset(), OpenMpPreset.performance);
     expect(await store.readLocaleOverride(), 'zh');
 
@@ -0,0 +1,150 @@
+import 'dart:collection';
+
+import 'package:aero_music_separator/core/ffi/ams_native.dart';
+import 'package:aero_music_separator/core/separation/autotune_service.dart';
+import 'package:aero_music_separator/core/separation/separation_models.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+void main() {
+  test('returns the tuned settings and releases the job and engine', () async {
+    final native = _FakeAutotuneNative(
+      pollSnapshots: <NativeJobSnapshot>[
+        NativeJobSnapshot(
+          state: SeparationJobState.running,
+          stage: SeparationStage.infer,
+          progress: 0.5,
+        ),
+        NativeJobSnapshot(
+          state: SeparationJobState.succeeded,
+          stage: SeparationStage.done,
+          progress: 1.0,
+        ),
+      ],
+    );
+    final service = AutotuneService(native: native);
+
+    final result = await service.run(
+      modelPath: 'model.gguf',
+      backend: AmsBackend.cpu,
+      profilePath: 'tuning_profile.txt',
+    );
+
+    expect(native.profilePaths, <String>['tuning_profile.txt']);
+    expect(result.chunkSize, 352800);
+    expect(result.overlap, 2);
+    expect(result.realTimeFactor, closeTo(0.42, 1e-9));
+    expect(result.trials, hasLength(2));
+    expect(result.trials.first.chunkSize, 176400);
+    expect(native.destroyedJobs, <int>[9]);
+    expect(native.closedEngines, <int>[3]);
+
+    service.dispose();
+  });
+
+  test('reports a cancelled autotune as cancellation', () async {
+    final native = _FakeAutotuneNative(
+      pollSnapshots: <NativeJobSnapshot>[
+        NativeJobSnapshot(
+          state: SeparationJobState.cancelled,
+          stage: SeparationStage.infer,
+          progress: 0.3,
+        ),
+      ],
+    );
+    final service = AutotuneService(native: native);
+
+    final run = service.run(
+      modelPath: 'model.gguf',
+      backend: AmsBackend.cpu,
+      profilePath: 'tuning_profile.txt',
+    );
+    service.cancel();
+
+    await expectLater(run, throwsA(isA<NativeCancelledException>()));
+    expect(native.cancelledJobs, <int>[9]);
+    expect(native.closedEngines, <int>[3]);
+
+    service.dispose();
+  });
+
+  test('parses the native autotune result payload', () {
+    final result = AutotuneResult.fromJson(
+      '{"profile_path":"p.txt","chunk_size":176400,"overlap":4,'
+      '"real_time_factor":1.5,"peak_memory_bytes":1024,'
+      '"trials":[{"chunk_size":176400,'
+      '"real_time_factor":1.5,"peak_memory_bytes":1024}]}',
+    );
+
+    expect(result.profilePath, 'p.txt');
+    expect(result.chunkSize, 176400);
+    expect(result.overlap, 4);
+    expect(result.peakMemoryBytes, 1024);
+    expect(result.trials.single.realTimeFactor, 1.5);
+  });
+}
+
+class _FakeAutotuneNative implements AmsAutotuneNativeApi {
+  _FakeAutotuneNative({required List<NativeJobSnapshot> pollSnapshots})
+    : _pollSnapshots = Queue<NativeJobSnapshot>.from(pollSnapshots);
+
+  final Queue<NativeJobSnapshot> _pollSnapshots;
+  NativeJobSnapshot _lastSnapshot = NativeJobSnapshot(
+    state: SeparationJobState.pending,
+    stage: SeparationStage.idle,
+    progress: 0.0,
+  );
+
+  final List<String> profilePaths = <String>[];
+  final List<int> cancelledJobs = <int>[];
+  final List<int> destroyedJobs = <int>[];
+  final List<int> closedEngines = <int>[];
+
+  @override
+  int openEngine(String modelPath, AmsBackend backend) => 3;
+
+  @override
+  void closeEngine(int engineHandle) {
+    closedEngines.add(engineHandle);
+  }
+
+  @override
+  int startAutotune(
+    int engineHandle, {
+    required String profilePath,
+    int trialSeconds = 0,
+  }) {
+    profilePaths.add(profilePath);
+    return 9;
+  }
+
+  @override
+  NativeJobSnapshot pollJob(int jobHandle) {
+    if (_pollSnapshots.isNotEmpty) {
+      _lastSnapshot = _pollSnapshots.removeFirst();
+    }
+    return _lastSnapshot;
+  }
+
+  @override
+  void cancelJob(int jobHandle) {
+    cancelledJobs.add(jobHandle);
+  }
+
+  @override
+  AutotuneResult autotuneResultForJob(int jobHandle) {
+    return AutotuneResult.fromJson(
+      '{"profile_path":"tuning_profile.txt","chunk_size":352800,'
+      '"overlap":2,"real_time_factor":0.42,'
+      '"peak_memory_bytes":268435456,"trials":['
+      '{"chunk_size":176400,"real_time_factor":0.61,'
+      '"peak_memory_bytes":268435456},'
+      '{"chunk_size":352800,"real_time_factor":0.42,'
+      '"peak_memory_bytes":268435456}]}',
+    );
+  }
+
+  @override
+  void destroyJob(int jobHandle) {
+    destroyedJobs.add(jobHandle);
+  }
+}
@@ -116,6 +116,7 @@ class _FakePrepareNative implements AmsPrepareNativeApi {
     required String inputPath,
     required String workDir,
     String outputPrefix = 'input',
+    bool retainDecodedAudio = false,
   }) {
     return 1;
   }
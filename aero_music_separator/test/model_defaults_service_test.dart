@@ -0,0 +1,141 @@
+import 'package:aero_music_separator/core/ffi/ams_native.dart';
+import 'package:aero_music_separator/core/separation/model_defaults_service.dart';
+import 'package:aero_music_separator/core/separation/separation_models.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+void main() {
+  test(
+    'defaults come from the header probe without opening an engine',
+    () async {
+      final native = _FakeModelNative(
+        probe: _probe(chunkSize: 264600, overlap: 4, sampleRate: 44100),
+      );
+      final service = ModelDefaultsService(native: native);
+
+      final defaults = await service.loadDefaults(
+        modelPath: 'model.gguf',
+        backend: AmsBackend.auto,
+      );
+
+      expect(defaults.chunkSize, 264600);
+      expect(defaults.overlap, 4);
+      expect(defaults.sampleRate, 44100);
+      expect(native.openCalls, 0);
+    },
+  );
+
+  test('falls back to the engine when the header lacks defaults', () async {
+    final native = _FakeModelNative(
+      probe: _probe(chunkSize: 0, overlap: 0, sampleRate: 44100),
+    );
+    final service = ModelDefaultsService(native: native);
+
+    final defaults = await service.loadDefaults(
+      modelPath: 'model.gguf',
+      backend: AmsBackend.auto,
+    );
+
+    expect(defaults.chunkSize, 352800);
+    expect(defaults.overlap, 2);
+    expect(native.openCalls, 1);
+    expect(native.closeCalls, 1);
+  });
+
+  test('falls back to the engine when the probe fails', () async {
+    final native = _FakeModelNative(
+      probeError: NativeFfiException('not GGUF', AmsNativeStatus.runtime),
+    );
+    final service = ModelDefaultsService(native: native);
+
+    final defaults = await service.loadDefaults(
+      modelPath: 'model.gguf',
+      backend: AmsBackend.auto,
+    );
+
+    expect(defaults.sampleRate, 44100);
+    expect(native.openCalls, 1);
+  });
+
+  test('probe payload parses optional fields leniently', () {
+    final info = ModelProbeInfo.fromJson(
+      '{"chunk_size":352800,"num_overlap":2,"sample_rate":44100,'
+      '"stem_count":2,"parameter_count":123,"weight_dtype":"Q8_0"}',
+    );
+
+    expect(info.hasEngineDefaults, isTrue);
+    expect(info.weightDtype, 'Q8_0');
+    expect(info.architecture, isEmpty);
+  });
+}
+
+ModelProbeInfo _probe({
+  required int chunkSize,
+  required int overlap,
+  required int sampleRate,
+}) {
+  return ModelProbeInfo(
+    chunkSize: chunkSize,
+    overlap: overlap,
+    sampleRate: sampleRate,
+    stemCount: 2,
+    parameterCount: 0,
+    weightDtype: 'F16',
+    architecture: 'bs_roformer',
+  );
+}
+
+class _FakeModelNative implements AmsSeparationNativeApi {
+  _FakeModelNative({this.probe, this.probeError});
+
+  final ModelProbeInfo? probe;
+  final Object? probeError;
+
+  int openCalls = 0;
+  int closeCalls = 0;
+
+  @override
+  ModelProbeInfo probeModel(String modelPath) {
+    final error = probeError;
+    if (error != null) {
+      throw error;
+    }
+    return probe!;
+  }
+
+  @override
+  int openEngine(String modelPath, AmsBackend backend) {
+    openCalls += 1;
+    return 1;
+  }
+
+  @override
+  EngineDefaults getDefaults(int engineHandle) {
+    return EngineDefaults(chunkSize: 352800, overlap: 2, sampleRate: 44100);
+  }
+
+  @override
+  void closeEngine(int engineHandle) {
+    closeCalls += 1;
+  }
+
+  @override
+  void cancelJob(int jobHandle) {}
+
+  @override
+  void destroyJob(int jobHandle) {}
+
+  @override
+  NativeJobSnapshot pollJob(int jobHandle) {
+    throw UnimplementedError();
+  }
+
+  @override
+  SeparationResult resultForJob(int jobHandle) {
+    throw UnimplementedError();
+  }
+
+  @override
+  int startJob(int engineHandle, SeparationRequest request) {
+    throw UnimplementedError();
+  }
+}
@@ -0,0 +1,113 @@
+import 'dart:collection';
+
+import 'package:aero_music_separator/core/ffi/ams_native.dart';
+import 'package:aero_music_separator/core/separation/model_preload_service.dart';
+import 'package:aero_music_separator/core/separation/separation_models.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+void main() {
+  test('keeps the loaded engine warm until released', () async {
+    final native = _FakeEngineLoadNative(
+      pollSnapshots: <NativeEngineLoadSnapshot>[
+        NativeEngineLoadSnapshot(
+          state: SeparationJobState.running,
+          progress: 0.5,
+        ),
+        NativeEngineLoadSnapshot(
+          state: SeparationJobState.succeeded,
+          progress: 1.0,
+        ),
+      ],
+    );
+    final service = ModelPreloadService(native: native);
+
+    await service.preload(modelPath: 'model.gguf', backend: AmsBackend.auto);
+
+    expect(service.isWarm, isTrue);
+    expect(native.destroyedLoads, <int>[7]);
+    expect(native.closedEngines, isEmpty);
+
+    await service.preload(modelPath: 'model.gguf', backend: AmsBackend.auto);
+    expect(native.startCalls, 1);
+
+    service.dispose();
+    expect(native.closedEngines, <int>[42]);
+  });
+
+  test('a different model cancels the running preload', () async {
+    final native = _FakeEngineLoadNative(
+      pollSnapshots: <NativeEngineLoadSnapshot>[
+        NativeEngineLoadSnapshot(
+          state: SeparationJobState.running,
+          progress: 0.1,
+        ),
+      ],
+    );
+    final service = ModelPreloadService(native: native);
+
+    final first = service.preload(
+      modelPath: 'a.gguf',
+      backend: AmsBackend.auto,
+    );
+    final second = service.preload(
+      modelPath: 'b.gguf',
+      backend: AmsBackend.auto,
+    );
+
+    await expectLater(first, throwsA(isA<NativeCancelledException>()));
+    expect(native.cancelledLoads, <int>[7]);
+    expect(native.startCalls, 2);
+
+    service.dispose();
+    await expectLater(second, throwsA(isA<NativeCancelledException>()));
+  });
+}
+
+class _FakeEngineLoadNative implements AmsEngineLoadNativeApi {
+  _FakeEngineLoadNative({
+    required List<NativeEngineLoadSnapshot> pollSnapshots,
+  }) : _pollSnapshots = Queue<NativeEngineLoadSnapshot>.from(pollSnapshots);
+
+  final Queue<NativeEngineLoadSnapshot> _pollSnapshots;
+  NativeEngineLoadSnapshot _lastSnapshot = NativeEngineLoadSnapshot(
+    state: SeparationJobState.pending,
+    progress: 0.0,
+  );
+
+  int startCalls = 0;
+  final List<int> cancelledLoads = <int>[];
+  final List<int> destroyedLoads = <int>[];
+  final List<int> closedEngines = <int>[];
+
+  @override
+  int startEngineLoad(String modelPath, AmsBackend backend) {
+    startCalls += 1;
+    return 6 + startCalls;
+  }
+
+  @override
+  NativeEngineLoadSnapshot pollEngineLoad(int loadHandle) {
+    if (_pollSnapshots.isNotEmpty) {
+      _lastSnapshot = _pollSnapshots.removeFirst();
+    }
+    return _lastSnapshot;
+  }
+
+  @override
+  void cancelEngineLoad(int loadHandle) {
+    cancelledLoads.add(loadHandle);
+  }
+
+  @override
+  int takeEngineFromLoad(int loadHandle) => 42;
+
+  @override
+  void destroyEngineLoad(int loadHandle) {
+    destroyedLoads.add(loadHandle);
+  }
+
+  @override
+  void closeEngine(int engineHandle) {
+    closedEngines.add(engineHandle);
+  }
+}
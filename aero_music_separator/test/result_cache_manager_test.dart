@@ -24,4 +24,23 @@ void main() {
       }
     }
   });
+
+  test('ResultCacheManager keeps the stem cache across runs', () async {
+    final baseTemp = await Directory.systemTemp.createTemp('ams_cache_test_');
+    try {
+      final manager = ResultCacheManager(tempDirProvider: () async => baseTemp);
+
+      final stemDir = await manager.stemCacheDir();
+      final entry = File('$stemDir${Platform.pathSeparator}entry.stems');
+      await entry.writeAsString('cached');
+
+      final latestDir = await manager.prepareLatestRunDir();
+      expect(stemDir, isNot(latestDir));
+      expect(await entry.exists(), isTrue);
+    } finally {
+      if (await baseTemp.exists()) {
+        await baseTemp.delete(recursive: true);
+      }
+    }
+  });
 }
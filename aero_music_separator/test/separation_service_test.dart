@@ -1,3 +1,4 @@
+import 'dart:async';
 import 'dart:collection';
 
 import 'package:aero_music_separator/core/ffi/ams_native.dart';
@@ -56,6 +57,62 @@ void main() {
     await expectLater(future, throwsA(isA<NativeCancelledException>()));
     expect(native.cancelCalls, 1);
   });
+
+  test('pending job reports its queue position', () async {
+    final native = _FakeSeparationNative(
+      pollSnapshots: <NativeJobSnapshot>[
+        NativeJobSnapshot(
+          state: SeparationJobState.pending,
+          stage: SeparationStage.idle,
+          progress: 0,
+          queuePosition: 2,
+        ),
+        NativeJobSnapshot(
+          state: SeparationJobState.cancelled,
+          stage: SeparationStage.idle,
+          progress: 0,
+        ),
+      ],
+    );
+    final controller = SeparationTaskController(native: native);
+    addTearDown(controller.dispose);
+
+    final messages = <String>[];
+    controller.progress.listen((event) => messages.add(event.message));
+
+    final future = controller.start(_request());
+    await expectLater(future, throwsA(isA<NativeCancelledException>()));
+    expect(messages, contains('Queued behind 2 job(s)'));
+  });
+
+  test('pushed job event completes without waiting for the poll timer', () async {
+    final native = _EventSeparationNative(
+      pollSnapshots: <NativeJobSnapshot>[
+        NativeJobSnapshot(
+          state: SeparationJobState.succeeded,
+          stage: SeparationStage.done,
+          progress: 1.0,
+        ),
+      ],
+    );
+    final controller = SeparationTaskController(native: native);
+    addTearDown(controller.dispose);
+    addTearDown(native.events.close);
+
+    final future = controller.start(_request());
+    native.events.add(
+      NativeTaskEvent(
+        kind: NativeTaskKind.job,
+        handle: 10,
+        state: SeparationJobState.succeeded.value,
+        stage: SeparationStage.done.value,
+        progress: 1.0,
+      ),
+    );
+
+    await future.timeout(const Duration(milliseconds: 500));
+    expect(native.resultForJobCalls, 1);
+  });
 }
 
 SeparationRequest _request() {
@@ -111,6 +168,19 @@ class _FakeSeparationNative implements AmsSeparationNativeApi {
   @override
   int openEngine(String modelPath, AmsBackend backend) => 1;
 
+  @override
+  ModelProbeInfo probeModel(String modelPath) {
+    return ModelProbeInfo(
+      chunkSize: 352800,
+      overlap: 2,
+      sampleRate: 44100,
+      stemCount: 2,
+      parameterCount: 0,
+      weightDtype: 'F16',
+      architecture: 'bs_roformer',
+    );
+  }
+
   @override
   NativeJobSnapshot pollJob(int jobHandle) {
     if (_pollSnapshots.isNotEmpty) {
@@ -133,3 +203,14 @@ class _FakeSeparationNative implements AmsSeparationNativeApi {
   @override
   int startJob(int engineHandle, SeparationRequest request) => 10;
 }
+
+class _EventSeparationNative extends _FakeSeparationNative
+    implements AmsTaskEventSource {
+  _EventSeparationNative({required super.pollSnapshots});
+
+  final StreamController<NativeTaskEvent> events =
+      StreamController<NativeTaskEvent>.broadcast();
+
+  @override
+  Stream<NativeTaskEvent>? get taskEvents => events.stream;
+}